@@ -0,0 +1,489 @@
+// vc_bench: end-to-end encode benchmark.
+//
+// Generates a reproducible synthetic corpus with lavfi (testsrc2, mandelbrot,
+// noise) and pushes it through the real VideoCompressor pipeline once per
+// combination of encoding mode, parallel job count and encoder. Results go
+// to stdout or --output as CSV (one row per job) or JSON (runs with jobs).
+// Needs only ffmpeg/ffprobe in PATH and runs without a display.
+
+#include "videocompressor.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTextStream>
+#include <QThread>
+#include <cstdio>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char *const ModeNames[] = {"two-pass", "single-pass", "capped-crf"};
+
+struct CorpusClip {
+    QString name;
+    QString source;   // lavfi graph without size/rate
+    int width;
+    int height;
+    int fps;
+    int seconds;
+    int bitrateKbps;  // High enough that every clip is over the target
+};
+
+struct JobResult {
+    QString file;
+    QString status;
+    QString encodeMode;
+    qint64 inputBytes;
+    qint64 outputBytes;
+    double jobSeconds;    // First Compressing status to the final status
+    double pass1Seconds;  // Two-pass only, until pass 2 starts
+};
+
+struct RunResult {
+    QString mode;
+    int jobs;             // As requested, 0 = auto
+    int effectiveJobs;
+    QString encoder;
+    QString backend;      // EncoderBackend preferred for the run
+    qint64 targetBytes;
+    double wallSeconds;
+    double probeSeconds;  // Adding the files until every row is analyzed
+    double encodeSeconds; // startCompression() until compressionFinished()
+    double mediaSeconds;
+    double cpuSeconds;    // This process and its reaped ffmpeg children
+    QList<JobResult> jobResults;
+
+    double realtimeFactor() const { return wallSeconds > 0 ? mediaSeconds / wallSeconds : 0; }
+    double cpuUtilisation() const
+    {
+        if (cpuSeconds < 0 || wallSeconds <= 0) {
+            return -1;
+        }
+        return cpuSeconds / (wallSeconds * QThread::idealThreadCount());
+    }
+};
+
+void logLine(const QString &line)
+{
+    fputs(line.toLocal8Bit().constData(), stderr);
+    fputs("\n", stderr);
+    fflush(stderr);
+}
+
+// Fixed seeds and bitexact muxing keep the corpus identical between runs
+// with the same FFmpeg build
+QList<CorpusClip> corpusSpec(bool quick, bool includeLong)
+{
+    QList<CorpusClip> clips;
+    if (quick) {
+        clips << CorpusClip{"testsrc2_720p30_10s", "testsrc2", 1280, 720, 30, 10, 12000}
+              << CorpusClip{"mandelbrot_480p25_8s", "mandelbrot", 640, 480, 25, 8, 12000};
+    } else {
+        clips << CorpusClip{"testsrc2_720p30_20s", "testsrc2", 1280, 720, 30, 20, 12000}
+              << CorpusClip{"testsrc2_1080p60_30s", "testsrc2", 1920, 1080, 60, 30, 20000}
+              << CorpusClip{"testsrc2_360p24_60s", "testsrc2", 640, 360, 24, 60, 4000}
+              << CorpusClip{"mandelbrot_480p25_15s", "mandelbrot", 640, 480, 25, 15, 8000}
+              << CorpusClip{"noise_720p30_10s", "noise", 1280, 720, 30, 10, 15000};
+    }
+    if (includeLong) {
+        // Long enough for the chunked encoder (10 minutes and up)
+        clips << CorpusClip{"testsrc2_540p30_660s", "testsrc2", 960, 540, 30, 660, 3000};
+    }
+    return clips;
+}
+
+QString lavfiGraph(const CorpusClip &clip)
+{
+    QString size = QString("%1x%2").arg(clip.width).arg(clip.height);
+    if (clip.source == "noise") {
+        return QString("color=c=gray:size=%1:rate=%2,noise=alls=60:allf=t+u:all_seed=1234").arg(size).arg(clip.fps);
+    }
+    return QString("%1=size=%2:rate=%3").arg(clip.source, size).arg(clip.fps);
+}
+
+bool generateClip(const CorpusClip &clip, const QString &path)
+{
+    QStringList args;
+    args << "-y" << "-v" << "error"
+         << "-f" << "lavfi" << "-i" << lavfiGraph(clip)
+         << "-f" << "lavfi" << "-i" << "sine=frequency=440:sample_rate=48000"
+         << "-t" << QString::number(clip.seconds)
+         << "-c:v" << "libx264" << "-preset" << "ultrafast"
+         << "-b:v" << QString("%1k").arg(clip.bitrateKbps)
+         << "-pix_fmt" << "yuv420p"
+         << "-c:a" << "aac" << "-b:a" << "128k"
+         << "-fflags" << "+bitexact" << "-flags:v" << "+bitexact" << "-flags:a" << "+bitexact"
+         << path;
+
+    QProcess process;
+    process.start("ffmpeg", args);
+    if (!process.waitForStarted(5000) || !process.waitForFinished(-1) || process.exitCode() != 0) {
+        logLine("Corpus: ffmpeg failed for " + clip.name + ": " + QString::fromUtf8(process.readAllStandardError()).trimmed());
+        QFile::remove(path);
+        return false;
+    }
+    return true;
+}
+
+// Existing clips are reused, so only the first run pays for generation
+bool prepareCorpus(const QString &dir, const QList<CorpusClip> &clips, QStringList *paths, double *mediaSeconds)
+{
+    QDir().mkpath(dir);
+    *mediaSeconds = 0;
+    for (const CorpusClip &clip : clips) {
+        QString path = QDir(dir).absoluteFilePath(clip.name + ".mp4");
+        if (QFileInfo(path).size() <= 0) {
+            logLine("Corpus: generating " + clip.name);
+            if (!generateClip(clip, path)) {
+                return false;
+            }
+        }
+        paths->append(path);
+        *mediaSeconds += clip.seconds;
+    }
+    return true;
+}
+
+double cpuSecondsUsed()
+{
+#ifdef Q_OS_UNIX
+    // Children only count once reaped, which QProcess does when they exit
+    double total = 0;
+    const int who[] = {RUSAGE_SELF, RUSAGE_CHILDREN};
+    for (int target : who) {
+        struct rusage usage;
+        if (getrusage(target, &usage) != 0) {
+            return -1;
+        }
+        total += usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+        total += usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+    return total;
+#else
+    return -1;
+#endif
+}
+
+bool hasAnalyzingRows(const VideoCompressor &compressor)
+{
+    for (int row = 0; row < compressor.rowCount(); ++row) {
+        if (compressor.index(row).data(VideoCompressor::StatusRole).toInt() == int(VideoStatus::Analyzing)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString statusName(int status)
+{
+    switch (static_cast<VideoStatus>(status)) {
+    case VideoStatus::Completed:
+        return "completed";
+    case VideoStatus::AlreadyOptimal:
+        return "already_optimal";
+    case VideoStatus::Error:
+        return "error";
+    default:
+        return "unfinished";
+    }
+}
+
+RunResult runOnce(const QStringList &paths, double mediaSeconds, int mode, int jobs, bool hardware,
+                  const QString &softwareEncoder, EncoderBackendKind backend, int targetSizeMB)
+{
+    VideoCompressor compressor;
+    compressor.clearMediaCache(); // vc_bench's own cache; keeps every probe cold
+    compressor.setTargetSizeMB(targetSizeMB);
+    compressor.setMaxConcurrentJobs(jobs);
+    compressor.setEncodingMode(mode);
+    compressor.setHardwareAccelerationEnabled(hardware);
+    compressor.setEncoderPreference(softwareEncoder);
+    compressor.setEncoderBackend(backend);
+
+    RunResult run;
+    run.mode = ModeNames[mode];
+    run.jobs = jobs;
+    run.effectiveJobs = compressor.effectiveConcurrentJobs();
+    run.encoder = hardware ? compressor.hardwareAccelerationType() : softwareEncoder;
+    run.backend = compressor.encoderBackend() == EncoderBackendKind::Libav ? "libav" : "process";
+    run.targetBytes = qint64(targetSizeMB) * 1024 * 1024;
+    run.mediaSeconds = mediaSeconds;
+
+    QElapsedTimer wall;
+    QHash<quint64, qint64> startedMs;
+    QHash<quint64, qint64> pass2Ms;
+    QHash<quint64, qint64> finishedMs;
+    QObject::connect(&compressor, &VideoCompressor::videoStatusChanged,
+                     [&](quint64 id, int status, const QString &text, int) {
+        qint64 now = wall.elapsed();
+        if (status == int(VideoStatus::Compressing) && !startedMs.contains(id)) {
+            startedMs.insert(id, now);
+        }
+        if (text.startsWith("Starting pass 2") && !pass2Ms.contains(id)) {
+            pass2Ms.insert(id, now);
+        }
+        if (status == int(VideoStatus::Completed) || status == int(VideoStatus::AlreadyOptimal) ||
+            status == int(VideoStatus::Error)) {
+            finishedMs.insert(id, now);
+        }
+    });
+
+    double cpuStart = cpuSecondsUsed();
+    wall.start();
+
+    QEventLoop loop;
+    for (const QString &path : paths) {
+        compressor.addVideoFromPath(path);
+    }
+    QMetaObject::Connection probeWatch = QObject::connect(&compressor, &VideoCompressor::dataChanged, &loop, [&]() {
+        if (!hasAnalyzingRows(compressor)) {
+            loop.quit();
+        }
+    });
+    if (hasAnalyzingRows(compressor)) {
+        loop.exec();
+    }
+    QObject::disconnect(probeWatch);
+    qint64 probeDoneMs = wall.elapsed();
+
+    QObject::connect(&compressor, &VideoCompressor::compressionFinished, &loop, &QEventLoop::quit);
+    compressor.startCompression();
+    if (compressor.isCompressing()) {
+        loop.exec();
+    }
+
+    run.wallSeconds = wall.elapsed() / 1000.0;
+    run.probeSeconds = probeDoneMs / 1000.0;
+    run.encodeSeconds = (wall.elapsed() - probeDoneMs) / 1000.0;
+    double cpuEnd = cpuSecondsUsed();
+    run.cpuSeconds = cpuStart >= 0 && cpuEnd >= 0 ? cpuEnd - cpuStart : -1;
+
+    for (int row = 0; row < compressor.rowCount(); ++row) {
+        QModelIndex index = compressor.index(row);
+        quint64 id = index.data(VideoCompressor::VideoIdRole).toULongLong();
+        QString input = index.data(VideoCompressor::PathRole).toString();
+        int status = index.data(VideoCompressor::StatusRole).toInt();
+
+        JobResult job;
+        job.file = QFileInfo(input).fileName();
+        job.status = statusName(status);
+        job.encodeMode = index.data(VideoCompressor::EncodeModeRole).toString();
+        job.inputBytes = QFileInfo(input).size();
+        job.outputBytes = status == int(VideoStatus::Error) ? 0 : QFileInfo(index.data(VideoCompressor::OutputPathRole).toString()).size();
+        qint64 start = startedMs.value(id, finishedMs.value(id));
+        job.jobSeconds = (finishedMs.value(id) - start) / 1000.0;
+        job.pass1Seconds = pass2Ms.contains(id) ? (pass2Ms.value(id) - start) / 1000.0 : 0;
+        run.jobResults.append(job);
+    }
+    return run;
+}
+
+void writeCsv(QTextStream &out, const QList<RunResult> &runs)
+{
+    out << "mode,jobs,effective_jobs,encoder,backend,file,status,encode_mode,input_bytes,output_bytes,target_bytes,"
+           "size_vs_target_pct,job_seconds,pass1_seconds,run_wall_seconds,run_probe_seconds,run_encode_seconds,"
+           "run_realtime_factor,run_cpu_utilisation\n";
+    for (const RunResult &run : runs) {
+        for (const JobResult &job : run.jobResults) {
+            double sizeError = job.outputBytes > 0 ? (double(job.outputBytes) / run.targetBytes - 1.0) * 100 : 0;
+            QString encodeMode = job.encodeMode;
+            encodeMode.replace('"', "\"\"");
+            out << run.mode << ',' << run.jobs << ',' << run.effectiveJobs << ',' << run.encoder << ',' << run.backend << ','
+                << job.file << ',' << job.status << ",\"" << encodeMode << "\","
+                << job.inputBytes << ',' << job.outputBytes << ',' << run.targetBytes << ','
+                << QString::number(sizeError, 'f', 2) << ',' << QString::number(job.jobSeconds, 'f', 3) << ','
+                << QString::number(job.pass1Seconds, 'f', 3) << ',' << QString::number(run.wallSeconds, 'f', 3) << ','
+                << QString::number(run.probeSeconds, 'f', 3) << ',' << QString::number(run.encodeSeconds, 'f', 3) << ','
+                << QString::number(run.realtimeFactor(), 'f', 3) << ',' << QString::number(run.cpuUtilisation(), 'f', 3) << '\n';
+        }
+    }
+}
+
+QJsonDocument toJson(const QList<RunResult> &runs)
+{
+    QJsonArray runArray;
+    for (const RunResult &run : runs) {
+        QJsonArray jobArray;
+        for (const JobResult &job : run.jobResults) {
+            QJsonObject object;
+            object["file"] = job.file;
+            object["status"] = job.status;
+            object["encodeMode"] = job.encodeMode;
+            object["inputBytes"] = job.inputBytes;
+            object["outputBytes"] = job.outputBytes;
+            object["sizeVsTargetPercent"] = job.outputBytes > 0 ? (double(job.outputBytes) / run.targetBytes - 1.0) * 100 : 0;
+            object["jobSeconds"] = job.jobSeconds;
+            object["pass1Seconds"] = job.pass1Seconds;
+            jobArray.append(object);
+        }
+
+        QJsonObject object;
+        object["mode"] = run.mode;
+        object["jobs"] = run.jobs;
+        object["effectiveJobs"] = run.effectiveJobs;
+        object["encoder"] = run.encoder;
+        object["backend"] = run.backend;
+        object["targetBytes"] = run.targetBytes;
+        object["wallSeconds"] = run.wallSeconds;
+        object["probeSeconds"] = run.probeSeconds;
+        object["encodeSeconds"] = run.encodeSeconds;
+        object["mediaSeconds"] = run.mediaSeconds;
+        object["realtimeFactor"] = run.realtimeFactor();
+        object["cpuSeconds"] = run.cpuSeconds;
+        object["cpuUtilisation"] = run.cpuUtilisation();
+        object["results"] = jobArray;
+        runArray.append(object);
+    }
+
+    QJsonObject root;
+    root["logicalCpus"] = QThread::idealThreadCount();
+    root["runs"] = runArray;
+    return QJsonDocument(root);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("vc_bench"); // Own media cache, separate from the app's
+    app.setOrganizationName("VideoCompressor");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Encode benchmark over a synthetic lavfi corpus.");
+    parser.addHelpOption();
+    QCommandLineOption corpusOption("corpus-dir", "Where the corpus is generated and reused (default: ./vc_bench_corpus).",
+                                    "dir", "vc_bench_corpus");
+    QCommandLineOption modesOption("modes", "Comma-separated encoding modes (default: all).",
+                                   "list", "two-pass,single-pass,capped-crf");
+    QCommandLineOption jobsOption("jobs", "Comma-separated parallel job counts, 0 = auto (default: 1,0).", "list", "1,0");
+    QCommandLineOption hwOption("hw", "Also run with the hardware encoder when one is detected.");
+    QCommandLineOption targetOption(QStringList() << "t" << "target-size", "Target size in MB (default 8).", "MB", "8");
+    QCommandLineOption formatOption("format", "csv (default) or json.", "format", "csv");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write results here instead of stdout.", "file");
+    QCommandLineOption quickOption("quick", "Two short clips, for smoke runs.");
+    QCommandLineOption longOption("long", "Add an 11-minute clip that takes the chunked encoder path.");
+    QCommandLineOption encoderOption("encoder", "Software encoder, or auto to let the time budget pick (default: libx264).",
+                                     "name", "libx264");
+    QCommandLineOption backendOption("backend", "Encoder backend, process (default) or libav.", "name", "process");
+    parser.addOption(corpusOption);
+    parser.addOption(modesOption);
+    parser.addOption(jobsOption);
+    parser.addOption(hwOption);
+    parser.addOption(targetOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(quickOption);
+    parser.addOption(longOption);
+    parser.addOption(backendOption);
+    parser.addOption(encoderOption);
+    parser.process(app);
+
+    QList<int> modes;
+    for (const QString &name : parser.value(modesOption).split(',', Qt::SkipEmptyParts)) {
+        int mode = -1;
+        for (int i = 0; i < 3; ++i) {
+            if (name.trimmed() == ModeNames[i]) {
+                mode = i;
+            }
+        }
+        if (mode < 0) {
+            logLine("Unknown mode: " + name);
+            return 2;
+        }
+        modes.append(mode);
+    }
+
+    QList<int> jobCounts;
+    for (const QString &value : parser.value(jobsOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        int jobs = value.trimmed().toInt(&ok);
+        if (!ok || jobs < 0) {
+            logLine("Invalid job count: " + value);
+            return 2;
+        }
+        jobCounts.append(jobs);
+    }
+
+    bool targetOk = false;
+    int targetSizeMB = parser.value(targetOption).toInt(&targetOk);
+    QString format = parser.value(formatOption);
+    QString backendName = parser.value(backendOption);
+    if (backendName != "process" && backendName != "libav") {
+        logLine("Unknown backend: " + backendName);
+        return 2;
+    }
+    EncoderBackendKind backend = backendName == "libav" ? EncoderBackendKind::Libav : EncoderBackendKind::Process;
+    if (!targetOk || targetSizeMB <= 0 || (format != "csv" && format != "json") || modes.isEmpty() || jobCounts.isEmpty()) {
+        logLine("Invalid arguments, see --help");
+        return 2;
+    }
+
+    QStringList corpus;
+    double mediaSeconds = 0;
+    if (!prepareCorpus(parser.value(corpusOption), corpusSpec(parser.isSet(quickOption), parser.isSet(longOption)),
+                       &corpus, &mediaSeconds)) {
+        return 3;
+    }
+
+    QList<bool> encoders = {false};
+    if (parser.isSet(hwOption)) {
+        VideoCompressor probe;
+        if (probe.hardwareAccelerationAvailable()) {
+            encoders.append(true);
+        } else {
+            logLine("No hardware encoder detected, running software only");
+        }
+    }
+
+    QList<RunResult> runs;
+    for (bool hardware : std::as_const(encoders)) {
+        for (int mode : std::as_const(modes)) {
+            for (int jobs : std::as_const(jobCounts)) {
+                logLine(QString("Run: %1, jobs %2, %3").arg(ModeNames[mode]).arg(jobs).arg(hardware ? "hardware" : "software"));
+                RunResult run = runOnce(corpus, mediaSeconds, mode, jobs, hardware, parser.value(encoderOption), backend, targetSizeMB);
+                logLine(QString("  %1 s wall, %2x realtime").arg(run.wallSeconds, 0, 'f', 1).arg(run.realtimeFactor(), 0, 'f', 2));
+                runs.append(run);
+            }
+        }
+    }
+
+    QFile outputFile;
+    if (parser.isSet(outputOption)) {
+        outputFile.setFileName(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            logLine("Cannot write " + outputFile.fileName());
+            return 2;
+        }
+    } else {
+        outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+
+    QTextStream out(&outputFile);
+    if (format == "json") {
+        out << toJson(runs).toJson(QJsonDocument::Indented);
+    } else {
+        writeCsv(out, runs);
+    }
+    out.flush();
+
+    // Non-zero when any job failed, so CI can flag regressions
+    for (const RunResult &run : std::as_const(runs)) {
+        for (const JobResult &job : run.jobResults) {
+            if (job.status != "completed" && job.status != "already_optimal") {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -9,50 +9,15 @@ Rectangle {
     border.width: 1
 
     property bool collapsed: true
-    property alias messageCount: messageModel.count
+    property alias messageCount: messageList.count
 
+    // Messages are buffered, filtered and batched by the C++ LogModel
     function addMessage(text, type = "info") {
-        var timestamp = new Date().toLocaleTimeString();
-        var color = getMessageColor(type);
-        messageModel.append({
-            "timestamp": timestamp,
-            "message": text,
-            "type": type,
-            "color": color
-        });
-
-        // Auto-scroll to bottom
-        if (!collapsed) {
-            Qt.callLater(function () {
-                if (messageList.count > 0) {
-                    messageList.positionViewAtEnd();
-                }
-            });
-        }
-
-        // Limit message count to prevent memory issues
-        if (messageModel.count > 1000) {
-            messageModel.remove(0, 100);
-        }
-    }
-
-    function getMessageColor(type) {
-        switch (type) {
-        case "error":
-            return "#ff6b6b";
-        case "warning":
-            return "#ffa726";
-        case "success":
-            return "#66bb6a";
-        case "info":
-            return "#42a5f5";
-        default:
-            return "#ffffff";
-        }
+        logModel.append(text, type);
     }
 
     function clearMessages() {
-        messageModel.clear();
+        logModel.clear();
     }
 
     Behavior on Layout.preferredHeight {
@@ -88,7 +53,7 @@ Rectangle {
                 }
 
                 Text {
-                    text: "(" + messageModel.count + " messages)"
+                    text: logModel.count === logModel.totalCount ? "(" + logModel.count + " messages)" : "(" + logModel.count + " of " + logModel.totalCount + " messages)"
                     color: "#888888"
                     font.pixelSize: 10
                 }
@@ -97,12 +62,34 @@ Rectangle {
                     Layout.fillWidth: true
                 }
 
+                ComboBox {
+                    Layout.preferredHeight: 22
+                    font.pixelSize: 10
+                    model: ["All", "Success and up", "Warnings and errors", "Errors only"]
+                    currentIndex: logModel.minimumSeverity
+                    onActivated: function (index) {
+                        logModel.minimumSeverity = index;
+                    }
+                }
+
+                Button {
+                    Layout.preferredWidth: 20
+                    Layout.preferredHeight: 20
+                    text: "💾"
+                    font.pixelSize: 10
+                    checkable: true
+                    checked: logModel.fileLoggingEnabled
+                    ToolTip.text: logModel.fileLoggingEnabled ? "Logging to " + logModel.logFilePath : "Also write messages to a log file"
+                    ToolTip.visible: hovered
+                    onToggled: logModel.fileLoggingEnabled = checked
+                }
+
                 Button {
                     Layout.preferredWidth: 20
                     Layout.preferredHeight: 20
                     text: "🗑"
                     font.pixelSize: 10
-                    enabled: messageModel.count > 0
+                    enabled: logModel.count > 0
                     ToolTip.text: "Clear messages"
                     ToolTip.visible: hovered
                     onClicked: clearMessages()
@@ -129,9 +116,16 @@ Rectangle {
 
             ListView {
                 id: messageList
-                model: messageModel
+                model: logModel
                 spacing: 1
 
+                // Inserts arrive in one batch per frame, so this runs at most once a frame
+                onCountChanged: {
+                    if (!root.collapsed) {
+                        Qt.callLater(messageList.positionViewAtEnd);
+                    }
+                }
+
                 delegate: Rectangle {
                     width: messageList.width
                     height: messageText.contentHeight + 6
@@ -194,11 +188,7 @@ Rectangle {
                             MenuItem {
                                 text: "Copy All Messages"
                                 onTriggered: {
-                                    var allMessages = "";
-                                    for (var i = 0; i < messageModel.count; i++) {
-                                        var item = messageModel.get(i);
-                                        allMessages += "[" + item.timestamp + "] " + item.message + "\n";
-                                    }
+                                    var allMessages = logModel.allText();
                                     // Create a temporary TextEdit to copy all messages
                                     var tempText = Qt.createQmlObject('import QtQuick; TextEdit { text: "' + allMessages.replace(/"/g, '\\"') + '" }', root, "tempTextEdit");
                                     tempText.selectAll();
@@ -213,10 +203,6 @@ Rectangle {
         }
     }
 
-    ListModel {
-        id: messageModel
-    }
-
     Component.onCompleted: {
         addMessage("Debug console initialized", "info");
         addMessage("Video Compressor ready", "success");
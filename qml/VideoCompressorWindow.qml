@@ -34,6 +34,15 @@ ApplicationWindow {
         }
     }
 
+    // Folder that pass 2 writes into directly
+    FolderDialog {
+        id: outputFolderDialog
+        title: "Select Folder to Encode Into"
+        onAccepted: {
+            videoCompressor.outputFolder = selectedFolder.toString();
+        }
+    }
+
     // Error dialog
     Dialog {
         id: errorDialog
@@ -172,6 +181,163 @@ ApplicationWindow {
                 width: 20
             }
 
+            // Encoding mode: speed vs. size accuracy
+            RowLayout {
+                spacing: 5
+
+                Text {
+                    text: "Mode:"
+                }
+
+                ComboBox {
+                    id: modeComboBox
+                    model: ["Two-pass", "Single-pass", "Capped CRF"]
+                    currentIndex: videoCompressor.encodingMode
+                    enabled: !videoCompressor.isCompressing
+                    onActivated: function (index) {
+                        videoCompressor.encodingMode = index;
+                    }
+
+                    ToolTip.text: {
+                        switch (currentIndex) {
+                        case 0:
+                            return "Most accurate size, roughly twice the encode time";
+                        case 1:
+                            return "About 2x faster, size may land a few percent off target";
+                        default:
+                            return "Fastest for easy clips, quality-targeted; re-encodes single-pass if it overshoots";
+                        }
+                    }
+                    ToolTip.visible: hovered
+                }
+            }
+
+            // Encoder: libx264 by default, "auto" picks by the time budget
+            RowLayout {
+                spacing: 5
+
+                Text {
+                    text: "Encoder:"
+                }
+
+                ComboBox {
+                    id: encoderComboBox
+                    model: ["libx264", "auto"].concat(videoCompressor.availableEncoders.filter(function (name) {
+                        return name !== "libx264";
+                    }))
+                    currentIndex: Math.max(0, model.indexOf(videoCompressor.encoderPreference))
+                    enabled: !videoCompressor.isCompressing && !videoCompressor.hardwareAccelerationEnabled
+                    onActivated: function (index) {
+                        videoCompressor.encoderPreference = textAt(index);
+                    }
+
+                    ToolTip.text: {
+                        if (videoCompressor.hardwareAccelerationEnabled) {
+                            return "Hardware acceleration always uses the hardware H.264 encoder";
+                        }
+                        if (currentText === "auto") {
+                            return "Best quality per bit whose estimated encode time fits the time budget";
+                        }
+                        return currentText === "libx264" ? "H.264 in MP4, plays everywhere" : "Always encode with " + currentText;
+                    }
+                    ToolTip.visible: hovered
+                }
+
+                // Encode seconds per second of video, in tenths
+                SpinBox {
+                    id: timeBudgetSpinBox
+                    from: 1
+                    to: 100
+                    value: Math.round(videoCompressor.encodeTimeBudget * 10)
+                    visible: encoderComboBox.currentText === "auto"
+                    enabled: !videoCompressor.isCompressing && videoCompressor.encodeDeadlineSeconds === 0
+                    editable: false
+                    textFromValue: function (value) {
+                        return (value / 10).toFixed(1) + "× realtime";
+                    }
+                    onValueModified: {
+                        videoCompressor.encodeTimeBudget = value / 10;
+                    }
+
+                    ToolTip.text: videoCompressor.encodeDeadlineSeconds > 0 ? "The deadline replaces the time budget" : "Encode time allowed per second of video"
+                    ToolTip.visible: hovered
+                }
+            }
+
+            // Wall-clock deadline (0 = off), per video or for the whole batch
+            RowLayout {
+                spacing: 5
+
+                Text {
+                    text: "Deadline:"
+                }
+
+                SpinBox {
+                    id: deadlineSpinBox
+                    from: 0
+                    to: 240
+                    value: Math.round(videoCompressor.encodeDeadlineSeconds / 60)
+                    enabled: !videoCompressor.isCompressing
+                    editable: false
+                    textFromValue: function (value) {
+                        return value === 0 ? "Off" : value + " min";
+                    }
+                    onValueModified: {
+                        videoCompressor.encodeDeadlineSeconds = value * 60;
+                    }
+
+                    ToolTip.text: "Pick the slowest preset that still finishes each video within this time, from the encode speeds measured on this machine"
+                    ToolTip.visible: hovered
+                }
+
+                CheckBox {
+                    text: "Whole batch"
+                    checked: videoCompressor.deadlinePerBatch
+                    enabled: !videoCompressor.isCompressing && videoCompressor.encodeDeadlineSeconds > 0
+                    onToggled: {
+                        videoCompressor.deadlinePerBatch = checked;
+                    }
+
+                    ToolTip.text: "The deadline covers the whole batch, split over the queued videos by length and resolution"
+                    ToolTip.visible: hovered
+                }
+            }
+
+            CheckBox {
+                text: "Fit to target"
+                checked: videoCompressor.sizeConvergenceEnabled
+                enabled: !videoCompressor.isCompressing
+                onToggled: {
+                    videoCompressor.sizeConvergenceEnabled = checked;
+                }
+
+                ToolTip.text: "Two-pass only: re-run pass 2 with a corrected bitrate when the file lands over the target or more than 10% under it"
+                ToolTip.visible: hovered
+            }
+
+            CheckBox {
+                text: "Encode into folder"
+                checked: videoCompressor.outputFolder !== ""
+                enabled: !videoCompressor.isCompressing
+                onToggled: {
+                    if (checked) {
+                        outputFolderDialog.open();
+                    } else {
+                        videoCompressor.outputFolder = "";
+                    }
+                    checked = Qt.binding(function () {
+                        return videoCompressor.outputFolder !== "";
+                    });
+                }
+
+                ToolTip.text: videoCompressor.outputFolder !== "" ? "Outputs are written directly to " + videoCompressor.outputFolder : "Write outputs straight into a folder instead of the temp folder, so there is nothing to copy afterwards"
+                ToolTip.visible: hovered
+            }
+
+            Item {
+                width: 20
+            }
+
             // Hardware Acceleration Checkbox
             RowLayout {
                 spacing: 5
@@ -220,6 +386,32 @@ ApplicationWindow {
                 }
             }
 
+            // Parallel jobs (0 = derived from core count)
+            RowLayout {
+                spacing: 5
+
+                Text {
+                    text: "Parallel Jobs:"
+                }
+
+                SpinBox {
+                    id: jobsSpinBox
+                    from: 0
+                    to: 16
+                    value: videoCompressor.maxConcurrentJobs
+                    editable: false
+                    textFromValue: function (value) {
+                        return value === 0 ? "Auto (" + videoCompressor.effectiveConcurrentJobs + ")" : value.toString();
+                    }
+                    onValueModified: {
+                        videoCompressor.maxConcurrentJobs = value;
+                    }
+
+                    ToolTip.text: "Number of videos encoded at the same time (" + videoCompressor.threadsPerJob + " threads each)"
+                    ToolTip.visible: hovered
+                }
+            }
+
             Button {
                 text: "Compress"
                 enabled: !videoCompressor.isCompressing && videoCompressor.totalCount > 0 && videoCompressor.ffmpegAvailable
@@ -330,9 +522,6 @@ ApplicationWindow {
                 debugConsole.addMessage("Compression stopped", "info");
             }
         }
-        function onDebugMessage(message, type) {
-            debugConsole.addMessage(message, type);
-        }
         function onHardwareAccelerationAvailableChanged() {
             if (videoCompressor.hardwareAccelerationAvailable) {
                 debugConsole.addMessage("Hardware acceleration detected: " + videoCompressor.hardwareAccelerationType, "success");
@@ -27,8 +27,8 @@ Rectangle {
             Image {
                 id: thumbnailImage
                 anchors.fill: parent
-                source: thumbnail || ""
-                cache: false
+                source: thumbnail || "" // image://thumbs/<id>/<revision>
+                cache: false // ThumbnailProvider keeps its own capped cache
                 fillMode: Image.PreserveAspectFit
                 visible: thumbnail && thumbnail !== ""
                 asynchronous: true
@@ -96,7 +96,7 @@ Rectangle {
             }
 
             Text {
-                text: originalSize
+                text: encodeMode ? originalSize + " • " + encodeMode : originalSize
                 color: "#666666"
                 font.pixelSize: 12
             }
@@ -135,6 +135,23 @@ Rectangle {
                 visible: status === 3 // Compressing
                 value: progress / 100
             }
+
+            // Live throughput from FFmpeg's -progress output
+            Text {
+                visible: status === 3 && encodeFps > 0
+                text: {
+                    var parts = [Math.round(encodeFps) + " fps"];
+                    if (encodeSpeed > 0)
+                        parts.push(encodeSpeed.toFixed(2) + "x");
+                    if (encodeBitrate > 0)
+                        parts.push(encodeBitrate + " kbps");
+                    if (etaSeconds >= 0)
+                        parts.push("ETA " + Math.floor(etaSeconds / 60) + ":" + ("0" + etaSeconds % 60).slice(-2));
+                    return parts.join(" • ");
+                }
+                color: "#666666"
+                font.pixelSize: 10
+            }
         }
 
         Button {
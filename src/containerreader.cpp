@@ -0,0 +1,1020 @@
+#include "containerreader.h"
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// Enough for the MPEG-TS sync bytes at 0/188/376 and M2TS at 4/196/388
+const int SniffBytes = 400;
+
+// ffprobe's format names, so cached and native results look the same
+const char *const Mp4FormatName = "mov,mp4,m4a,3gp,3g2,mj2";
+const char *const MatroskaFormatName = "matroska,webm";
+
+MediaInfo rejected(QString *whyNot, const QString &reason)
+{
+    if (whyNot) {
+        *whyNot = reason;
+    }
+    return MediaInfo();
+}
+
+// Media time in microseconds, without overflowing on long durations
+qint64 toMicroseconds(quint64 value, quint64 timescale)
+{
+    if (timescale == 0) {
+        return 0;
+    }
+    return qint64(value / timescale * 1000000 + value % timescale * 1000000 / timescale);
+}
+
+int kbps(quint64 bytes, qint64 durationUs)
+{
+    return durationUs > 0 ? int(bytes * 8000 / quint64(durationUs)) : 0;
+}
+
+// ffmpeg pixel format names for a chroma format as coded in H.264/HEVC:
+// 0 = monochrome, 1 = 4:2:0, 2 = 4:2:2, 3 = 4:4:4
+QString pixelFormatName(int chromaFormat, int bitDepth, bool fullRange = false)
+{
+    static const char *const names[] = {"gray", "yuv420p", "yuv422p", "yuv444p"};
+    if (chromaFormat < 0 || chromaFormat > 3 || bitDepth < 8 || bitDepth > 16) {
+        return QString();
+    }
+    QString name = names[chromaFormat];
+    if (bitDepth > 8) {
+        return name + QString::number(bitDepth) + "le";
+    }
+    // Only FFmpeg's H.264 decoder reports full range as the yuvj formats
+    if (fullRange && chromaFormat > 0) {
+        name.replace("yuv", "yuvj");
+    }
+    return name;
+}
+
+// Exp-Golomb capable reader over an RBSP
+class BitReader
+{
+public:
+    explicit BitReader(const QByteArray &data) : m_data(data), m_position(0), m_overrun(false) {}
+
+    bool overrun() const { return m_overrun; }
+
+    int bit()
+    {
+        if (m_position >= qint64(m_data.size()) * 8) {
+            m_overrun = true;
+            return 0;
+        }
+        int value = (uchar(m_data[m_position / 8]) >> (7 - m_position % 8)) & 1;
+        ++m_position;
+        return value;
+    }
+
+    quint32 bits(int count)
+    {
+        quint32 value = 0;
+        while (count-- > 0) {
+            value = value << 1 | quint32(bit());
+        }
+        return value;
+    }
+
+    quint32 ue()
+    {
+        int zeros = 0;
+        while (!bit() && !m_overrun) {
+            if (++zeros > 31) {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + bits(zeros);
+    }
+
+    qint32 se()
+    {
+        quint32 value = ue();
+        return value & 1 ? qint32((value + 1) / 2) : -qint32(value / 2);
+    }
+
+private:
+    QByteArray m_data;
+    qint64 m_position;
+    bool m_overrun;
+};
+
+// Chroma format, bit depth and range of an H.264 SPS NAL unit. The range
+// sits in the VUI, after everything else, so the whole SPS is walked.
+QString h264PixelFormat(const uchar *nal, int size)
+{
+    // Drop the NAL header and the emulation prevention bytes (00 00 03)
+    QByteArray rbsp;
+    rbsp.reserve(size);
+    int zeros = 0;
+    for (int i = 1; i < size; ++i) {
+        if (zeros >= 2 && nal[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = nal[i] == 0 ? zeros + 1 : 0;
+        rbsp.append(char(nal[i]));
+    }
+
+    BitReader reader(rbsp);
+    int profile = int(reader.bits(8));
+    reader.bits(16); // Constraint flags, level
+    reader.ue();     // seq_parameter_set_id
+
+    int chromaFormat = 1;
+    int bitDepth = 8;
+    static const QList<int> highProfiles = {100, 110, 122, 244, 44, 83, 86, 118, 128, 138, 139, 134, 135};
+    if (highProfiles.contains(profile)) {
+        chromaFormat = int(reader.ue());
+        if (chromaFormat == 3) {
+            reader.bit(); // separate_colour_plane_flag
+        }
+        bitDepth = int(reader.ue()) + 8;
+        reader.ue();  // Chroma bit depth
+        reader.bit(); // qpprime_y_zero_transform_bypass_flag
+        if (reader.bit()) {
+            // Scaling lists are skipped value by value
+            int lists = chromaFormat != 3 ? 8 : 12;
+            for (int i = 0; i < lists; ++i) {
+                if (!reader.bit()) {
+                    continue;
+                }
+                int last = 8;
+                int next = 8;
+                for (int j = 0; j < (i < 6 ? 16 : 64); ++j) {
+                    if (next != 0) {
+                        next = (last + reader.se() + 256) % 256;
+                    }
+                    last = next == 0 ? last : next;
+                }
+            }
+        }
+    }
+
+    reader.ue(); // log2_max_frame_num_minus4
+    quint32 pocType = reader.ue();
+    if (pocType == 0) {
+        reader.ue();
+    } else if (pocType == 1) {
+        reader.bit();
+        reader.se();
+        reader.se();
+        quint32 cycle = reader.ue();
+        for (quint32 i = 0; i < cycle && i < 256 && !reader.overrun(); ++i) {
+            reader.se();
+        }
+    }
+    reader.ue();  // max_num_ref_frames
+    reader.bit(); // gaps_in_frame_num_value_allowed_flag
+    reader.ue();  // Width and height in macroblocks
+    reader.ue();
+    if (!reader.bit()) {
+        reader.bit(); // mb_adaptive_frame_field_flag
+    }
+    reader.bit(); // direct_8x8_inference_flag
+    if (reader.bit()) {
+        reader.ue(); // Frame cropping
+        reader.ue();
+        reader.ue();
+        reader.ue();
+    }
+
+    bool fullRange = false;
+    if (reader.bit()) {
+        if (reader.bit() && reader.bits(8) == 255) {
+            reader.bits(32); // Extended sample aspect ratio
+        }
+        if (reader.bit()) {
+            reader.bit(); // overscan_appropriate_flag
+        }
+        if (reader.bit()) {
+            reader.bits(3); // video_format
+            fullRange = reader.bit();
+        }
+    }
+
+    if (reader.overrun()) {
+        return QString();
+    }
+    return pixelFormatName(chromaFormat, bitDepth, fullRange);
+}
+
+// avcC / Matroska V_MPEG4/ISO/AVC CodecPrivate: the first SPS decides
+QString avcConfigPixelFormat(const uchar *config, qint64 size)
+{
+    if (size < 8 || (config[5] & 0x1f) == 0) {
+        return QString();
+    }
+    int spsSize = qFromBigEndian<quint16>(config + 6);
+    if (spsSize < 4 || 8 + spsSize > size) {
+        return QString();
+    }
+    return h264PixelFormat(config + 8, spsSize);
+}
+
+// hvcC / Matroska V_MPEGH/ISO/HEVC CodecPrivate
+QString hevcConfigPixelFormat(const uchar *config, qint64 size)
+{
+    if (size < 23 || config[0] != 1) {
+        return QString();
+    }
+    return pixelFormatName(config[16] & 3, (config[17] & 7) + 8);
+}
+
+// av1C / Matroska V_AV1 CodecPrivate
+QString av1ConfigPixelFormat(const uchar *config, qint64 size)
+{
+    if (size < 4 || config[0] != 0x81) {
+        return QString();
+    }
+    bool highBitDepth = config[2] & 0x40;
+    bool twelveBit = config[2] & 0x20;
+    bool monochrome = config[2] & 0x10;
+    bool subsamplingX = config[2] & 0x08;
+    bool subsamplingY = config[2] & 0x04;
+    int chromaFormat = monochrome ? 0 : subsamplingX && subsamplingY ? 1 : subsamplingX ? 2 : 3;
+    return pixelFormatName(chromaFormat, highBitDepth ? (twelveBit ? 12 : 10) : 8);
+}
+
+// VP9 signals subsampling as 0/1 = 4:2:0, 2 = 4:2:2, 3 = 4:4:4
+QString vp9PixelFormat(int bitDepth, int chromaSubsampling)
+{
+    if (chromaSubsampling < 0 || chromaSubsampling > 3) {
+        return QString();
+    }
+    return pixelFormatName(chromaSubsampling <= 1 ? 1 : chromaSubsampling, bitDepth);
+}
+
+// A byte range inside the mapped file
+struct Span {
+    const uchar *data = nullptr;
+    qint64 size = 0;
+
+    bool isNull() const { return data == nullptr; }
+};
+
+// MP4 ----------------------------------------------------------------------
+
+struct Box {
+    QByteArray type;
+    Span payload;
+};
+
+// Child boxes of a payload: 32-bit size (1 = 64-bit size follows, 0 = to
+// the end) and fourcc. Parsing stops at the first box that doesn't fit.
+QList<Box> childBoxes(Span parent, qint64 offset = 0)
+{
+    QList<Box> boxes;
+    qint64 position = offset;
+    while (!parent.isNull() && position + 8 <= parent.size) {
+        const uchar *header = parent.data + position;
+        quint64 boxSize = qFromBigEndian<quint32>(header);
+        qint64 headerSize = 8;
+        if (boxSize == 1) {
+            if (position + 16 > parent.size) {
+                break;
+            }
+            boxSize = qFromBigEndian<quint64>(header + 8);
+            headerSize = 16;
+        } else if (boxSize == 0) {
+            boxSize = quint64(parent.size - position);
+        }
+        if (boxSize < quint64(headerSize) || boxSize > quint64(parent.size - position)) {
+            break;
+        }
+        Box box;
+        box.type = QByteArray(reinterpret_cast<const char *>(header + 4), 4);
+        box.payload = Span{header + headerSize, qint64(boxSize) - headerSize};
+        boxes.append(box);
+        position += qint64(boxSize);
+    }
+    return boxes;
+}
+
+Span childBox(Span parent, const char *type, qint64 offset = 0)
+{
+    const QList<Box> boxes = childBoxes(parent, offset);
+    for (const Box &box : boxes) {
+        if (box.type == type) {
+            return box.payload;
+        }
+    }
+    return Span();
+}
+
+// Object type of an esds DecoderConfigDescriptor, -1 if unreadable
+int esdsObjectType(Span esds)
+{
+    // Descriptor lengths are 1 to 4 bytes, 7 bits each
+    auto readDescriptor = [&esds](qint64 *position, int expectedTag) {
+        if (*position >= esds.size || esds.data[*position] != expectedTag) {
+            return false;
+        }
+        ++*position;
+        for (int i = 0; i < 4 && *position < esds.size; ++i) {
+            if (!(esds.data[(*position)++] & 0x80)) {
+                break;
+            }
+        }
+        return true;
+    };
+
+    qint64 position = 4; // FullBox version and flags
+    if (!readDescriptor(&position, 0x03) || position + 3 > esds.size) {
+        return -1;
+    }
+    uchar flags = esds.data[position + 2];
+    position += 3; // ES_ID, flags
+    if (flags & 0x80) {
+        position += 2; // dependsOn_ES_ID
+    }
+    if (flags & 0x40) {
+        position += 1 + (position < esds.size ? esds.data[position] : 0); // URL
+    }
+    if (flags & 0x20) {
+        position += 2; // OCR_ES_Id
+    }
+    if (!readDescriptor(&position, 0x04) || position >= esds.size) {
+        return -1;
+    }
+    return esds.data[position];
+}
+
+QString mp4AudioCodec(const QByteArray &type, Span entry, qint64 childOffset)
+{
+    if (type == "mp4a") {
+        // QuickTime nests the esds inside a wave box
+        Span esds = childBox(entry, "esds", childOffset);
+        if (esds.isNull()) {
+            esds = childBox(childBox(entry, "wave", childOffset), "esds");
+        }
+        switch (esdsObjectType(esds)) {
+        case 0x40:
+        case 0x66:
+        case 0x67:
+        case 0x68:
+            return "aac";
+        case 0x69:
+        case 0x6B:
+            return "mp3";
+        default:
+            return QString();
+        }
+    }
+    static const QHash<QByteArray, QString> codecs = {
+        {".mp3", "mp3"}, {"ac-3", "ac3"}, {"ec-3", "eac3"}, {"Opus", "opus"}, {"fLaC", "flac"},
+        {"alac", "alac"}, {"sowt", "pcm_s16le"}, {"twos", "pcm_s16be"}, {"samr", "amr_nb"}
+    };
+    return codecs.value(type);
+}
+
+// Matroska -----------------------------------------------------------------
+
+namespace Ebml {
+const quint32 Header = 0x1A45DFA3;
+const quint32 DocType = 0x4282;
+const quint32 Segment = 0x18538067;
+const quint32 SeekHead = 0x114D9B74;
+const quint32 Seek = 0x4DBB;
+const quint32 SeekId = 0x53AB;
+const quint32 SeekPosition = 0x53AC;
+const quint32 Info = 0x1549A966;
+const quint32 TimestampScale = 0x2AD7B1;
+const quint32 Duration = 0x4489;
+const quint32 Tracks = 0x1654AE6B;
+const quint32 TrackEntry = 0xAE;
+const quint32 TrackUid = 0x73C5;
+const quint32 TrackType = 0x83;
+const quint32 CodecId = 0x86;
+const quint32 CodecPrivate = 0x63A2;
+const quint32 Language = 0x22B59C;
+const quint32 DefaultDuration = 0x23E383;
+const quint32 Video = 0xE0;
+const quint32 PixelWidth = 0xB0;
+const quint32 PixelHeight = 0xBA;
+const quint32 Colour = 0x55B0;
+const quint32 BitsPerChannel = 0x55B2;
+const quint32 ChromaSubsamplingHorz = 0x55B3;
+const quint32 ChromaSubsamplingVert = 0x55B4;
+const quint32 Audio = 0xE1;
+const quint32 SamplingFrequency = 0xB5;
+const quint32 Channels = 0x9F;
+const quint32 BitDepth = 0x6264;
+const quint32 Cluster = 0x1F43B675;
+const quint32 Tags = 0x1254C367;
+const quint32 Tag = 0x7373;
+const quint32 Targets = 0x63C0;
+const quint32 TagTrackUid = 0x63C5;
+const quint32 SimpleTag = 0x67C8;
+const quint32 TagName = 0x45A3;
+const quint32 TagString = 0x4487;
+} // namespace Ebml
+
+struct Element {
+    quint32 id = 0;
+    Span payload;
+};
+
+// EBML variable-length integer; IDs keep their length marker, sizes don't
+bool readVint(Span span, qint64 position, bool keepMarker, quint64 *value, int *length, bool *allOnes = nullptr)
+{
+    if (position >= span.size || span.data[position] == 0) {
+        return false;
+    }
+    uchar first = span.data[position];
+    int bytes = 1;
+    uchar marker = 0x80;
+    while (!(first & marker)) {
+        marker >>= 1;
+        ++bytes;
+    }
+    if (position + bytes > span.size) {
+        return false;
+    }
+    quint64 result = keepMarker ? first : first & (marker - 1);
+    for (int i = 1; i < bytes; ++i) {
+        result = result << 8 | span.data[position + i];
+    }
+    if (allOnes) {
+        *allOnes = !keepMarker && result == (quint64(1) << (7 * bytes)) - 1;
+    }
+    *value = result;
+    *length = bytes;
+    return true;
+}
+
+// Element at a position; an unknown size (live recordings) runs to the end
+Element elementAt(Span parent, qint64 position, qint64 *next = nullptr)
+{
+    Element element;
+    quint64 id;
+    quint64 size;
+    int idLength;
+    int sizeLength;
+    bool unknownSize = false;
+    if (!readVint(parent, position, true, &id, &idLength) || id > 0xFFFFFFFF ||
+        !readVint(parent, position + idLength, false, &size, &sizeLength, &unknownSize)) {
+        return element;
+    }
+    qint64 start = position + idLength + sizeLength;
+    qint64 available = parent.size - start;
+    if (unknownSize) {
+        size = quint64(available);
+    } else if (size > quint64(available)) {
+        return element;
+    }
+    element.id = quint32(id);
+    element.payload = Span{parent.data + start, qint64(size)};
+    if (next) {
+        *next = start + qint64(size);
+    }
+    return element;
+}
+
+// Children up to (not including) the first stopId, so a Segment is not
+// walked cluster by cluster
+QList<Element> childElements(Span parent, quint32 stopId = 0)
+{
+    QList<Element> elements;
+    qint64 position = 0;
+    while (!parent.isNull() && position < parent.size) {
+        qint64 next = 0;
+        Element element = elementAt(parent, position, &next);
+        if (element.id == 0 || (stopId != 0 && element.id == stopId)) {
+            break;
+        }
+        elements.append(element);
+        position = next;
+    }
+    return elements;
+}
+
+Span childElement(Span parent, quint32 id)
+{
+    const QList<Element> elements = childElements(parent);
+    for (const Element &element : elements) {
+        if (element.id == id) {
+            return element.payload;
+        }
+    }
+    return Span();
+}
+
+quint64 ebmlUnsigned(Span span, quint64 defaultValue = 0)
+{
+    if (span.isNull() || span.size > 8) {
+        return defaultValue;
+    }
+    quint64 value = 0;
+    for (qint64 i = 0; i < span.size; ++i) {
+        value = value << 8 | span.data[i];
+    }
+    return value;
+}
+
+double ebmlFloat(Span span, double defaultValue = 0.0)
+{
+    if (span.size == 4) {
+        quint32 bits = qFromBigEndian<quint32>(span.data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    if (span.size == 8) {
+        quint64 bits = qFromBigEndian<quint64>(span.data);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    return defaultValue;
+}
+
+QString ebmlString(Span span)
+{
+    if (span.isNull()) {
+        return QString();
+    }
+    QByteArray bytes(reinterpret_cast<const char *>(span.data), int(span.size));
+    int end = bytes.indexOf('\0');
+    return QString::fromUtf8(end >= 0 ? bytes.left(end) : bytes);
+}
+
+QString matroskaAudioCodec(const QString &codecId, int bitDepth)
+{
+    if (codecId.startsWith("A_AAC")) {
+        return "aac";
+    }
+    if (codecId == "A_PCM/INT/LIT" || codecId == "A_PCM/INT/BIG") {
+        return QString("pcm_s%1%2").arg(bitDepth > 0 ? bitDepth : 16).arg(codecId.endsWith("LIT") ? "le" : "be");
+    }
+    static const QHash<QString, QString> codecs = {
+        {"A_OPUS", "opus"}, {"A_VORBIS", "vorbis"}, {"A_MPEG/L3", "mp3"}, {"A_AC3", "ac3"},
+        {"A_EAC3", "eac3"}, {"A_FLAC", "flac"}, {"A_DTS", "dts"}, {"A_TRUEHD", "truehd"}
+    };
+    return codecs.value(codecId);
+}
+
+} // namespace
+
+ContainerReader::Signature ContainerReader::sniff(const QByteArray &head)
+{
+    auto at = [&head](int offset, const QByteArray &magic) {
+        return head.mid(offset, magic.size()) == magic;
+    };
+
+    if (head.isEmpty()) {
+        return Signature::NotVideo;
+    }
+
+    // ISO BMFF / QuickTime: a known box type right after the first box size
+    static const char *const mp4Boxes[] = {"ftyp", "moov", "mdat", "free", "skip", "wide", "pnot"};
+    for (const char *box : mp4Boxes) {
+        if (at(4, box)) {
+            return Signature::Mp4;
+        }
+    }
+    if (at(0, QByteArrayLiteral("\x1A\x45\xDF\xA3"))) {
+        return Signature::Matroska;
+    }
+
+    if ((at(0, "RIFF") && at(8, "AVI ")) ||
+        at(0, QByteArrayLiteral("\x30\x26\xB2\x75\x8E\x66\xCF\x11")) || // ASF/WMV
+        at(0, QByteArrayLiteral("FLV\x01")) ||
+        at(0, "OggS") ||
+        at(0, ".RMF") ||
+        at(0, QByteArrayLiteral("\x00\x00\x01\xBA")) ||                 // MPEG program stream
+        at(0, QByteArrayLiteral("\x00\x00\x01\xB3"))) {                 // MPEG video elementary stream
+        return Signature::OtherVideo;
+    }
+    // Transport streams: 188-byte packets, or 192 with the M2TS timestamp
+    if ((head.size() > 376 && head[0] == 0x47 && head[188] == 0x47 && head[376] == 0x47) ||
+        (head.size() > 388 && head[4] == 0x47 && head[196] == 0x47 && head[388] == 0x47)) {
+        return Signature::OtherVideo;
+    }
+
+    if (at(0, QByteArrayLiteral("\x89PNG")) || at(0, QByteArrayLiteral("\xFF\xD8\xFF")) || at(0, "GIF8") ||
+        at(0, QByteArrayLiteral("PK\x03\x04")) || at(0, "%PDF") || at(0, "Rar!") ||
+        at(0, QByteArrayLiteral("7z\xBC\xAF")) || at(0, "ID3") || at(0, "fLaC") ||
+        (at(0, "RIFF") && at(8, "WAVE"))) {
+        return Signature::NotVideo;
+    }
+    // An error page or JSON saved under a video name
+    QByteArray text = head.trimmed();
+    if (text.startsWith('<') || text.startsWith('{')) {
+        return Signature::NotVideo;
+    }
+    return Signature::Unknown;
+}
+
+ContainerReader::Signature ContainerReader::sniffFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return Signature::Unknown;
+    }
+    return sniff(file.read(SniffBytes));
+}
+
+MediaInfo ContainerReader::read(const QString &path, QString *whyNot)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return rejected(whyNot, "cannot open the file");
+    }
+    qint64 size = file.size();
+    if (size < 16) {
+        return rejected(whyNot, "file too small");
+    }
+
+    // Mapped, not read: only the header pages the parser touches are loaded,
+    // wherever in the file they are
+    uchar *data = file.map(0, size);
+    if (!data) {
+        return rejected(whyNot, "cannot map the file");
+    }
+
+    MediaInfo info;
+    QByteArray head = QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(qMin<qint64>(size, SniffBytes)));
+    switch (sniff(head)) {
+    case Signature::Mp4:
+        info = readMp4(data, size, whyNot);
+        break;
+    case Signature::Matroska:
+        info = readMatroska(data, size, whyNot);
+        break;
+    default:
+        info = rejected(whyNot, "container not read natively");
+        break;
+    }
+
+    file.unmap(data);
+    return info;
+}
+
+MediaInfo ContainerReader::readMp4(const uchar *data, qint64 size, QString *whyNot)
+{
+    Span moov = childBox(Span{data, size}, "moov");
+    if (moov.isNull()) {
+        return rejected(whyNot, "no moov box");
+    }
+    if (!childBox(moov, "mvex").isNull()) {
+        return rejected(whyNot, "fragmented MP4");
+    }
+
+    Span mvhd = childBox(moov, "mvhd");
+    if (mvhd.size < 20 || (mvhd.data[0] == 1 && mvhd.size < 32)) {
+        return rejected(whyNot, "no movie header");
+    }
+    bool mvhdV1 = mvhd.data[0] == 1;
+    quint64 movieTimescale = qFromBigEndian<quint32>(mvhd.data + (mvhdV1 ? 20 : 12));
+    quint64 movieDuration = mvhdV1 ? qFromBigEndian<quint64>(mvhd.data + 24) : qFromBigEndian<quint32>(mvhd.data + 16);
+    qint64 durationUs = toMicroseconds(movieDuration, movieTimescale);
+    if (durationUs <= 0) {
+        return rejected(whyNot, "no movie duration");
+    }
+
+    MediaInfo info;
+    info.formatName = Mp4FormatName;
+    info.durationSeconds = durationUs / 1e6;
+    info.bitRateKbps = kbps(quint64(size), durationUs);
+
+    int streamIndex = 0;
+    const QList<Box> traks = childBoxes(moov);
+    for (const Box &trak : traks) {
+        if (trak.type != "trak") {
+            continue;
+        }
+        int index = streamIndex++;
+
+        Span mdia = childBox(trak.payload, "mdia");
+        Span hdlr = childBox(mdia, "hdlr");
+        Span mdhd = childBox(mdia, "mdhd");
+        Span stbl = childBox(childBox(mdia, "minf"), "stbl");
+        Span stsd = childBox(stbl, "stsd");
+        if (hdlr.size < 12 || mdhd.size < 24 || stsd.isNull()) {
+            continue;
+        }
+        QByteArray handler(reinterpret_cast<const char *>(hdlr.data + 8), 4);
+        if (handler != "vide" && handler != "soun") {
+            continue;
+        }
+
+        // Track duration from the media header, else from the track header
+        bool mdhdV1 = mdhd.data[0] == 1;
+        if (mdhdV1 && mdhd.size < 34) {
+            continue;
+        }
+        quint64 timescale = qFromBigEndian<quint32>(mdhd.data + (mdhdV1 ? 20 : 12));
+        quint64 mediaDuration = mdhdV1 ? qFromBigEndian<quint64>(mdhd.data + 24) : qFromBigEndian<quint32>(mdhd.data + 16);
+        qint64 trackUs = toMicroseconds(mediaDuration, timescale);
+        Span tkhd = childBox(trak.payload, "tkhd");
+        if (trackUs <= 0 && tkhd.size >= 28) {
+            bool tkhdV1 = tkhd.data[0] == 1;
+            quint64 trackDuration = tkhdV1 && tkhd.size >= 36 ? qFromBigEndian<quint64>(tkhd.data + 28)
+                                                              : qFromBigEndian<quint32>(tkhd.data + 20);
+            trackUs = toMicroseconds(trackDuration, movieTimescale);
+        }
+        if (trackUs <= 0) {
+            trackUs = durationUs;
+        }
+
+        // Sample count from stts, stream size from stsz
+        quint64 sampleCount = 0;
+        Span stts = childBox(stbl, "stts");
+        if (stts.size >= 8) {
+            quint32 entries = qFromBigEndian<quint32>(stts.data + 4);
+            for (quint32 i = 0; i < entries && 8 + qint64(i) * 8 + 8 <= stts.size; ++i) {
+                sampleCount += qFromBigEndian<quint32>(stts.data + 8 + qint64(i) * 8);
+            }
+        }
+        quint64 streamBytes = 0;
+        Span stsz = childBox(stbl, "stsz");
+        if (stsz.size >= 12) {
+            quint32 sampleSize = qFromBigEndian<quint32>(stsz.data + 4);
+            quint32 count = qFromBigEndian<quint32>(stsz.data + 8);
+            if (sampleSize != 0) {
+                streamBytes = quint64(sampleSize) * count;
+            } else if (12 + qint64(count) * 4 <= stsz.size) {
+                for (quint32 i = 0; i < count; ++i) {
+                    streamBytes += qFromBigEndian<quint32>(stsz.data + 12 + qint64(i) * 4);
+                }
+            }
+        }
+
+        // First sample entry: FullBox header and entry count, then a box
+        const QList<Box> entries = childBoxes(stsd, 8);
+        if (entries.isEmpty()) {
+            continue;
+        }
+        const Box &entry = entries.first();
+
+        if (handler == "vide") {
+            if (info.hasVideo) {
+                continue;
+            }
+            // Visual sample entry fields, then codec configuration boxes at 78
+            if (entry.payload.size < 78) {
+                return rejected(whyNot, "short video sample entry");
+            }
+            Span config;
+            if (entry.type == "avc1" || entry.type == "avc3") {
+                info.videoCodec = "h264";
+                config = childBox(entry.payload, "avcC", 78);
+                info.pixelFormat = avcConfigPixelFormat(config.data, config.size);
+            } else if (entry.type == "hvc1" || entry.type == "hev1") {
+                info.videoCodec = "hevc";
+                config = childBox(entry.payload, "hvcC", 78);
+                info.pixelFormat = hevcConfigPixelFormat(config.data, config.size);
+            } else if (entry.type == "av01") {
+                info.videoCodec = "av1";
+                config = childBox(entry.payload, "av1C", 78);
+                info.pixelFormat = av1ConfigPixelFormat(config.data, config.size);
+            } else if (entry.type == "vp09") {
+                info.videoCodec = "vp9";
+                config = childBox(entry.payload, "vpcC", 78);
+                if (config.size >= 7 && config.data[0] == 1) {
+                    info.pixelFormat = vp9PixelFormat(config.data[6] >> 4, (config.data[6] >> 1) & 7);
+                }
+            } else if (entry.type == "vp08") {
+                info.videoCodec = "vp8";
+                info.pixelFormat = "yuv420p";
+            } else {
+                return rejected(whyNot, "video codec " + QString::fromLatin1(entry.type) + " not read natively");
+            }
+            if (info.pixelFormat.isEmpty()) {
+                return rejected(whyNot, "unreadable " + info.videoCodec + " configuration");
+            }
+
+            info.hasVideo = true;
+            info.width = qFromBigEndian<quint16>(entry.payload.data + 24);
+            info.height = qFromBigEndian<quint16>(entry.payload.data + 26);
+            info.frameRate = sampleCount > 0 ? sampleCount * 1e6 / trackUs : 0.0;
+            info.videoBitRateKbps = kbps(streamBytes, trackUs);
+            if (info.width <= 0 || info.height <= 0 || info.frameRate <= 0) {
+                return rejected(whyNot, "incomplete video track");
+            }
+        } else {
+            // Sound sample entry; QuickTime versions 1 and 2 extend it
+            if (entry.payload.size < 28) {
+                return rejected(whyNot, "short audio sample entry");
+            }
+            int version = qFromBigEndian<quint16>(entry.payload.data + 8);
+            AudioStreamInfo audio;
+            audio.index = index;
+            audio.channels = qFromBigEndian<quint16>(entry.payload.data + 16);
+            audio.sampleRate = int(qFromBigEndian<quint32>(entry.payload.data + 24) >> 16);
+            qint64 childOffset = 28;
+            if (version == 1) {
+                childOffset = 44;
+            } else if (version == 2) {
+                if (entry.payload.size < 64) {
+                    return rejected(whyNot, "short audio sample entry");
+                }
+                quint64 rateBits = qFromBigEndian<quint64>(entry.payload.data + 32);
+                double rate;
+                std::memcpy(&rate, &rateBits, sizeof(rate));
+                audio.sampleRate = int(rate);
+                audio.channels = int(qFromBigEndian<quint32>(entry.payload.data + 40));
+                childOffset = 64;
+            }
+            audio.codec = mp4AudioCodec(entry.type, entry.payload, childOffset);
+            if (audio.codec.isEmpty()) {
+                return rejected(whyNot, "audio codec " + QString::fromLatin1(entry.type) + " not read natively");
+            }
+            audio.bitRateKbps = kbps(streamBytes, trackUs);
+
+            // ISO-639-2/T packed as three 5-bit letters; older QuickTime codes are skipped
+            quint16 language = qFromBigEndian<quint16>(mdhd.data + (mdhdV1 ? 32 : 20));
+            if (language >= 0x400 && language != 0x7FFF) {
+                for (int shift = 10; shift >= 0; shift -= 5) {
+                    audio.language += QChar(((language >> shift) & 0x1F) + 0x60);
+                }
+            }
+            info.audioStreams.append(audio);
+        }
+    }
+
+    info.valid = true;
+    return info;
+}
+
+MediaInfo ContainerReader::readMatroska(const uchar *data, qint64 size, QString *whyNot)
+{
+    Span file{data, size};
+    qint64 segmentPosition = 0;
+    Element header = elementAt(file, 0, &segmentPosition);
+    QString docType = ebmlString(childElement(header.payload, Ebml::DocType));
+    if (header.id != Ebml::Header || (docType != "matroska" && docType != "webm")) {
+        return rejected(whyNot, "not a Matroska document");
+    }
+    Element segment = elementAt(file, segmentPosition);
+    if (segment.id != Ebml::Segment) {
+        return rejected(whyNot, "no Matroska segment");
+    }
+
+    // Top-level elements before the first cluster, plus whatever the
+    // SeekHead points at further in (Tags are usually written last)
+    Span info;
+    Span tracks;
+    Span tags;
+    auto take = [&](quint32 id, Span payload) {
+        if (id == Ebml::Info && info.isNull()) {
+            info = payload;
+        } else if (id == Ebml::Tracks && tracks.isNull()) {
+            tracks = payload;
+        } else if (id == Ebml::Tags && tags.isNull()) {
+            tags = payload;
+        }
+    };
+    const QList<Element> topLevel = childElements(segment.payload, Ebml::Cluster);
+    for (const Element &element : topLevel) {
+        take(element.id, element.payload);
+    }
+    for (const Element &element : topLevel) {
+        if (element.id != Ebml::SeekHead) {
+            continue;
+        }
+        const QList<Element> seeks = childElements(element.payload);
+        for (const Element &seek : seeks) {
+            if (seek.id != Ebml::Seek) {
+                continue;
+            }
+            quint32 id = quint32(ebmlUnsigned(childElement(seek.payload, Ebml::SeekId)));
+            quint64 position = ebmlUnsigned(childElement(seek.payload, Ebml::SeekPosition));
+            if (position < quint64(segment.payload.size)) {
+                Element target = elementAt(segment.payload, qint64(position));
+                if (target.id == id) {
+                    take(id, target.payload);
+                }
+            }
+        }
+    }
+    if (info.isNull() || tracks.isNull()) {
+        return rejected(whyNot, "no Segment Info or Tracks");
+    }
+
+    quint64 timestampScale = ebmlUnsigned(childElement(info, Ebml::TimestampScale), 1000000);
+    double duration = ebmlFloat(childElement(info, Ebml::Duration));
+    qint64 durationUs = qint64(duration * timestampScale / 1000.0);
+    if (durationUs <= 0) {
+        return rejected(whyNot, "no segment duration");
+    }
+
+    // Statistics tags (mkvmerge, FFmpeg) carry per-track bitrates
+    QHash<quint64, int> bitRates;
+    const QList<Element> tagList = childElements(tags);
+    for (const Element &tag : tagList) {
+        if (tag.id != Ebml::Tag) {
+            continue;
+        }
+        quint64 trackUid = ebmlUnsigned(childElement(childElement(tag.payload, Ebml::Targets), Ebml::TagTrackUid));
+        const QList<Element> simpleTags = childElements(tag.payload);
+        for (const Element &simpleTag : simpleTags) {
+            if (simpleTag.id == Ebml::SimpleTag && trackUid != 0 &&
+                ebmlString(childElement(simpleTag.payload, Ebml::TagName)) == "BPS") {
+                bitRates.insert(trackUid, ebmlString(childElement(simpleTag.payload, Ebml::TagString)).toInt() / 1000);
+            }
+        }
+    }
+
+    MediaInfo result;
+    result.formatName = MatroskaFormatName;
+    result.durationSeconds = durationUs / 1e6;
+    result.bitRateKbps = kbps(quint64(size), durationUs);
+
+    int streamIndex = 0;
+    const QList<Element> entries = childElements(tracks);
+    for (const Element &entry : entries) {
+        if (entry.id != Ebml::TrackEntry) {
+            continue;
+        }
+        int index = streamIndex++;
+        quint64 type = ebmlUnsigned(childElement(entry.payload, Ebml::TrackType));
+        QString codecId = ebmlString(childElement(entry.payload, Ebml::CodecId));
+        Span codecPrivate = childElement(entry.payload, Ebml::CodecPrivate);
+        int bitRate = bitRates.value(ebmlUnsigned(childElement(entry.payload, Ebml::TrackUid)));
+
+        if (type == 1) {
+            if (result.hasVideo) {
+                continue;
+            }
+            Span video = childElement(entry.payload, Ebml::Video);
+            if (codecId == "V_MPEG4/ISO/AVC") {
+                result.videoCodec = "h264";
+                result.pixelFormat = avcConfigPixelFormat(codecPrivate.data, codecPrivate.size);
+            } else if (codecId == "V_MPEGH/ISO/HEVC") {
+                result.videoCodec = "hevc";
+                result.pixelFormat = hevcConfigPixelFormat(codecPrivate.data, codecPrivate.size);
+            } else if (codecId == "V_AV1") {
+                result.videoCodec = "av1";
+                result.pixelFormat = av1ConfigPixelFormat(codecPrivate.data, codecPrivate.size);
+            } else if (codecId == "V_VP9") {
+                result.videoCodec = "vp9";
+                // Codec features (id, length, value) first, else the Colour element
+                int bitDepth = -1;
+                int subsampling = -1;
+                for (qint64 i = 0; i + 2 < codecPrivate.size; i += 2 + codecPrivate.data[i + 1]) {
+                    if (codecPrivate.data[i + 1] == 1 && codecPrivate.data[i] == 3) {
+                        bitDepth = codecPrivate.data[i + 2];
+                    } else if (codecPrivate.data[i + 1] == 1 && codecPrivate.data[i] == 4) {
+                        subsampling = codecPrivate.data[i + 2];
+                    }
+                }
+                Span colour = childElement(video, Ebml::Colour);
+                if (bitDepth < 0 && !colour.isNull()) {
+                    bitDepth = int(ebmlUnsigned(childElement(colour, Ebml::BitsPerChannel), quint64(-1)));
+                }
+                if (subsampling < 0 && !colour.isNull()) {
+                    quint64 horizontal = ebmlUnsigned(childElement(colour, Ebml::ChromaSubsamplingHorz), 9);
+                    quint64 vertical = ebmlUnsigned(childElement(colour, Ebml::ChromaSubsamplingVert), 9);
+                    subsampling = horizontal == 1 && vertical == 1 ? 1 : horizontal == 1 && vertical == 0 ? 2
+                                : horizontal == 0 && vertical == 0 ? 3 : -1;
+                }
+                result.pixelFormat = vp9PixelFormat(bitDepth, subsampling);
+            } else if (codecId == "V_VP8") {
+                result.videoCodec = "vp8";
+                result.pixelFormat = "yuv420p";
+            } else {
+                return rejected(whyNot, "video codec " + codecId + " not read natively");
+            }
+            if (result.pixelFormat.isEmpty()) {
+                return rejected(whyNot, "unreadable " + result.videoCodec + " configuration");
+            }
+
+            quint64 frameDuration = ebmlUnsigned(childElement(entry.payload, Ebml::DefaultDuration));
+            result.hasVideo = true;
+            result.width = int(ebmlUnsigned(childElement(video, Ebml::PixelWidth)));
+            result.height = int(ebmlUnsigned(childElement(video, Ebml::PixelHeight)));
+            result.frameRate = frameDuration > 0 ? 1e9 / frameDuration : 0.0;
+            result.videoBitRateKbps = bitRate;
+            if (result.width <= 0 || result.height <= 0 || result.frameRate <= 0) {
+                return rejected(whyNot, "incomplete video track");
+            }
+        } else if (type == 2) {
+            Span audioElement = childElement(entry.payload, Ebml::Audio);
+            AudioStreamInfo audio;
+            audio.index = index;
+            audio.codec = matroskaAudioCodec(codecId, int(ebmlUnsigned(childElement(audioElement, Ebml::BitDepth))));
+            if (audio.codec.isEmpty()) {
+                return rejected(whyNot, "audio codec " + codecId + " not read natively");
+            }
+            audio.channels = int(ebmlUnsigned(childElement(audioElement, Ebml::Channels), 1));
+            audio.sampleRate = int(ebmlFloat(childElement(audioElement, Ebml::SamplingFrequency), 8000.0));
+            audio.bitRateKbps = bitRate;
+            Span language = childElement(entry.payload, Ebml::Language);
+            audio.language = language.isNull() ? QString("eng") : ebmlString(language);
+            result.audioStreams.append(audio);
+        }
+    }
+
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,35 @@
+#ifndef CONTAINERREADER_H
+#define CONTAINERREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include "mediainfo.h"
+
+// Reads duration and stream details straight from MP4/MOV (moov) and
+// Matroska/WebM (Segment Info/Tracks) headers through a memory map, so most
+// files need no ffprobe process. It only answers when it understood every
+// field the planner relies on; anything else returns an invalid MediaInfo
+// and the caller probes with ffprobe as before.
+class ContainerReader
+{
+public:
+    enum class Signature {
+        Unknown,    // Not recognised either way, left to ffprobe
+        Mp4,        // ISO BMFF and QuickTime
+        Matroska,   // Matroska and WebM
+        OtherVideo, // AVI, ASF, FLV, MPEG-PS/TS, Ogg, RealMedia
+        NotVideo    // Empty, or an image, audio, archive, document or web page
+    };
+
+    static Signature sniff(const QByteArray &head); // First bytes of a file
+    static Signature sniffFile(const QString &path);
+
+    // whyNot is set when the result is invalid, for the debug console
+    static MediaInfo read(const QString &path, QString *whyNot = nullptr);
+
+private:
+    static MediaInfo readMp4(const uchar *data, qint64 size, QString *whyNot);
+    static MediaInfo readMatroska(const uchar *data, qint64 size, QString *whyNot);
+};
+
+#endif // CONTAINERREADER_H
@@ -0,0 +1,208 @@
+#include "encodeplanner.h"
+
+namespace {
+
+// MP4 container overhead on top of the raw stream bytes
+const double ContainerOverhead = 1.01;
+
+// Stay a little below the target; stream bitrates from the container are averages
+const double TargetMargin = 0.97;
+
+// Audio bitrate used when only the audio is re-encoded
+const int ReencodedAudioKbps = 96;
+
+// Below roughly 0.05 bits per pixel per frame x264 output turns to blocks;
+// fewer, cleaner pixels look better at the same size and encode faster
+const double MinBitsPerPixel = 0.05;
+
+// Short-edge rungs (1080 = 1920x1080 landscape or 1080x1920 portrait)
+const int ResolutionLadder[] = {2160, 1440, 1080, 720, 540, 480, 360, 240};
+
+const double MaxFrameRate = 60.0;
+const double ReducedFrameRate = 30.0;
+
+} // namespace
+
+EncodePlan EncodePlanner::plan(const MediaInfo &media, qint64 fileSizeBytes, qint64 targetBytes,
+                               int transcodeVideoKbps, int transcodeAudioKbps)
+{
+    EncodePlan transcode;
+    transcode.strategy = EncodeStrategy::Transcode;
+    transcode.videoBitrateKbps = transcodeVideoKbps;
+    transcode.audioBitrateKbps = transcodeAudioKbps;
+    transcode.predictedBytes = streamBytes(transcodeVideoKbps + transcodeAudioKbps, media.durationSeconds);
+    transcode.reason = "full encode needed";
+    chooseOutputFormat(media, transcode);
+
+    if (!media.valid || !canCopyVideo(media)) {
+        if (media.valid) {
+            transcode.reason = QString("%1 video can't be copied into MP4").arg(media.videoCodec);
+        }
+        return transcode;
+    }
+
+    qint64 limit = qint64(targetBytes * TargetMargin);
+    qint64 firstAudioBytes = media.hasAudio() ? streamBytes(media.audioBitRateKbps(), media.durationSeconds) : 0;
+
+    // Without a stream bitrate, bound the video by the whole file minus the audio we keep
+    qint64 videoBytes = media.estimatedVideoBitRateKbps() > 0
+        ? streamBytes(media.estimatedVideoBitRateKbps(), media.durationSeconds)
+        : fileSizeBytes - firstAudioBytes;
+
+    // Remux: copy video and the first audio track only
+    if (!media.hasAudio() || (canCopyAudio(media) && media.audioBitRateKbps() > 0)) {
+        qint64 predicted = qint64((videoBytes + firstAudioBytes) * ContainerOverhead);
+        if (predicted <= limit) {
+            EncodePlan remux;
+            remux.strategy = EncodeStrategy::Remux;
+            remux.videoBitrateKbps = 0;
+            remux.audioBitrateKbps = 0;
+            remux.predictedBytes = predicted;
+            remux.shortSide = 0;
+            remux.frameRate = 0.0;
+            remux.reason = media.audioStreams.size() > 1
+                ? QString("dropping %1 extra audio tracks fits the target").arg(media.audioStreams.size() - 1)
+                : QString("stream copy into MP4 fits the target");
+            return remux;
+        }
+    }
+
+    // Video copy with a smaller AAC track
+    if (media.hasAudio()) {
+        int audioKbps = qMin(ReencodedAudioKbps, transcodeAudioKbps);
+        qint64 predicted = qint64((videoBytes + streamBytes(audioKbps, media.durationSeconds)) * ContainerOverhead);
+        if (predicted <= limit) {
+            EncodePlan audioOnly;
+            audioOnly.strategy = EncodeStrategy::AudioReencode;
+            audioOnly.videoBitrateKbps = 0;
+            audioOnly.audioBitrateKbps = audioKbps;
+            audioOnly.predictedBytes = predicted;
+            audioOnly.shortSide = 0;
+            audioOnly.frameRate = 0.0;
+            audioOnly.reason = QString("video copy with %1 kbps AAC fits the target").arg(audioKbps);
+            return audioOnly;
+        }
+    }
+
+    transcode.reason = "video stream alone exceeds the target";
+    return transcode;
+}
+
+QString EncodePlanner::strategyName(EncodeStrategy strategy)
+{
+    switch (strategy) {
+    case EncodeStrategy::Remux:
+        return "Remux";
+    case EncodeStrategy::AudioReencode:
+        return "Audio re-encode";
+    case EncodeStrategy::Transcode:
+        return "Transcode";
+    }
+    return QString();
+}
+
+void EncodePlanner::chooseOutputFormat(const MediaInfo &media, EncodePlan &plan)
+{
+    plan.shortSide = 0;
+    plan.frameRate = 0.0;
+    if (!media.valid || media.width <= 0 || media.height <= 0 || plan.videoBitrateKbps <= 0) {
+        return;
+    }
+    
+    int sourceShort = qMin(media.width, media.height);
+    int sourceLong = qMax(media.width, media.height);
+    double sourceRate = media.frameRate > 0 ? media.frameRate : ReducedFrameRate;
+    double bitsPerSecond = plan.videoBitrateKbps * 1000.0;
+    
+    // Frame rate is dropped before resolution within a rung: 1080p30 beats 720p60
+    // for the screen recordings and clips this tool mostly sees
+    QList<int> rungs;
+    rungs << sourceShort;
+    for (int rung : ResolutionLadder) {
+        if (rung < sourceShort) {
+            rungs << rung;
+        }
+    }
+    
+    int chosenShort = rungs.last();
+    double chosenRate = qMin(sourceRate, ReducedFrameRate);
+    bool found = false;
+    for (int rung : std::as_const(rungs)) {
+        double pixels = double(rung) * sourceLong * rung / sourceShort;
+        QList<double> rates;
+        rates << qMin(sourceRate, MaxFrameRate);
+        if (sourceRate > ReducedFrameRate + 1.0) {
+            rates << ReducedFrameRate;
+        }
+        for (double rate : std::as_const(rates)) {
+            if (bitsPerSecond / (pixels * rate) >= MinBitsPerPixel) {
+                chosenShort = rung;
+                chosenRate = rate;
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            break;
+        }
+    }
+    
+    if (chosenShort < sourceShort) {
+        plan.shortSide = chosenShort;
+    }
+    if (chosenRate < sourceRate - 0.5) {
+        plan.frameRate = chosenRate;
+    }
+}
+
+QStringList EncodePlanner::videoFilterArgs(const EncodePlan &plan)
+{
+    QStringList filters;
+    if (plan.shortSide > 0) {
+        // Scale the short edge so rotated phone videos keep their orientation
+        filters << QString("scale='if(gt(iw,ih),-2,%1)':'if(gt(iw,ih),%1,-2)'").arg(plan.shortSide);
+    }
+    if (plan.frameRate > 0) {
+        filters << QString("fps=%1").arg(QString::number(plan.frameRate, 'f', 3));
+    }
+    
+    if (filters.isEmpty()) {
+        return QStringList();
+    }
+    return QStringList() << "-vf" << filters.join(",");
+}
+
+QString EncodePlanner::outputFormatName(const MediaInfo &media, const EncodePlan &plan)
+{
+    int shortSide = plan.shortSide > 0 ? plan.shortSide : qMin(media.width, media.height);
+    double frameRate = plan.frameRate > 0 ? plan.frameRate : media.frameRate;
+    return QString("%1p%2").arg(shortSide).arg(qRound(frameRate));
+}
+
+QSize EncodePlanner::outputSize(const MediaInfo &media, const EncodePlan &plan)
+{
+    int sourceShortSide = qMin(media.width, media.height);
+    if (plan.shortSide <= 0 || sourceShortSide <= 0) {
+        return QSize(media.width, media.height);
+    }
+    double scale = double(plan.shortSide) / sourceShortSide;
+    return QSize(qRound(media.width * scale), qRound(media.height * scale));
+}
+
+bool EncodePlanner::canCopyVideo(const MediaInfo &media)
+{
+    // Copied video must already be something Discord plays inside MP4
+    return media.hasVideo && media.videoCodec == "h264" &&
+           (media.pixelFormat.isEmpty() || media.pixelFormat == "yuv420p" || media.pixelFormat == "yuvj420p");
+}
+
+bool EncodePlanner::canCopyAudio(const MediaInfo &media)
+{
+    QString codec = media.audioStreams.first().codec;
+    return codec == "aac" || codec == "mp3";
+}
+
+qint64 EncodePlanner::streamBytes(int bitrateKbps, double durationSeconds)
+{
+    return qint64(bitrateKbps * 1000.0 / 8.0 * durationSeconds);
+}
@@ -0,0 +1,47 @@
+#ifndef ENCODEPLANNER_H
+#define ENCODEPLANNER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include "mediainfo.h"
+
+enum class EncodeStrategy {
+    Remux,          // -c copy into MP4, extra audio/subtitle tracks dropped
+    AudioReencode,  // Video copied, first audio track re-encoded to AAC
+    Transcode       // Full video encode
+};
+
+struct EncodePlan {
+    EncodeStrategy strategy;
+    int videoBitrateKbps;  // Transcode only
+    int audioBitrateKbps;  // 0 = no audio track (or copied for Remux)
+    qint64 predictedBytes;
+    QString reason;        // Human readable, for the debug console
+    int shortSide;         // Output short edge in pixels, 0 = source resolution
+    double frameRate;      // Output frame rate, 0 = source frame rate
+};
+
+// Chooses the cheapest way to get a file under the target size by predicting
+// the output size of each option from the probed stream bitrates.
+class EncodePlanner
+{
+public:
+    static EncodePlan plan(const MediaInfo &media, qint64 fileSizeBytes, qint64 targetBytes,
+                           int transcodeVideoKbps, int transcodeAudioKbps);
+    static QString strategyName(EncodeStrategy strategy);
+    
+    // Picks the largest resolution/frame rate rung the video bitrate can fill
+    // with at least MinBitsPerPixel; only ever scales down
+    static void chooseOutputFormat(const MediaInfo &media, EncodePlan &plan);
+    static QStringList videoFilterArgs(const EncodePlan &plan); // -vf scale/fps, empty if none
+    static QString outputFormatName(const MediaInfo &media, const EncodePlan &plan);
+    static QSize outputSize(const MediaInfo &media, const EncodePlan &plan); // After the scale filter
+
+private:
+    static bool canCopyVideo(const MediaInfo &media);
+    static bool canCopyAudio(const MediaInfo &media);
+    static qint64 streamBytes(int bitrateKbps, double durationSeconds);
+};
+
+#endif // ENCODEPLANNER_H
@@ -0,0 +1,83 @@
+#include "encoderbackend.h"
+#ifdef VC_HAVE_LIBAV
+#include "libavencoderbackend.h"
+#endif
+
+ProcessEncoderBackend::ProcessEncoderBackend(QObject *parent)
+    : EncoderBackend(parent)
+    , m_process(new QProcess(this))
+{
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &EncoderBackend::finished);
+
+    // A process that never started doesn't emit finished(); queued because
+    // start() can report it before the caller has returned
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            emit finished(-1, QProcess::CrashExit);
+        }
+    }, Qt::QueuedConnection);
+
+    // Machine-readable progress blocks arrive on stdout
+    connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
+        const QList<FFmpegProgress> blocks = m_parser.feed(m_process->readAllStandardOutput());
+        if (!blocks.isEmpty()) {
+            emit progress(blocks.last());
+        }
+    });
+
+    // stderr only carries log messages now that -nostats is set
+    connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+        const QStringList lines = QString::fromUtf8(m_process->readAllStandardError()).split('\n');
+        for (const QString &line : lines) {
+            QString trimmed = line.trimmed();
+            if (trimmed.length() > 10) {
+                emit logLine(trimmed);
+            }
+        }
+    });
+}
+
+void ProcessEncoderBackend::start(const EncodeTask &task)
+{
+    m_parser = FFmpegProgressParser();
+    m_process->start("ffmpeg", FFmpegProgressParser::arguments() + task.arguments);
+}
+
+void ProcessEncoderBackend::cancel()
+{
+    m_process->disconnect(this);
+    m_process->kill();
+}
+
+bool libavBackendAvailable()
+{
+#ifdef VC_HAVE_LIBAV
+    return true;
+#else
+    return false;
+#endif
+}
+
+EncoderBackendKind encoderBackendFor(EncoderBackendKind preferred, const EncodeTask &task)
+{
+#ifdef VC_HAVE_LIBAV
+    if (preferred == EncoderBackendKind::Libav && LibavEncoderBackend::supports(task)) {
+        return EncoderBackendKind::Libav;
+    }
+#else
+    Q_UNUSED(preferred)
+    Q_UNUSED(task)
+#endif
+    return EncoderBackendKind::Process;
+}
+
+EncoderBackend *createEncoderBackend(EncoderBackendKind preferred, const EncodeTask &task, QObject *parent)
+{
+#ifdef VC_HAVE_LIBAV
+    if (encoderBackendFor(preferred, task) == EncoderBackendKind::Libav) {
+        return new LibavEncoderBackend(parent);
+    }
+#endif
+    return new ProcessEncoderBackend(parent);
+}
@@ -0,0 +1,80 @@
+#ifndef ENCODERBACKEND_H
+#define ENCODERBACKEND_H
+
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include "encoderregistry.h"
+#include "ffmpegprogress.h"
+
+// One encoder run of a job. The ffmpeg command line is always built; the
+// other fields describe the same run for backends that encode in-process.
+struct EncodeTask {
+    QStringList arguments;     // ffmpeg arguments, without the progress ones
+    QString inputPath;
+    QString outputPath;        // Empty for pass 1, which writes no file
+    bool transcode = false;    // False for remux and audio-only re-encode
+    int pass = 0;              // 0 = single run, 1 or 2 of a two-pass encode
+    QString passLogPrefix;     // Two-pass stats are <prefix>-0.log
+    QString encoderName;
+    EncoderOptions encoderOptions; // Preset etc., set on the encoder's private options
+    QString format = "mp4";    // Output muxer
+    int videoBitrateKbps = 0;  // With crf: constrained-quality ceiling, 0 = none
+    int maxRateKbps = 0;       // VBV cap with a two second buffer, 0 = none
+    int crf = -1;              // Capped CRF quality, -1 = bitrate mode
+    int shortSide = 0;         // Output short edge, 0 = source size
+    double frameRate = 0.0;    // Output frame rate, 0 = source rate
+    int threads = 0;
+    QString audioPath;         // Pre-encoded audio, muxed as is
+    int audioBitrateKbps = 0;  // AAC encoded in this run, 0 = none or muxed
+    bool hardwareDecode = false;
+};
+
+enum class EncoderBackendKind {
+    Process, // Spawns ffmpeg, works for every task
+    Libav    // Links libavformat/libavcodec, only when built with VC_HAVE_LIBAV
+};
+
+// Runs one EncodeTask. finished() reports like a finished ffmpeg process so
+// callers handle both backends the same way; it is not emitted after cancel().
+class EncoderBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EncoderBackend(QObject *parent = nullptr) : QObject(parent) {}
+
+    virtual QString name() const = 0;
+    virtual void start(const EncodeTask &task) = 0;
+    virtual void cancel() = 0;
+
+signals:
+    void progress(const FFmpegProgress &progress);
+    void logLine(const QString &line);
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+};
+
+// The original backend: one ffmpeg process per run, progress parsed from
+// `-progress pipe:1` and log lines from stderr
+class ProcessEncoderBackend : public EncoderBackend
+{
+    Q_OBJECT
+
+public:
+    explicit ProcessEncoderBackend(QObject *parent = nullptr);
+
+    QString name() const override { return "ffmpeg"; }
+    void start(const EncodeTask &task) override;
+    void cancel() override;
+
+private:
+    QProcess *m_process;
+    FFmpegProgressParser m_parser;
+};
+
+// Libav when it was compiled in and can run the task, else the ffmpeg process
+bool libavBackendAvailable();
+EncoderBackendKind encoderBackendFor(EncoderBackendKind preferred, const EncodeTask &task);
+EncoderBackend *createEncoderBackend(EncoderBackendKind preferred, const EncodeTask &task, QObject *parent);
+
+#endif // ENCODERBACKEND_H
@@ -0,0 +1,351 @@
+#include "encoderregistry.h"
+
+namespace {
+
+// Speeds and efficiencies are relative to libx264 -preset medium, from
+// published encoder comparisons at 1080p; only their order and rough ratio
+// matter for picking a preset that fits the time budget
+
+class X264Strategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "libx264"; }
+    QString displayName() const override { return "H.264 (x264)"; }
+    QString codec() const override { return "h264"; }
+    bool supportsChunking() const override { return true; }
+    int defaultPreset() const override { return 5; }
+    QList<EncoderPreset> presets() const override
+    {
+        return {{"ultrafast", 8.0, 0.70}, {"superfast", 5.5, 0.78}, {"veryfast", 3.5, 0.88},
+                {"faster", 2.0, 0.94}, {"fast", 1.4, 0.97}, {"medium", 1.0, 1.00},
+                {"slow", 0.6, 1.03}, {"slower", 0.3, 1.05}, {"veryslow", 0.15, 1.06}};
+    }
+    EncoderOptions options(int preset) const override
+    {
+        return {{"preset", presetValue(preset).toUtf8()}};
+    }
+
+    // veryfast to slower share 3 B-frames, B-pyramid and mb-tree; ultrafast
+    // and superfast turn those off and veryslow uses 8 B-frames, which
+    // x264 refuses to pair with stats from the others
+    bool canSwitchPreset(int pass1Preset, int preset) const override
+    {
+        auto shareLayout = [](int step) { return step >= 2 && step <= 7; };
+        return pass1Preset == preset || (shareLayout(pass1Preset) && shareLayout(preset));
+    }
+};
+
+// Not embedded by Discord, so only used when picked explicitly. ffmpeg's
+// -pass does not reach x265, which needs its own stats parameters.
+class X265Strategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "libx265"; }
+    QString displayName() const override { return "HEVC (x265)"; }
+    QString codec() const override { return "hevc"; }
+    bool supportsTwoPass() const override { return false; }
+    int crfValue() const override { return 28; }
+    int defaultPreset() const override { return 5; }
+    QList<EncoderPreset> presets() const override
+    {
+        return {{"ultrafast", 2.0, 0.90}, {"superfast", 1.6, 0.95}, {"veryfast", 1.1, 1.10},
+                {"faster", 0.9, 1.15}, {"fast", 0.6, 1.25}, {"medium", 0.35, 1.35},
+                {"slow", 0.15, 1.42}, {"slower", 0.05, 1.46}, {"veryslow", 0.02, 1.48}};
+    }
+    EncoderOptions options(int preset) const override
+    {
+        return {{"preset", presetValue(preset).toUtf8()}};
+    }
+};
+
+class Vp9Strategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "libvpx-vp9"; }
+    QString displayName() const override { return "VP9 (libvpx)"; }
+    QString codec() const override { return "vp9"; }
+    QString container() const override { return "webm"; }
+    QString audioEncoder() const override { return "libopus"; }
+    int crfValue() const override { return 31; }
+    bool crfTakesBitrate() const override { return true; }
+    int defaultPreset() const override { return 4; }
+    QList<EncoderPreset> presets() const override
+    {
+        return {{"8", 1.5, 0.95}, {"7", 1.1, 1.05}, {"6", 0.8, 1.15}, {"5", 0.45, 1.25},
+                {"4", 0.25, 1.32}, {"3", 0.15, 1.36}, {"2", 0.08, 1.40}, {"1", 0.04, 1.42},
+                {"0", 0.02, 1.43}};
+    }
+    EncoderOptions options(int preset) const override
+    {
+        return {{"deadline", "good"}, {"cpu-used", presetValue(preset).toUtf8()}, {"row-mt", "1"}};
+    }
+};
+
+// SVT-AV1 has no two-pass through ffmpeg's -pass
+class SvtAv1Strategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "libsvtav1"; }
+    QString displayName() const override { return "AV1 (SVT)"; }
+    QString codec() const override { return "av1"; }
+    QString container() const override { return "webm"; }
+    QString audioEncoder() const override { return "libopus"; }
+    bool supportsTwoPass() const override { return false; }
+    int crfValue() const override { return 35; }
+    int defaultPreset() const override { return 4; }
+    QList<EncoderPreset> presets() const override
+    {
+        return {{"12", 3.0, 1.05}, {"11", 2.4, 1.15}, {"10", 1.8, 1.25}, {"9", 1.3, 1.35},
+                {"8", 0.9, 1.42}, {"7", 0.6, 1.48}, {"6", 0.35, 1.53}, {"5", 0.2, 1.57},
+                {"4", 0.1, 1.60}, {"3", 0.05, 1.62}};
+    }
+    EncoderOptions options(int preset) const override
+    {
+        return {{"preset", presetValue(preset).toUtf8()}};
+    }
+};
+
+class AomAv1Strategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "libaom-av1"; }
+    QString displayName() const override { return "AV1 (libaom)"; }
+    QString codec() const override { return "av1"; }
+    QString container() const override { return "webm"; }
+    QString audioEncoder() const override { return "libopus"; }
+    int crfValue() const override { return 30; }
+    bool crfTakesBitrate() const override { return true; }
+    int defaultPreset() const override { return 2; }
+    QList<EncoderPreset> presets() const override
+    {
+        return {{"8", 0.5, 1.35}, {"7", 0.3, 1.45}, {"6", 0.15, 1.52}, {"5", 0.08, 1.57},
+                {"4", 0.04, 1.62}, {"3", 0.02, 1.65}};
+    }
+    EncoderOptions options(int preset) const override
+    {
+        return {{"cpu-used", presetValue(preset).toUtf8()}, {"row-mt", "1"}};
+    }
+};
+
+// Hardware encoders keep ffmpeg's default preset, like before the registry;
+// they have no CRF and only run when hardware acceleration is enabled
+class NvencStrategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "h264_nvenc"; }
+    QString displayName() const override { return "H.264 (NVENC)"; }
+    QString codec() const override { return "h264"; }
+    QString hwaccel() const override { return "cuda"; }
+    bool supportsCrf() const override { return false; }
+};
+
+class QsvStrategy : public EncoderStrategy
+{
+public:
+    QString name() const override { return "h264_qsv"; }
+    QString displayName() const override { return "H.264 (QuickSync)"; }
+    QString codec() const override { return "h264"; }
+    QString hwaccel() const override { return "qsv"; }
+    bool supportsCrf() const override { return false; }
+};
+
+} // namespace
+
+bool EncoderStrategy::playsInDiscord() const
+{
+    if (codec() == "h264") {
+        return container() == "mp4";
+    }
+    if (codec() == "vp9" || codec() == "av1") {
+        return container() == "webm";
+    }
+    return false;
+}
+
+EncoderOptions EncoderStrategy::options(int preset) const
+{
+    Q_UNUSED(preset)
+    return {};
+}
+
+QString EncoderStrategy::presetValue(int preset) const
+{
+    const QList<EncoderPreset> steps = presets();
+    if (preset < 0) {
+        preset = defaultPreset();
+    }
+    return preset >= 0 && preset < steps.size() ? steps.at(preset).value : QString();
+}
+
+double EncoderStrategy::presetSpeed(int preset) const
+{
+    const QList<EncoderPreset> steps = presets();
+    if (preset < 0) {
+        preset = defaultPreset();
+    }
+    return preset >= 0 && preset < steps.size() ? steps.at(preset).speed : 1.0;
+}
+
+QStringList EncoderStrategy::optionArgs(int preset) const
+{
+    QStringList args;
+    const EncoderOptions encoderOptions = options(preset);
+    for (const auto &option : encoderOptions) {
+        if (!option.second.isEmpty()) {
+            args << "-" + QString::fromUtf8(option.first) << QString::fromUtf8(option.second);
+        }
+    }
+    return args;
+}
+
+QStringList EncoderStrategy::videoArgs(int preset, const RateControl &rc) const
+{
+    QStringList args;
+    args << "-c:v" << name()
+         << optionArgs(preset);
+
+    if (rc.crf) {
+        args << "-crf" << QString::number(crfValue());
+        if (crfTakesBitrate()) {
+            args << "-b:v" << QString("%1k").arg(rc.maxRateKbps > 0 ? rc.maxRateKbps : rc.bitrateKbps);
+        }
+    } else {
+        args << "-b:v" << QString("%1k").arg(rc.bitrateKbps);
+    }
+    if (rc.maxRateKbps > 0) {
+        args << "-maxrate" << QString("%1k").arg(rc.maxRateKbps)
+             << "-bufsize" << QString("%1k").arg(rc.maxRateKbps * 2);
+    }
+    if (rc.threads > 0) {
+        args << "-threads" << QString::number(rc.threads);
+    }
+    if (rc.pass > 0) {
+        args << "-pass" << QString::number(rc.pass)
+             << "-passlogfile" << rc.passLogPrefix;
+    }
+    return args;
+}
+
+QString EncoderChoice::description() const
+{
+    if (!encoder) {
+        return QString();
+    }
+    const QList<EncoderPreset> steps = encoder->presets();
+    int step = preset >= 0 ? preset : encoder->defaultPreset();
+    if (step < 0 || step >= steps.size()) {
+        return encoder->displayName();
+    }
+    return encoder->displayName() + " preset " + steps.at(step).value;
+}
+
+EncoderRegistry::EncoderRegistry()
+{
+    m_strategies.emplace_back(new X264Strategy);
+    m_strategies.emplace_back(new Vp9Strategy);
+    m_strategies.emplace_back(new SvtAv1Strategy);
+    m_strategies.emplace_back(new AomAv1Strategy);
+    m_strategies.emplace_back(new X265Strategy);
+    m_strategies.emplace_back(new NvencStrategy);
+    m_strategies.emplace_back(new QsvStrategy);
+
+    // Until the listing arrives, assume the encoder every ffmpeg build has
+    m_available << "libx264";
+}
+
+void EncoderRegistry::setAvailable(const QStringList &ffmpegEncoders)
+{
+    // An empty listing means it could not be read, not a build without x264
+    m_available = ffmpegEncoders.isEmpty() ? QStringList("libx264") : ffmpegEncoders;
+}
+
+QStringList EncoderRegistry::containers() const
+{
+    QStringList result;
+    for (const auto &strategy : m_strategies) {
+        if (!result.contains(strategy->container())) {
+            result.append(strategy->container());
+        }
+    }
+    return result;
+}
+
+QList<const EncoderStrategy *> EncoderRegistry::available() const
+{
+    QList<const EncoderStrategy *> encoders;
+    for (const auto &strategy : m_strategies) {
+        if (m_available.contains(strategy->name())) {
+            encoders.append(strategy.get());
+        }
+    }
+    return encoders;
+}
+
+const EncoderStrategy *EncoderRegistry::find(const QString &name) const
+{
+    for (const auto &strategy : m_strategies) {
+        if (strategy->name() == name) {
+            return m_available.contains(name) ? strategy.get() : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+double EncoderRegistry::estimateSeconds(const EncoderStrategy *encoder, int preset, const Workload &work,
+                                        const EncoderSpeedHistory &speeds)
+{
+    // Encoders without two-pass run once whatever the mode asks for
+    double runs = encoder->supportsTwoPass() ? work.passCost : 1.0;
+    double fps = speeds.estimateFps(encoder->name(), encoder->presetSpeed(preset), work.width, work.height, work.threads);
+    return work.frameCount * runs / fps;
+}
+
+EncoderChoice EncoderRegistry::choosePreset(const EncoderStrategy *encoder, const Workload &work, double budgetSeconds,
+                                            const EncoderSpeedHistory &speeds)
+{
+    EncoderChoice choice;
+    choice.encoder = encoder;
+    const int presetCount = encoder->presets().size();
+    if (presetCount == 0) {
+        choice.estimatedSeconds = estimateSeconds(encoder, -1, work, speeds);
+    }
+    for (int preset = presetCount - 1; preset >= 0; --preset) {
+        choice.preset = preset;
+        choice.estimatedSeconds = estimateSeconds(encoder, preset, work, speeds);
+        if (choice.estimatedSeconds <= budgetSeconds) {
+            break;
+        }
+    }
+    return choice;
+}
+
+EncoderChoice EncoderRegistry::choose(const Workload &work, double budgetSeconds, const EncoderSpeedHistory &speeds) const
+{
+    EncoderChoice best;
+    double bestEfficiency = 0.0;
+
+    for (const EncoderStrategy *encoder : available()) {
+        if (encoder->isHardware() || !encoder->playsInDiscord() || encoder->presets().isEmpty()) {
+            continue;
+        }
+
+        // The slowest preset that still fits is this encoder's best shot
+        EncoderChoice candidate = choosePreset(encoder, work, budgetSeconds, speeds);
+        if (candidate.estimatedSeconds > budgetSeconds) {
+            continue;
+        }
+        double efficiency = encoder->presets().at(candidate.preset).efficiency;
+        if (efficiency > bestEfficiency) {
+            bestEfficiency = efficiency;
+            best = candidate;
+        }
+    }
+
+    if (!best.encoder) {
+        // Over budget whatever runs; the fastest H.264 finishes soonest
+        best.encoder = m_strategies.front().get();
+        best.preset = 0;
+        best.estimatedSeconds = estimateSeconds(best.encoder, 0, work, speeds);
+    }
+    return best;
+}
@@ -0,0 +1,125 @@
+#ifndef ENCODERREGISTRY_H
+#define ENCODERREGISTRY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+#include "encoderspeedhistory.h"
+
+// One step of an encoder's speed knob
+struct EncoderPreset {
+    QString value;      // Value of the encoder's speed option, e.g. "medium" or "8"
+    double speed;       // Frames per second relative to libx264 -preset medium
+    double efficiency;  // Quality per bit relative to libx264 -preset medium
+};
+
+// Rate control of one run, described the same way for every encoder
+struct RateControl {
+    int bitrateKbps = 0;
+    int maxRateKbps = 0;    // VBV cap with a two second buffer, 0 = none
+    bool crf = false;       // Capped CRF instead of a bitrate target
+    int pass = 0;           // 0 = single run, 1 or 2 of a two-pass encode
+    QString passLogPrefix;  // Two-pass stats are <prefix>-0.log
+    int threads = 0;
+};
+
+typedef QList<QPair<QByteArray, QByteArray>> EncoderOptions; // AVOption name/value
+
+// How one ffmpeg video encoder is driven: its container and audio codec,
+// which rate control modes it has, its speed presets and the arguments for a
+// run. The ffmpeg command line and the libav backend both build from here.
+class EncoderStrategy
+{
+public:
+    virtual ~EncoderStrategy() = default;
+
+    virtual QString name() const = 0;        // ffmpeg encoder, e.g. "libx264"
+    virtual QString displayName() const = 0; // e.g. "H.264 (x264)"
+    virtual QString codec() const = 0;       // "h264", "hevc", "vp9" or "av1"
+    virtual QString container() const { return "mp4"; } // Muxer and file extension
+    virtual QString audioEncoder() const { return "aac"; }
+    virtual QString hwaccel() const { return QString(); } // -hwaccel for decoding, empty = software
+    bool isHardware() const { return !hwaccel().isEmpty(); }
+
+    virtual bool supportsCrf() const { return true; }
+    virtual bool supportsTwoPass() const { return true; }
+    virtual bool supportsChunking() const { return false; } // SegmentEncoder's per-chunk passes
+    virtual int crfValue() const { return 23; }
+    virtual bool crfTakesBitrate() const { return false; } // Constrained quality: -b:v is the CRF ceiling
+
+    virtual QList<EncoderPreset> presets() const { return {}; } // Fastest first
+    virtual int defaultPreset() const { return -1; }
+    double presetSpeed(int preset) const; // 1.0 without presets
+
+    // Whether pass 2 may run at another preset than the pass 1 stats came
+    // from; the rate control rejects stats of a different frame type layout
+    virtual bool canSwitchPreset(int pass1Preset, int preset) const { return pass1Preset == preset; }
+
+    // Discord embeds H.264 in MP4 and VP9/AV1 in WebM on desktop, web and
+    // mobile; HEVC only plays where the OS ships a decoder and is otherwise
+    // posted as a download
+    bool playsInDiscord() const;
+
+    // Private encoder options for a preset, e.g. {"preset", "slow"}
+    virtual EncoderOptions options(int preset) const;
+
+    QStringList optionArgs(int preset) const; // options() as -name value pairs
+
+    // -c:v, options, rate control and pass arguments of one ffmpeg run
+    QStringList videoArgs(int preset, const RateControl &rc) const;
+
+protected:
+    QString presetValue(int preset) const; // Empty when out of range
+};
+
+// The encoder picked for one job
+struct EncoderChoice {
+    const EncoderStrategy *encoder = nullptr;
+    int preset = -1;               // Index into encoder->presets(), -1 = encoder default
+    double estimatedSeconds = 0.0; // 0 when not estimated
+
+    QString description() const;   // e.g. "AV1 (SVT) preset 8"
+};
+
+// Known software and hardware encoders, filtered by the -encoders listing of
+// the ffmpeg on PATH. choose() trades quality per bit against encode time.
+class EncoderRegistry
+{
+public:
+    EncoderRegistry();
+
+    void setAvailable(const QStringList &ffmpegEncoders);
+    QList<const EncoderStrategy *> available() const;
+    const EncoderStrategy *find(const QString &name) const; // Null if unknown or not in this build
+    QStringList containers() const; // Every container an output can have, built or not
+
+    // The work of one job and the speed it is estimated at
+    struct Workload {
+        double frameCount = 0.0;
+        int width = 0;
+        int height = 0;
+        double passCost = 1.0; // Runs over the frames, 2 for two-pass
+        int threads = 1;
+    };
+
+    // Best quality per bit among the available Discord-playable software
+    // encoders whose estimated encode time fits the budget. When nothing
+    // fits, the fastest libx264 preset.
+    EncoderChoice choose(const Workload &work, double budgetSeconds, const EncoderSpeedHistory &speeds) const;
+
+    // The slowest preset of one encoder that fits the budget, else its fastest
+    static EncoderChoice choosePreset(const EncoderStrategy *encoder, const Workload &work, double budgetSeconds,
+                                      const EncoderSpeedHistory &speeds);
+    static double estimateSeconds(const EncoderStrategy *encoder, int preset, const Workload &work,
+                                  const EncoderSpeedHistory &speeds);
+
+private:
+    std::vector<std::unique_ptr<EncoderStrategy>> m_strategies; // Preferred first on ties
+    QStringList m_available;
+};
+
+#endif // ENCODERREGISTRY_H
@@ -0,0 +1,111 @@
+#include "encoderspeedhistory.h"
+#include <QSettings>
+#include <QStringList>
+#include <QtMath>
+
+namespace {
+
+const char *const SettingsGroup = "encoderSpeed";
+
+// Short edges of the planner's resolution ladder
+const int ClassShortSides[] = {240, 360, 480, 540, 720, 1080, 1440, 2160};
+
+// libx264 -preset medium at 1080p does roughly 5 fps per thread on a
+// current desktop core; only used until something was measured
+const double DefaultPixelRate = 5.0 * 1920 * 1080;
+
+// Later runs count more, so a new CPU or ffmpeg build takes over quickly
+const double SmoothingWeight = 0.3;
+
+int classShortSide(int width, int height)
+{
+    int shortSide = qMin(width, height);
+    int best = ClassShortSides[0];
+    for (int side : ClassShortSides) {
+        if (qAbs(side - shortSide) < qAbs(best - shortSide)) {
+            best = side;
+        }
+    }
+    return best;
+}
+
+QString classKey(const QString &encoder, int shortSide)
+{
+    return encoder + "/" + QString::number(shortSide) + "p";
+}
+
+} // namespace
+
+EncoderSpeedHistory::EncoderSpeedHistory()
+{
+    QSettings settings;
+    settings.beginGroup(SettingsGroup);
+    const QStringList encoders = settings.childGroups();
+    for (const QString &encoder : encoders) {
+        settings.beginGroup(encoder);
+        const QStringList classes = settings.childKeys();
+        for (const QString &resolution : classes) {
+            double rate = settings.value(resolution).toDouble();
+            if (rate > 0) {
+                m_pixelRates.insert(encoder + "/" + resolution, rate);
+            }
+        }
+        settings.endGroup();
+    }
+    settings.endGroup();
+}
+
+QString EncoderSpeedHistory::resolutionClass(int width, int height)
+{
+    return QString::number(classShortSide(width, height)) + "p";
+}
+
+double EncoderSpeedHistory::pixelRate(const QString &encoder, int shortSide) const
+{
+    double rate = m_pixelRates.value(classKey(encoder, shortSide));
+    if (rate > 0) {
+        return rate;
+    }
+
+    // The nearest measured class; per-pixel cost changes slowly with size
+    int nearestDistance = 100000;
+    for (int side : ClassShortSides) {
+        double candidate = m_pixelRates.value(classKey(encoder, side));
+        if (candidate > 0 && qAbs(side - shortSide) < nearestDistance) {
+            nearestDistance = qAbs(side - shortSide);
+            rate = candidate;
+        }
+    }
+    return rate;
+}
+
+double EncoderSpeedHistory::estimateFps(const QString &encoder, double presetSpeed, int width, int height, int threads) const
+{
+    int shortSide = classShortSide(width, height);
+    double rate = pixelRate(encoder, shortSide);
+    if (rate <= 0) {
+        rate = pixelRate("libx264", shortSide);
+    }
+    if (rate <= 0) {
+        rate = DefaultPixelRate;
+    }
+    double pixels = qMax(1.0, double(width) * height);
+    return rate * qMax(1, threads) * presetSpeed / pixels;
+}
+
+void EncoderSpeedHistory::record(const QString &encoder, double presetSpeed, int width, int height, int threads, double fps)
+{
+    if (fps <= 0 || presetSpeed <= 0 || width <= 0 || height <= 0) {
+        return;
+    }
+    double rate = fps * width * height / (qMax(1, threads) * presetSpeed);
+    QString key = classKey(encoder, classShortSide(width, height));
+    double previous = m_pixelRates.value(key);
+    if (previous > 0) {
+        rate = previous + SmoothingWeight * (rate - previous);
+    }
+    m_pixelRates.insert(key, rate);
+
+    QSettings settings;
+    settings.setValue(QString(SettingsGroup) + "/" + key, rate);
+}
@@ -0,0 +1,30 @@
+#ifndef ENCODERSPEEDHISTORY_H
+#define ENCODERSPEEDHISTORY_H
+
+#include <QHash>
+#include <QString>
+
+// Encode speed measured on this machine, per encoder and resolution class,
+// kept in QSettings across sessions. Speeds are stored as pixels per second
+// per thread at preset speed 1.0 (libx264 -preset medium), so one finished
+// encode also predicts the other presets and, through the presets' relative
+// speeds, encoders that haven't run here yet.
+class EncoderSpeedHistory
+{
+public:
+    EncoderSpeedHistory();
+
+    static QString resolutionClass(int width, int height); // "720p" etc. from the short edge
+
+    // Frames per second of a run; presetSpeed is EncoderStrategy::presetSpeed()
+    double estimateFps(const QString &encoder, double presetSpeed, int width, int height, int threads) const;
+
+    void record(const QString &encoder, double presetSpeed, int width, int height, int threads, double fps);
+
+private:
+    QHash<QString, double> m_pixelRates; // "libx264/720p" -> pixels/s per thread at speed 1.0
+
+    double pixelRate(const QString &encoder, int shortSide) const; // 0 = nothing measured
+};
+
+#endif // ENCODERSPEEDHISTORY_H
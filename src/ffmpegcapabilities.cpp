@@ -0,0 +1,284 @@
+#include "ffmpegcapabilities.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+struct ToolRun {
+    bool started = false;
+    int exitCode = -1;
+    QString output;
+    QString error;
+};
+
+ToolRun runTool(const QString &program, const QStringList &arguments, int timeoutMs)
+{
+    ToolRun run;
+    QProcess process;
+    process.start(program, arguments);
+    run.started = process.waitForStarted(3000);
+    if (!run.started) {
+        return run;
+    }
+    if (!process.waitForFinished(timeoutMs)) {
+        process.kill();
+        process.waitForFinished(1000);
+        return run;
+    }
+    run.exitCode = process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    run.output = QString::fromUtf8(process.readAllStandardOutput());
+    run.error = QString::fromUtf8(process.readAllStandardError());
+    return run;
+}
+
+// " V....D libx264   libx264 H.264 / AVC ..." rows follow a "------" line
+QStringList parseEncoders(const QString &listing)
+{
+    QStringList names;
+    bool inTable = false;
+    const QStringList lines = listing.split('\n');
+    for (const QString &line : lines) {
+        QString trimmed = line.trimmed();
+        if (!inTable) {
+            inTable = trimmed.startsWith("------");
+            continue;
+        }
+        const QStringList fields = trimmed.split(' ', Qt::SkipEmptyParts);
+        if (fields.size() >= 2) {
+            names.append(fields.at(1));
+        }
+    }
+    return names;
+}
+
+// "Hardware acceleration methods:" followed by one name per line
+QStringList parseHwaccels(const QString &listing)
+{
+    QStringList names;
+    const QStringList lines = listing.split('\n');
+    for (const QString &line : lines) {
+        QString trimmed = line.trimmed();
+        if (!trimmed.isEmpty() && !trimmed.endsWith(':')) {
+            names.append(trimmed);
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+FFmpegCapabilities::FFmpegCapabilities()
+    : ffmpegSize(0)
+    , ffmpegModifiedMs(0)
+    , ffprobeModifiedMs(0)
+    , ffmpegWorks(false)
+    , ffprobeWorks(false)
+    , hardwareType("None")
+{
+}
+
+bool FFmpegCapabilities::sameBinaries(const FFmpegCapabilities &other) const
+{
+    return ffmpegPath == other.ffmpegPath && ffprobePath == other.ffprobePath
+        && ffmpegSize == other.ffmpegSize && ffmpegModifiedMs == other.ffmpegModifiedMs
+        && ffprobeModifiedMs == other.ffprobeModifiedMs;
+}
+
+QJsonObject FFmpegCapabilities::toJson() const
+{
+    QJsonObject json;
+    json["ffmpegPath"] = ffmpegPath;
+    json["ffprobePath"] = ffprobePath;
+    json["ffmpegSize"] = ffmpegSize;
+    json["ffmpegModified"] = ffmpegModifiedMs;
+    json["ffprobeModified"] = ffprobeModifiedMs;
+    json["ffmpegWorks"] = ffmpegWorks;
+    json["ffprobeWorks"] = ffprobeWorks;
+    json["ffmpegVersion"] = ffmpegVersion;
+    json["ffprobeVersion"] = ffprobeVersion;
+    json["encoders"] = QJsonArray::fromStringList(encoders);
+    json["hwaccels"] = QJsonArray::fromStringList(hwaccels);
+    json["hardwareType"] = hardwareType;
+    return json;
+}
+
+FFmpegCapabilities FFmpegCapabilities::fromJson(const QJsonObject &json)
+{
+    FFmpegCapabilities capabilities;
+    capabilities.ffmpegPath = json.value("ffmpegPath").toString();
+    capabilities.ffprobePath = json.value("ffprobePath").toString();
+    capabilities.ffmpegSize = json.value("ffmpegSize").toInteger();
+    capabilities.ffmpegModifiedMs = json.value("ffmpegModified").toInteger();
+    capabilities.ffprobeModifiedMs = json.value("ffprobeModified").toInteger();
+    capabilities.ffmpegWorks = json.value("ffmpegWorks").toBool();
+    capabilities.ffprobeWorks = json.value("ffprobeWorks").toBool();
+    capabilities.ffmpegVersion = json.value("ffmpegVersion").toString();
+    capabilities.ffprobeVersion = json.value("ffprobeVersion").toString();
+    for (const QJsonValue &value : json.value("encoders").toArray()) {
+        capabilities.encoders.append(value.toString());
+    }
+    for (const QJsonValue &value : json.value("hwaccels").toArray()) {
+        capabilities.hwaccels.append(value.toString());
+    }
+    capabilities.hardwareType = json.value("hardwareType").toString("None");
+    return capabilities;
+}
+
+FFmpegCapabilityDetector::FFmpegCapabilityDetector(const QString &cachePath, QObject *parent)
+    : QObject(parent)
+    , m_cachePath(cachePath)
+    , m_thread(nullptr)
+{
+}
+
+FFmpegCapabilityDetector::~FFmpegCapabilityDetector()
+{
+    // Every process the worker starts has a timeout, so this wait is bounded
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+FFmpegCapabilities FFmpegCapabilityDetector::locate()
+{
+    FFmpegCapabilities capabilities;
+    capabilities.ffmpegPath = QStandardPaths::findExecutable("ffmpeg");
+    capabilities.ffprobePath = QStandardPaths::findExecutable("ffprobe");
+    if (!capabilities.ffmpegPath.isEmpty()) {
+        QFileInfo info(capabilities.ffmpegPath);
+        capabilities.ffmpegSize = info.size();
+        capabilities.ffmpegModifiedMs = info.lastModified().toMSecsSinceEpoch();
+    }
+    if (!capabilities.ffprobePath.isEmpty()) {
+        capabilities.ffprobeModifiedMs = QFileInfo(capabilities.ffprobePath).lastModified().toMSecsSinceEpoch();
+    }
+    return capabilities;
+}
+
+bool FFmpegCapabilityDetector::lookup(FFmpegCapabilities *capabilities) const
+{
+    FFmpegCapabilities current = locate();
+    if (!current.located()) {
+        *capabilities = current;
+        return true;
+    }
+
+    QFile file(m_cachePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    if (json.value("version").toInt() != FormatVersion) {
+        return false;
+    }
+    FFmpegCapabilities cached = FFmpegCapabilities::fromJson(json);
+    if (!cached.sameBinaries(current)) {
+        return false;
+    }
+    *capabilities = cached;
+    return true;
+}
+
+FFmpegCapabilities FFmpegCapabilityDetector::detectNow()
+{
+    FFmpegCapabilities capabilities = locate();
+    if (!capabilities.located()) {
+        return capabilities;
+    }
+
+    ToolRun ffmpeg = runTool(capabilities.ffmpegPath, QStringList() << "-version", 5000);
+    ToolRun ffprobe = runTool(capabilities.ffprobePath, QStringList() << "-version", 5000);
+    capabilities.ffmpegWorks = ffmpeg.exitCode == 0;
+    capabilities.ffprobeWorks = ffprobe.exitCode == 0;
+    if (!capabilities.ffmpegWorks) {
+        emit debugMessage("FFmpeg -version failed: " + ffmpeg.error.trimmed(), "warning");
+    }
+    if (!capabilities.ffprobeWorks) {
+        emit debugMessage("FFprobe -version failed: " + ffprobe.error.trimmed(), "warning");
+    }
+    if (!capabilities.available()) {
+        // Not cached: a broken install is retried on the next start
+        return capabilities;
+    }
+    capabilities.ffmpegVersion = ffmpeg.output.split('\n').first().trimmed();
+    capabilities.ffprobeVersion = ffprobe.output.split('\n').first().trimmed();
+
+    capabilities.encoders = parseEncoders(runTool(capabilities.ffmpegPath, QStringList() << "-hide_banner" << "-encoders", 5000).output);
+    capabilities.hwaccels = parseHwaccels(runTool(capabilities.ffmpegPath, QStringList() << "-hide_banner" << "-hwaccels", 5000).output);
+
+    // A listed hardware encoder only works with the matching GPU and driver
+    if (!capabilities.encoders.contains("h264_nvenc")) {
+        emit debugMessage("NVENC encoders not found in FFmpeg build", "info");
+    } else if (testEncoder(capabilities.ffmpegPath, "h264_nvenc")) {
+        capabilities.hardwareType = "NVIDIA NVENC (CUDA)";
+    }
+    if (capabilities.hardwareType == "None") {
+        if (!capabilities.encoders.contains("h264_qsv")) {
+            emit debugMessage("QuickSync encoders not found in FFmpeg build", "info");
+        } else if (testEncoder(capabilities.ffmpegPath, "h264_qsv")) {
+            capabilities.hardwareType = "Intel QuickSync";
+        }
+    }
+
+    store(capabilities);
+    return capabilities;
+}
+
+void FFmpegCapabilityDetector::detect()
+{
+    if (isDetecting()) {
+        return;
+    }
+    delete m_thread;
+
+    m_thread = QThread::create([this]() {
+        FFmpegCapabilities capabilities = detectNow();
+        QMetaObject::invokeMethod(this, [this, capabilities]() {
+            emit detected(capabilities);
+        }, Qt::QueuedConnection);
+    });
+    m_thread->start();
+}
+
+bool FFmpegCapabilityDetector::isDetecting() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+bool FFmpegCapabilityDetector::testEncoder(const QString &ffmpegPath, const QString &encoder)
+{
+    QStringList arguments;
+    arguments << "-hide_banner" << "-y" << "-f" << "lavfi"
+              << "-i" << "testsrc=duration=1:size=320x240:rate=1"
+              << "-c:v" << encoder
+              << "-t" << "1"
+              << "-f" << "null" << "-";
+
+    ToolRun run = runTool(ffmpegPath, arguments, 10000);
+    if (run.exitCode != 0) {
+        QString reason = run.started ? run.error.trimmed().split('\n').last().trimmed() : QString("could not start ffmpeg");
+        emit debugMessage(encoder + " test failed: " + reason, "info");
+        return false;
+    }
+    return true;
+}
+
+void FFmpegCapabilityDetector::store(const FFmpegCapabilities &capabilities) const
+{
+    QDir().mkpath(QFileInfo(m_cachePath).absolutePath());
+    QJsonObject json = capabilities.toJson();
+    json["version"] = FormatVersion;
+
+    QSaveFile file(m_cachePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef FFMPEGCAPABILITIES_H
+#define FFMPEGCAPABILITIES_H
+
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+
+// What the ffmpeg/ffprobe on PATH can do. Binaries are identified by path,
+// size and mtime, so an upgrade or reinstall misses the cache and is detected
+// again.
+struct FFmpegCapabilities {
+    QString ffmpegPath;        // Empty when not on PATH
+    QString ffprobePath;
+    qint64 ffmpegSize;
+    qint64 ffmpegModifiedMs;
+    qint64 ffprobeModifiedMs;
+
+    bool ffmpegWorks;
+    bool ffprobeWorks;
+    QString ffmpegVersion;     // First line of -version
+    QString ffprobeVersion;
+    QStringList encoders;      // Names from -encoders, e.g. "libx264", "h264_nvenc"
+    QStringList hwaccels;      // Names from -hwaccels, e.g. "cuda", "qsv"
+    QString hardwareType;      // "NVIDIA NVENC (CUDA)", "Intel QuickSync" or "None"
+
+    FFmpegCapabilities();
+
+    bool available() const { return ffmpegWorks && ffprobeWorks; }
+    bool located() const { return !ffmpegPath.isEmpty() && !ffprobePath.isEmpty(); }
+    bool sameBinaries(const FFmpegCapabilities &other) const;
+
+    QJsonObject toJson() const;
+    static FFmpegCapabilities fromJson(const QJsonObject &json);
+};
+
+// Detects capabilities once per ffmpeg build: one -version per binary, one
+// -encoders and one -hwaccels listing, and a short test encode only for the
+// hardware encoders the build lists. Results are cached on disk, so later
+// starts answer from lookup() without starting a process.
+class FFmpegCapabilityDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FFmpegCapabilityDetector(const QString &cachePath, QObject *parent = nullptr);
+    ~FFmpegCapabilityDetector() override;
+
+    // Paths and file stamps of the binaries on PATH; no process is started
+    static FFmpegCapabilities locate();
+
+    // True when the answer is known without running ffmpeg: a cache hit for
+    // the binaries on PATH, or one of them is missing from PATH
+    bool lookup(FFmpegCapabilities *capabilities) const;
+
+    FFmpegCapabilities detectNow(); // Blocks; stores the result in the cache
+    void detect();                  // detectNow() on a worker thread, then detected()
+    bool isDetecting() const;
+
+signals:
+    void detected(const FFmpegCapabilities &capabilities);
+    void debugMessage(const QString &message, const QString &type);
+
+private:
+    static const int FormatVersion = 1;
+
+    QString m_cachePath;
+    QThread *m_thread;
+
+    bool testEncoder(const QString &ffmpegPath, const QString &encoder); // Encodes to the null muxer
+    void store(const FFmpegCapabilities &capabilities) const;
+};
+
+#endif // FFMPEGCAPABILITIES_H
@@ -0,0 +1,70 @@
+#include "ffmpegprogress.h"
+
+QStringList FFmpegProgressParser::arguments()
+{
+    return QStringList() << "-progress" << "pipe:1" << "-nostats";
+}
+
+QList<FFmpegProgress> FFmpegProgressParser::feed(const QByteArray &data)
+{
+    QList<FFmpegProgress> completed;
+    m_buffer.append(data);
+
+    int start = 0;
+    int newline = m_buffer.indexOf('\n', start);
+    while (newline >= 0) {
+        parseLine(m_buffer.mid(start, newline - start).trimmed(), &completed);
+        start = newline + 1;
+        newline = m_buffer.indexOf('\n', start);
+    }
+    m_buffer.remove(0, start);
+    return completed;
+}
+
+void FFmpegProgressParser::parseLine(const QByteArray &line, QList<FFmpegProgress> *completed)
+{
+    int separator = line.indexOf('=');
+    if (separator <= 0) {
+        return;
+    }
+    QByteArray key = line.left(separator);
+    QByteArray value = line.mid(separator + 1).trimmed();
+
+    // Values are "N/A" until the encoder has produced something
+    bool ok = false;
+    if (key == "frame") {
+        qint64 frame = value.toLongLong(&ok);
+        if (ok) {
+            m_current.frame = frame;
+        }
+    } else if (key == "fps") {
+        double fps = value.toDouble(&ok);
+        if (ok) {
+            m_current.fps = fps;
+        }
+    } else if (key == "speed") {
+        double speed = value.endsWith('x') ? value.chopped(1).trimmed().toDouble(&ok) : 0.0;
+        if (ok) {
+            m_current.speed = speed;
+        }
+    } else if (key == "bitrate") {
+        double bitrate = value.endsWith("kbits/s") ? value.chopped(7).trimmed().toDouble(&ok) : 0.0;
+        if (ok) {
+            m_current.bitrateKbps = bitrate;
+        }
+    } else if (key == "total_size") {
+        qint64 size = value.toLongLong(&ok);
+        if (ok) {
+            m_current.totalSizeBytes = size;
+        }
+    } else if (key == "out_time_us" || key == "out_time_ms") {
+        // out_time_ms is microseconds too, kept for older FFmpeg builds
+        qint64 micros = value.toLongLong(&ok);
+        if (ok && micros >= 0) {
+            m_current.outTimeSeconds = micros / 1000000.0;
+        }
+    } else if (key == "progress") {
+        m_current.ended = value == "end";
+        completed->append(m_current);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef FFMPEGPROGRESS_H
+#define FFMPEGPROGRESS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+
+// One block of `ffmpeg -progress` output, completed by its progress= line
+struct FFmpegProgress {
+    qint64 frame = 0;
+    double fps = 0.0;
+    double speed = 0.0;          // Realtime multiple, 0 while unknown
+    double bitrateKbps = 0.0;    // Output bitrate so far
+    qint64 totalSizeBytes = 0;   // Output bytes so far
+    double outTimeSeconds = 0.0; // Media time encoded so far
+    bool ended = false;          // progress=end, the last block
+};
+
+// Line-buffered parser for the key=value blocks FFmpeg writes with
+// `-progress pipe:1`. Partial lines are kept until the rest arrives, so
+// blocks split across reads are never lost.
+class FFmpegProgressParser
+{
+public:
+    // Arguments that route progress to stdout and silence the stderr stats line
+    static QStringList arguments();
+
+    // Returns every block completed by this chunk of stdout, oldest first
+    QList<FFmpegProgress> feed(const QByteArray &data);
+
+private:
+    QByteArray m_buffer;
+    FFmpegProgress m_current;
+
+    void parseLine(const QByteArray &line, QList<FFmpegProgress> *completed);
+};
+
+#endif // FFMPEGPROGRESS_H
@@ -0,0 +1,129 @@
+#include "filedelivery.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+namespace {
+
+// Large enough that a copy is a few hundred syscalls per 50 MB output
+const qint64 CopyBufferBytes = 8 * 1024 * 1024;
+
+} // namespace
+
+FileDelivery::Method FileDelivery::deliver(const QString &sourcePath, const QString &targetPath, Source source)
+{
+    if (!QFileInfo::exists(sourcePath) || QFileInfo::exists(targetPath)) {
+        return Method::Failed;
+    }
+
+    // Each of these fails fast across filesystems, so trying costs nothing
+    if (source == Source::Movable && QFile::rename(sourcePath, targetPath)) {
+        return Method::Rename;
+    }
+    // A hardlink shares the inode, so editing one name edits the other;
+    // fine for outputs the app wrote, not for the user's originals
+    if (source != Source::User && hardlink(sourcePath, targetPath)) {
+        return Method::Hardlink;
+    }
+    if (reflink(sourcePath, targetPath)) {
+        return Method::Reflink;
+    }
+    return streamCopy(sourcePath, targetPath) ? Method::Copy : Method::Failed;
+}
+
+QString FileDelivery::methodName(Method method)
+{
+    switch (method) {
+    case Method::Rename:
+        return "moved";
+    case Method::Hardlink:
+        return "hardlinked";
+    case Method::Reflink:
+        return "reflinked";
+    case Method::Copy:
+        return "copied";
+    case Method::Failed:
+        break;
+    }
+    return "failed";
+}
+
+bool FileDelivery::hardlink(const QString &sourcePath, const QString &targetPath)
+{
+#ifdef Q_OS_WIN
+    QString target = QDir::toNativeSeparators(targetPath);
+    QString source = QDir::toNativeSeparators(sourcePath);
+    return CreateHardLinkW(reinterpret_cast<LPCWSTR>(target.utf16()), reinterpret_cast<LPCWSTR>(source.utf16()), nullptr);
+#else
+    return ::link(QFile::encodeName(sourcePath).constData(), QFile::encodeName(targetPath).constData()) == 0;
+#endif
+}
+
+bool FileDelivery::reflink(const QString &sourcePath, const QString &targetPath)
+{
+#ifdef Q_OS_LINUX
+    int source = ::open(QFile::encodeName(sourcePath).constData(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return false;
+    }
+    int target = ::open(QFile::encodeName(targetPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (target < 0) {
+        ::close(source);
+        return false;
+    }
+    bool cloned = ::ioctl(target, FICLONE, source) == 0;
+    ::close(target);
+    ::close(source);
+    if (!cloned) {
+        // Not supported here (ext4, tmpfs, across filesystems); leave no empty file behind
+        QFile::remove(targetPath);
+    }
+    return cloned;
+#else
+    Q_UNUSED(sourcePath);
+    Q_UNUSED(targetPath);
+    return false;
+#endif
+}
+
+bool FileDelivery::streamCopy(const QString &sourcePath, const QString &targetPath)
+{
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Written next to the target and renamed into place, so a failed copy
+    // never leaves a truncated file under the final name
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QByteArray buffer(CopyBufferBytes, Qt::Uninitialized);
+    qint64 read = 0;
+    while ((read = source.read(buffer.data(), buffer.size())) > 0) {
+        if (target.write(buffer.constData(), read) != read) {
+            target.cancelWriting();
+            return false;
+        }
+    }
+    if (read < 0) {
+        target.cancelWriting();
+        return false;
+    }
+    return target.commit();
+}
@@ -0,0 +1,38 @@
+#ifndef FILEDELIVERY_H
+#define FILEDELIVERY_H
+
+#include <QString>
+
+// Puts a finished output at its destination with as little I/O as the
+// filesystems allow: a rename when the source may be moved, then a hardlink
+// for files the app owns, then a FICLONE reflink on Linux, and a streaming
+// copy only when none of those apply. An existing destination is never
+// overwritten.
+class FileDelivery
+{
+public:
+    enum class Method {
+        Failed,
+        Rename,     // Source moved, same filesystem
+        Hardlink,   // Second name for the same data, same filesystem
+        Reflink,    // Copy-on-write clone (Btrfs, XFS, bcachefs)
+        Copy        // Bytes streamed through a large buffer
+    };
+
+    // What may happen to the source
+    enum class Source {
+        User,       // The user's own file: reflink or copy, never shared with the result
+        Owned,      // An app output that must stay in place: may also be hardlinked
+        Movable     // An app output nothing else needs: may also be moved
+    };
+
+    static Method deliver(const QString &sourcePath, const QString &targetPath, Source source);
+    static QString methodName(Method method);
+
+private:
+    static bool hardlink(const QString &sourcePath, const QString &targetPath);
+    static bool reflink(const QString &sourcePath, const QString &targetPath);
+    static bool streamCopy(const QString &sourcePath, const QString &targetPath);
+};
+
+#endif // FILEDELIVERY_H
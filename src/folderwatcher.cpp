@@ -0,0 +1,153 @@
+#include "folderwatcher.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+namespace {
+
+// Directory events arrive in bursts while files are being copied
+const int ScanDebounceMs = 500;
+
+// A file is ready once two checks a second apart see the same size and mtime
+const int StabilityIntervalMs = 1000;
+const int RequiredStableChecks = 2;
+
+} // namespace
+
+FolderWatcher::FolderWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_scanTimer.setSingleShot(true);
+    m_scanTimer.setInterval(ScanDebounceMs);
+    m_stabilityTimer.setInterval(StabilityIntervalMs);
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onDirectoryChanged);
+    connect(&m_scanTimer, &QTimer::timeout, this, &FolderWatcher::scanDirtyInboxes);
+    connect(&m_stabilityTimer, &QTimer::timeout, this, &FolderWatcher::checkCandidates);
+}
+
+bool FolderWatcher::addInbox(const QString &path)
+{
+    QString inbox = QFileInfo(path).absoluteFilePath();
+    if (!QFileInfo(inbox).isDir() || !m_watcher.addPath(inbox)) {
+        emit debugMessage("Cannot watch folder: " + path, "error");
+        return false;
+    }
+
+    emit debugMessage("Watching inbox: " + QDir::toNativeSeparators(inbox), "info");
+
+    // Files already waiting in the inbox are picked up like new arrivals
+    m_knownFiles.insert(inbox, QSet<QString>());
+    onDirectoryChanged(inbox);
+    return true;
+}
+
+void FolderWatcher::onDirectoryChanged(const QString &path)
+{
+    m_dirtyInboxes.insert(path);
+    if (!m_scanTimer.isActive()) {
+        m_scanTimer.start();
+    }
+}
+
+void FolderWatcher::scanDirtyInboxes()
+{
+    const QSet<QString> inboxes = m_dirtyInboxes;
+    m_dirtyInboxes.clear();
+
+    for (const QString &inbox : inboxes) {
+        QDir dir(inbox);
+        const QStringList names = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+        QSet<QString> current(names.begin(), names.end());
+        QSet<QString> &known = m_knownFiles[inbox];
+
+        // Forget deleted files so the same name can arrive again later
+        for (auto it = known.begin(); it != known.end(); ) {
+            if (!current.contains(*it)) {
+                m_candidates.remove(dir.absoluteFilePath(*it));
+                it = known.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        int added = 0;
+        for (const QString &name : names) {
+            if (known.contains(name) || isPartialDownload(name)) {
+                continue;
+            }
+            known.insert(name);
+
+            Candidate candidate;
+            candidate.size = -1;
+            candidate.stableChecks = 0;
+            m_candidates.insert(dir.absoluteFilePath(name), candidate);
+            added++;
+        }
+
+        if (added > 0) {
+            emit debugMessage(QString("Inbox %1: %2 new files, waiting for them to finish writing")
+                             .arg(QDir::toNativeSeparators(inbox))
+                             .arg(added), "info");
+        }
+    }
+
+    if (!m_candidates.isEmpty() && !m_stabilityTimer.isActive()) {
+        m_stabilityTimer.start();
+    }
+}
+
+void FolderWatcher::checkCandidates()
+{
+    QStringList ready;
+    for (auto it = m_candidates.begin(); it != m_candidates.end(); ) {
+        QFileInfo info(it.key());
+        if (!info.exists()) {
+            it = m_candidates.erase(it);
+            continue;
+        }
+
+        Candidate &candidate = it.value();
+        if (info.size() > 0 && info.size() == candidate.size && info.lastModified() == candidate.modified) {
+            candidate.stableChecks++;
+        } else {
+            candidate.size = info.size();
+            candidate.modified = info.lastModified();
+            candidate.stableChecks = 0;
+        }
+
+        // Writers that hold the file exclusively (Windows) still block reading
+        if (candidate.stableChecks >= RequiredStableChecks) {
+            QFile file(it.key());
+            if (file.open(QIODevice::ReadOnly)) {
+                file.close();
+                ready.append(it.key());
+                it = m_candidates.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+
+    if (m_candidates.isEmpty()) {
+        m_stabilityTimer.stop();
+    }
+
+    // Emit after the loop, receivers may add inboxes or files
+    ready.sort();
+    for (const QString &path : std::as_const(ready)) {
+        emit fileReady(path);
+    }
+}
+
+bool FolderWatcher::isPartialDownload(const QString &fileName)
+{
+    // Browsers and copy tools write under a temporary name and rename at the end
+    static const QStringList partialSuffixes = {".part", ".partial", ".tmp", ".crdownload", ".download"};
+    for (const QString &suffix : partialSuffixes) {
+        if (fileName.endsWith(suffix, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return fileName.startsWith('.') || fileName.startsWith('~');
+}
@@ -0,0 +1,54 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+// Watches inbox folders for new files and reports each one once it has
+// stopped growing. Directory events are debounced and only the changed
+// folder is listed; the listing is diffed against the names already seen,
+// so a burst of hundreds of files costs one scan, and the stability check
+// only stats files that are still pending.
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderWatcher(QObject *parent = nullptr);
+
+    bool addInbox(const QString &path);
+    QStringList inboxes() const { return m_watcher.directories(); }
+    int pendingCount() const { return m_candidates.size(); }
+
+signals:
+    void fileReady(const QString &path);
+    void debugMessage(const QString &message, const QString &type = "info");
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+    void scanDirtyInboxes();
+    void checkCandidates();
+
+private:
+    struct Candidate {
+        qint64 size;
+        QDateTime modified;
+        int stableChecks; // Consecutive checks without a size/mtime change
+    };
+
+    QFileSystemWatcher m_watcher;
+    QSet<QString> m_dirtyInboxes;
+    QHash<QString, QSet<QString>> m_knownFiles; // Inbox -> file names already seen
+    QHash<QString, Candidate> m_candidates;     // Absolute path -> last stat
+    QTimer m_scanTimer;      // Debounces directory events
+    QTimer m_stabilityTimer; // Runs only while candidates are pending
+
+    static bool isPartialDownload(const QString &fileName);
+};
+
+#endif // FOLDERWATCHER_H
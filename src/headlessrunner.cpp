@@ -0,0 +1,468 @@
+#include "headlessrunner.h"
+#include "filedelivery.h"
+#include "folderwatcher.h"
+#include "videocompressor.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+const char *const ModeNames[] = {"two-pass", "single-pass", "capped-crf"};
+
+void writeStderr(const QString &line)
+{
+    fputs(line.toLocal8Bit().constData(), stderr);
+    fputs("\n", stderr);
+    fflush(stderr);
+}
+
+} // namespace
+
+HeadlessRunner::HeadlessRunner(VideoCompressor *compressor, const HeadlessOptions &options, QObject *parent)
+    : QObject(parent)
+    , m_compressor(compressor)
+    , m_watcher(nullptr)
+    , m_options(options)
+    , m_failedCount(0)
+    , m_pendingDeliveries(0)
+    , m_summaryPending(false)
+    , m_summaryTotal(0)
+    , m_done(false)
+{
+    connect(m_compressor, &VideoCompressor::dataChanged, this, &HeadlessRunner::onDataChanged);
+    connect(m_compressor, &VideoCompressor::compressionFinished, this, &HeadlessRunner::onCompressionFinished);
+    connect(m_compressor, &VideoCompressor::debugMessage, this, &HeadlessRunner::onDebugMessage);
+    connect(m_compressor, &VideoCompressor::error, this, &HeadlessRunner::onError);
+}
+
+void HeadlessRunner::start()
+{
+    if (!m_compressor->ffmpegAvailable()) {
+        onError("FFmpeg/FFprobe not found in PATH");
+        finish(FFmpegMissing);
+        return;
+    }
+
+    if (!QDir().mkpath(m_options.outputDir)) {
+        onError("Cannot create output folder " + m_options.outputDir);
+        finish(UsageError);
+        return;
+    }
+
+    m_compressor->setTargetSizeMB(m_options.targetSizeMB);
+    m_compressor->setMaxConcurrentJobs(m_options.maxConcurrentJobs);
+    m_compressor->setEncodingMode(m_options.encodingMode);
+    m_compressor->setHardwareAccelerationEnabled(m_options.hardwareAcceleration);
+    m_compressor->setEncoderPreference(m_options.encoder);
+    m_compressor->setEncodeTimeBudget(m_options.timeBudget);
+    m_compressor->setDeadlinePerBatch(m_options.deadlinePerBatch);
+    m_compressor->setEncodeDeadlineSeconds(m_options.deadlineSeconds);
+    if (m_options.directOutput) {
+        m_compressor->setOutputFolder(m_options.outputDir);
+    }
+
+    if (m_options.watch) {
+        startWatching();
+        return;
+    }
+
+    for (const QString &input : std::as_const(m_options.inputs)) {
+        addInput(input);
+    }
+    if (m_compressor->totalCount() == 0) {
+        onError("No video files among the inputs");
+        finish(NoInputs);
+        return;
+    }
+
+    m_batchTimer.start();
+    m_compressor->startCompression();
+
+    // A batch of only already-optimal files finishes inside startCompression()
+    if (!m_compressor->isCompressing()) {
+        onCompressionFinished();
+    }
+}
+
+void HeadlessRunner::addInput(const QString &input)
+{
+    QFileInfo info(input);
+    if (info.isDir()) {
+        const QFileInfoList files = QDir(info.absoluteFilePath()).entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo &file : files) {
+            m_compressor->addVideoFromPath(file.absoluteFilePath());
+        }
+    } else if (info.exists()) {
+        m_compressor->addVideoFromPath(info.absoluteFilePath());
+    } else {
+        onError("Input not found: " + input);
+    }
+}
+
+void HeadlessRunner::startWatching()
+{
+    m_watcher = new FolderWatcher(this);
+    connect(m_watcher, &FolderWatcher::fileReady, this, &HeadlessRunner::onFileReady);
+    connect(m_watcher, &FolderWatcher::debugMessage, this, &HeadlessRunner::onDebugMessage);
+
+    for (const QString &input : std::as_const(m_options.inputs)) {
+        // Outputs written into a watched folder would be compressed again
+        if (QFileInfo(input) == QFileInfo(m_options.outputDir)) {
+            onError("The output folder cannot be one of the watched folders: " + input);
+            finish(UsageError);
+            return;
+        }
+        if (!m_watcher->addInbox(input)) {
+            finish(UsageError);
+            return;
+        }
+    }
+}
+
+void HeadlessRunner::onFileReady(const QString &path)
+{
+    if (alreadyDelivered(path)) {
+        onDebugMessage("Skipping " + QFileInfo(path).fileName() + ", its output is already in the output folder", "info");
+        return;
+    }
+
+    if (m_compressor->isCompressing()) {
+        m_compressor->enqueueVideo(path);
+        return;
+    }
+    if (m_pendingDeliveries > 0) {
+        // The last batch's copies are still running; its summary and failure
+        // count must not mix with the next batch
+        m_waitingFiles.append(path);
+        return;
+    }
+
+    startBatch(QStringList() << path);
+}
+
+void HeadlessRunner::startBatch(const QStringList &paths)
+{
+    m_compressor->clearVideos();
+    m_reported.clear();
+    m_jobStartMs.clear();
+    m_failedCount = 0;
+    for (const QString &path : paths) {
+        m_compressor->addVideoFromPath(path);
+    }
+    if (m_compressor->totalCount() == 0) {
+        return; // Not a video
+    }
+
+    m_batchTimer.start();
+    m_compressor->startCompression();
+    if (!m_compressor->isCompressing()) {
+        onCompressionFinished();
+    }
+}
+
+bool HeadlessRunner::alreadyDelivered(const QString &inputPath) const
+{
+    // Lets a restarted watcher skip files it handled before it went down
+    QFileInfo input(inputPath);
+    QDir outputDir(m_options.outputDir);
+    const QStringList names = m_compressor->outputFileNames(inputPath) << input.fileName();
+    for (const QString &name : names) {
+        QFileInfo output(outputDir.absoluteFilePath(name));
+        if (output.exists() && output.lastModified() >= input.lastModified()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HeadlessRunner::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!m_batchTimer.isValid()) {
+        return;
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        VideoStatus status = static_cast<VideoStatus>(m_compressor->index(row).data(VideoCompressor::StatusRole).toInt());
+        if (status == VideoStatus::Compressing && !m_jobStartMs.contains(row)) {
+            m_jobStartMs.insert(row, m_batchTimer.elapsed());
+        } else if (status == VideoStatus::Completed || status == VideoStatus::AlreadyOptimal ||
+                   status == VideoStatus::Error) {
+            reportRow(row);
+        }
+    }
+}
+
+void HeadlessRunner::reportRow(int row)
+{
+    if (m_reported.contains(row)) {
+        return;
+    }
+    m_reported.insert(row);
+
+    QModelIndex index = m_compressor->index(row);
+    VideoStatus status = static_cast<VideoStatus>(index.data(VideoCompressor::StatusRole).toInt());
+    QString inputPath = index.data(VideoCompressor::PathRole).toString();
+    qint64 targetBytes = qint64(m_compressor->targetSizeMB()) * 1024 * 1024;
+
+    QJsonObject job;
+    job["event"] = "job";
+    job["input"] = QDir::toNativeSeparators(inputPath);
+    job["message"] = index.data(VideoCompressor::StatusTextRole).toString();
+    job["mode"] = index.data(VideoCompressor::EncodeModeRole).toString();
+    job["inputBytes"] = QFileInfo(inputPath).size();
+    job["targetBytes"] = targetBytes;
+    job["elapsedSeconds"] = (m_batchTimer.elapsed() - m_jobStartMs.value(row, m_batchTimer.elapsed())) / 1000.0;
+    job["status"] = status == VideoStatus::AlreadyOptimal ? "already_optimal" : "completed";
+
+    if (status == VideoStatus::Error) {
+        job["status"] = "error";
+        onDelivered(job, QString());
+        return;
+    }
+
+    // Copy-out is its own stage on the thread pool, so a large copy never
+    // holds up the event loop that starts the next encode. Encoded outputs
+    // live in this run's own temp folder and may be moved; AlreadyOptimal
+    // rows deliver the user's original, which is only ever copied.
+    QString outputPath = index.data(VideoCompressor::OutputPathRole).toString();
+    QString outputDir = m_options.outputDir;
+    bool encoded = status == VideoStatus::Completed;
+    m_pendingDeliveries++;
+    QThreadPool::globalInstance()->start([this, job, outputPath, outputDir, encoded]() {
+        QString delivered = deliver(outputPath, outputDir, encoded);
+        QMetaObject::invokeMethod(this, [this, job, delivered]() {
+            m_pendingDeliveries--;
+            onDelivered(job, delivered);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void HeadlessRunner::onDelivered(QJsonObject job, const QString &output)
+{
+    if (!output.isEmpty()) {
+        qint64 outputBytes = QFileInfo(output).size();
+        job["output"] = QDir::toNativeSeparators(output);
+        job["outputBytes"] = outputBytes;
+        job["sizeErrorPercent"] = (double(outputBytes) / job["targetBytes"].toDouble() - 1.0) * 100;
+    } else {
+        if (job["status"].toString() != "error") {
+            job["message"] = "Could not copy the output to " + m_options.outputDir;
+        }
+        job["status"] = "error";
+        m_failedCount++;
+    }
+    writeJson(job);
+
+    if (m_summaryPending && m_pendingDeliveries == 0) {
+        writeSummary();
+    }
+    if (!m_summaryPending && m_pendingDeliveries == 0 && !m_waitingFiles.isEmpty() && !m_done) {
+        QStringList paths = m_waitingFiles;
+        m_waitingFiles.clear();
+        startBatch(paths);
+    }
+}
+
+QString HeadlessRunner::deliver(const QString &outputPath, const QString &outputDir, bool encoded)
+{
+    if (outputPath.isEmpty() || !QFileInfo::exists(outputPath)) {
+        return QString();
+    }
+
+    QString targetPath = QDir(outputDir).absoluteFilePath(QFileInfo(outputPath).fileName());
+    if (QFileInfo(targetPath) == QFileInfo(outputPath)) {
+        return targetPath; // Already optimal and already in the output folder
+    }
+
+    // Files already in the output folder are kept; the new one gets a free name
+    QFileInfo target(targetPath);
+    for (int copy = 2; QFileInfo::exists(targetPath); ++copy) {
+        targetPath = target.absolutePath() + "/" + target.completeBaseName() + "_" + QString::number(copy) +
+                     (target.suffix().isEmpty() ? QString() : "." + target.suffix());
+    }
+    FileDelivery::Source source = encoded ? FileDelivery::Source::Movable : FileDelivery::Source::User;
+    return FileDelivery::deliver(outputPath, targetPath, source) != FileDelivery::Method::Failed ? targetPath : QString();
+}
+
+void HeadlessRunner::onCompressionFinished()
+{
+    if (m_done) {
+        return;
+    }
+
+    // Rows that never changed state after the batch started (none expected)
+    for (int row = 0; row < m_compressor->totalCount(); ++row) {
+        reportRow(row);
+    }
+
+    // The summary waits for the last copy to the output folder
+    m_summaryTotal = m_compressor->totalCount();
+    m_summaryPending = true;
+    if (m_pendingDeliveries == 0) {
+        writeSummary();
+    }
+}
+
+void HeadlessRunner::writeSummary()
+{
+    m_summaryPending = false;
+
+    QJsonObject summary;
+    summary["event"] = "summary";
+    summary["total"] = m_summaryTotal;
+    summary["succeeded"] = m_summaryTotal - m_failedCount;
+    summary["failed"] = m_failedCount;
+    summary["elapsedSeconds"] = m_batchTimer.elapsed() / 1000.0;
+    writeJson(summary);
+
+    // Watch mode keeps waiting for the next file
+    if (!m_options.watch) {
+        finish(m_failedCount > 0 ? JobsFailed : Success);
+    }
+}
+
+void HeadlessRunner::onDebugMessage(const QString &message, const QString &type)
+{
+    if (m_options.verbose || type == "warning" || type == "error") {
+        writeStderr("[" + type + "] " + message);
+    }
+}
+
+void HeadlessRunner::onError(const QString &message)
+{
+    writeStderr("[error] " + message);
+}
+
+void HeadlessRunner::finish(int exitCode)
+{
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    emit finished(exitCode);
+}
+
+void HeadlessRunner::writeJson(const QJsonObject &object)
+{
+    fputs(QJsonDocument(object).toJson(QJsonDocument::Compact).constData(), stdout);
+    fputs("\n", stdout);
+    fflush(stdout);
+}
+
+int HeadlessRunner::run(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Video Compressor");
+    app.setApplicationVersion("1.0");
+    app.setOrganizationName("VideoCompressor");
+
+#ifdef Q_OS_WIN
+    // Release builds use the GUI subsystem; write to the console we were started from
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+#endif
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compress videos to a target size without the GUI. "
+                                     "Prints one JSON object per job to stdout.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption headlessOption("headless", "Run without the GUI.");
+    QCommandLineOption targetOption(QStringList() << "t" << "target-size", "Target size in MB (default 10).", "MB", "10");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Parallel jobs, 0 = auto (default).", "count", "0");
+    QCommandLineOption outputOption(QStringList() << "o" << "output-dir", "Folder for the compressed files (default: current folder).",
+                                    "dir", QDir::currentPath());
+    QCommandLineOption modeOption(QStringList() << "m" << "mode", "two-pass (default), single-pass or capped-crf.", "mode", "two-pass");
+    QCommandLineOption hwOption("hw", "Use the hardware encoder when one is available.");
+    QCommandLineOption encoderOption("encoder", "libx264 (default), libvpx-vp9, libsvtav1, libaom-av1, libx265, or auto to pick "
+                                                "the best Discord-playable encoder within the time budget.", "name", "libx264");
+    QCommandLineOption budgetOption("time-budget", "Encode seconds allowed per second of video for --encoder auto (default 1).",
+                                    "factor", "1");
+    QCommandLineOption deadlineOption("deadline", "Wall-clock seconds each video may take; picks the slowest preset that "
+                                                  "finishes in time from the speeds measured on this machine (default 0 = off).",
+                                      "seconds", "0");
+    QCommandLineOption deadlineBatchOption("deadline-batch", "Apply --deadline to the whole batch instead of each video.");
+    QCommandLineOption directOption("direct-output", "Write pass 2 straight into the output folder, with no copy step. "
+                                                     "Files being encoded show up there under their final name.");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Print every debug message to stderr.");
+    QCommandLineOption watchOption("watch", "Treat the inputs as inbox folders and compress new files as they arrive, "
+                                            "until stopped.");
+    parser.addOption(headlessOption);
+    parser.addOption(targetOption);
+    parser.addOption(jobsOption);
+    parser.addOption(outputOption);
+    parser.addOption(modeOption);
+    parser.addOption(hwOption);
+    parser.addOption(encoderOption);
+    parser.addOption(budgetOption);
+    parser.addOption(deadlineOption);
+    parser.addOption(deadlineBatchOption);
+    parser.addOption(directOption);
+    parser.addOption(verboseOption);
+    parser.addOption(watchOption);
+    parser.addPositionalArgument("inputs", "Video files or folders to compress (folders to watch with --watch).", "<input>...");
+
+    if (!parser.parse(app.arguments())) {
+        writeStderr(parser.errorText());
+        return UsageError;
+    }
+    if (parser.isSet("help")) {
+        parser.showHelp(Success);
+    }
+    if (parser.isSet("version")) {
+        parser.showVersion();
+    }
+
+    HeadlessOptions options;
+    bool targetOk = false;
+    bool jobsOk = false;
+    bool budgetOk = false;
+    bool deadlineOk = false;
+    options.inputs = parser.positionalArguments();
+    options.outputDir = QDir(parser.value(outputOption)).absolutePath();
+    options.targetSizeMB = parser.value(targetOption).toInt(&targetOk);
+    options.maxConcurrentJobs = parser.value(jobsOption).toInt(&jobsOk);
+    options.encodingMode = -1;
+    for (int mode = 0; mode < 3; ++mode) {
+        if (parser.value(modeOption) == ModeNames[mode]) {
+            options.encodingMode = mode;
+        }
+    }
+    options.hardwareAcceleration = parser.isSet(hwOption);
+    options.encoder = parser.value(encoderOption);
+    options.timeBudget = parser.value(budgetOption).toDouble(&budgetOk);
+    options.deadlineSeconds = parser.value(deadlineOption).toInt(&deadlineOk);
+    options.deadlinePerBatch = parser.isSet(deadlineBatchOption);
+    options.directOutput = parser.isSet(directOption);
+    options.verbose = parser.isSet(verboseOption);
+    options.watch = parser.isSet(watchOption);
+
+    if (options.inputs.isEmpty() || !targetOk || options.targetSizeMB <= 0 ||
+        !jobsOk || options.maxConcurrentJobs < 0 || options.encodingMode < 0 ||
+        !budgetOk || options.timeBudget <= 0 || !deadlineOk || options.deadlineSeconds < 0) {
+        writeStderr("Invalid arguments, see --help");
+        return UsageError;
+    }
+
+    VideoCompressor compressor;
+    HeadlessRunner runner(&compressor, options);
+    QObject::connect(&runner, &HeadlessRunner::finished, &app, [](int exitCode) {
+        QCoreApplication::exit(exitCode);
+    });
+
+    // Start inside the event loop so an early finish() can still exit it
+    QTimer::singleShot(0, &runner, &HeadlessRunner::start);
+    return app.exec();
+}
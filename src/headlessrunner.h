@@ -0,0 +1,94 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QModelIndex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class FolderWatcher;
+class VideoCompressor;
+
+struct HeadlessOptions {
+    QStringList inputs;     // Files or folders (top level only)
+    QString outputDir;
+    int targetSizeMB;
+    int maxConcurrentJobs;  // 0 = derive from core count
+    int encodingMode;       // EncodingMode
+    bool hardwareAcceleration;
+    QString encoder;        // "auto" or an ffmpeg encoder name
+    double timeBudget;      // Encode seconds per second of video for "auto"
+    int deadlineSeconds;    // Wall-clock deadline, 0 = use the time budget
+    bool deadlinePerBatch;  // The deadline covers the whole batch
+    bool directOutput;      // Encode straight into outputDir instead of delivering from the temp folder
+    bool verbose;           // Forward every debug message to stderr
+    bool watch;             // Keep running and compress files as they land in the input folders
+};
+
+// Drives VideoCompressor without QML for `--headless` runs: adds the inputs,
+// starts the batch, copies each finished output to the output folder and
+// prints one JSON object per job to stdout (JSON Lines). Diagnostics go to
+// stderr so stdout stays machine-readable. With `--watch` the inputs are
+// inbox folders and the runner never exits on its own: each file that
+// finishes arriving joins the running batch or starts a new one.
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ExitCode {
+        Success = 0,        // Every input ended Completed or AlreadyOptimal
+        JobsFailed = 1,     // At least one input ended in Error
+        UsageError = 2,
+        FFmpegMissing = 3,
+        NoInputs = 4        // No input was a readable video
+    };
+
+    HeadlessRunner(VideoCompressor *compressor, const HeadlessOptions &options, QObject *parent = nullptr);
+
+    void start();
+
+    // Entry point for `--headless`: builds a QCoreApplication, parses the
+    // command line and returns the process exit code
+    static int run(int argc, char *argv[]);
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onCompressionFinished();
+    void onDebugMessage(const QString &message, const QString &type);
+    void onError(const QString &message);
+    void onFileReady(const QString &path);
+
+private:
+    VideoCompressor *m_compressor;
+    FolderWatcher *m_watcher;
+    HeadlessOptions m_options;
+    QElapsedTimer m_batchTimer;
+    QHash<int, qint64> m_jobStartMs; // Row -> batch time it started encoding
+    QSet<int> m_reported;
+    int m_failedCount;
+    int m_pendingDeliveries; // Copies to the output folder still running
+    bool m_summaryPending;   // Batch finished, summary waits for the copies
+    int m_summaryTotal;
+    QStringList m_waitingFiles; // Arrived while the last batch's copies were running
+    bool m_done;
+
+    void addInput(const QString &input);
+    void startWatching();
+    void startBatch(const QStringList &paths); // Clears the list and the per-batch counters
+    bool alreadyDelivered(const QString &inputPath) const;
+    void reportRow(int row);
+    void onDelivered(QJsonObject job, const QString &output);
+    void writeSummary();
+    static QString deliver(const QString &outputPath, const QString &outputDir, bool encoded);
+    void finish(int exitCode);
+    static void writeJson(const QJsonObject &object);
+};
+
+#endif // HEADLESSRUNNER_H
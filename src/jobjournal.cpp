@@ -0,0 +1,203 @@
+#include "jobjournal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+JournalEntry::JournalEntry()
+    : sourceSize(0)
+    , sourceModifiedMs(0)
+    , status(0)
+    , queued(false)
+    , outputReady(false)
+    , targetSizeMB(0)
+    , encodingMode(-1)
+    , encoderPreset(-1)
+    , videoBitrateKbps(0)
+{
+}
+
+QJsonObject JournalEntry::toJson() const
+{
+    QJsonObject json;
+    json["path"] = path;
+    json["sourceSize"] = sourceSize;
+    json["sourceModified"] = sourceModifiedMs;
+    json["status"] = status;
+    json["queued"] = queued;
+    json["output"] = outputPath;
+    json["outputReady"] = outputReady;
+    json["encodeMode"] = encodeMode;
+    json["targetSizeMB"] = targetSizeMB;
+    json["encodingMode"] = encodingMode;
+    json["encoder"] = encoderName;
+    json["encoderPreset"] = encoderPreset;
+    if (firstPassDone()) {
+        json["passLogPrefix"] = passLogPrefix;
+        json["audioPath"] = audioPath;
+        json["videoBitrateKbps"] = videoBitrateKbps;
+    }
+    return json;
+}
+
+JournalEntry JournalEntry::fromJson(const QJsonObject &json)
+{
+    JournalEntry entry;
+    entry.path = json.value("path").toString();
+    entry.sourceSize = json.value("sourceSize").toInteger();
+    entry.sourceModifiedMs = json.value("sourceModified").toInteger();
+    entry.status = json.value("status").toInt();
+    entry.queued = json.value("queued").toBool();
+    entry.outputPath = json.value("output").toString();
+    entry.outputReady = json.value("outputReady").toBool();
+    entry.encodeMode = json.value("encodeMode").toString();
+    entry.targetSizeMB = json.value("targetSizeMB").toInt();
+    entry.encodingMode = json.value("encodingMode").toInt(-1);
+    entry.encoderName = json.value("encoder").toString();
+    entry.encoderPreset = json.value("encoderPreset").toInt(-1);
+    entry.passLogPrefix = json.value("passLogPrefix").toString();
+    entry.audioPath = json.value("audioPath").toString();
+    entry.videoBitrateKbps = json.value("videoBitrateKbps").toInt();
+    return entry;
+}
+
+JobJournal::JobJournal(const QString &filePath)
+    : m_filePath(filePath)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    load();
+
+    // Compact: replace the replayed history with the current state
+    QSaveFile compacted(m_filePath);
+    if (compacted.open(QIODevice::WriteOnly)) {
+        QJsonObject header;
+        header["version"] = FormatVersion;
+        compacted.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + "\n");
+        for (const QString &path : std::as_const(m_order)) {
+            QJsonObject line = m_entries.value(path).toJson();
+            line["op"] = "set";
+            compacted.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + "\n");
+        }
+        compacted.commit();
+    }
+
+    m_file.setFileName(m_filePath);
+    m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void JobJournal::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    bool versionOk = false;
+    while (!file.atEnd()) {
+        // A line cut short by a crash fails to parse and is skipped
+        QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+        if (line.isEmpty()) {
+            continue;
+        }
+        if (line.contains("version")) {
+            versionOk = line.value("version").toInt() == FormatVersion;
+            continue;
+        }
+        if (!versionOk) {
+            continue;
+        }
+
+        QString op = line.value("op").toString();
+        QString path = line.value("path").toString();
+        if (op == "set" && !path.isEmpty()) {
+            if (!m_entries.contains(path)) {
+                m_order.append(path);
+            }
+            m_entries.insert(path, JournalEntry::fromJson(line));
+        } else if (op == "remove") {
+            m_entries.remove(path);
+            m_order.removeOne(path);
+        } else if (op == "clear") {
+            m_entries.clear();
+            m_order.clear();
+        }
+    }
+}
+
+QList<JournalEntry> JobJournal::entries() const
+{
+    QList<JournalEntry> result;
+    for (const QString &path : m_order) {
+        result.append(m_entries.value(path));
+    }
+    return result;
+}
+
+void JobJournal::record(const JournalEntry &entry)
+{
+    if (!m_entries.contains(entry.path)) {
+        m_order.append(entry.path);
+    }
+    m_entries.insert(entry.path, entry);
+
+    QJsonObject line = entry.toJson();
+    line["op"] = "set";
+    append(line);
+}
+
+void JobJournal::remove(const QString &path)
+{
+    if (m_entries.remove(path) == 0) {
+        return;
+    }
+    m_order.removeOne(path);
+
+    QJsonObject line;
+    line["op"] = "remove";
+    line["path"] = path;
+    append(line);
+}
+
+void JobJournal::clear()
+{
+    m_entries.clear();
+    m_order.clear();
+
+    QJsonObject line;
+    line["op"] = "clear";
+    append(line);
+}
+
+bool JobJournal::references(const QString &filePath) const
+{
+    QFileInfo file(filePath);
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const JournalEntry &entry = it.value();
+        if (entry.outputReady && QFileInfo(entry.outputPath) == file) {
+            return true;
+        }
+        if (entry.firstPassDone()) {
+            // Pass logs are <prefix>-0.log and <prefix>-0.log.mbtree
+            QFileInfo prefix(entry.passLogPrefix);
+            if (prefix.absolutePath() == file.absolutePath() &&
+                file.fileName().startsWith(prefix.fileName() + "-")) {
+                return true;
+            }
+            if (!entry.audioPath.isEmpty() && QFileInfo(entry.audioPath) == file) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void JobJournal::append(const QJsonObject &line)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    // Flushed right away: the line must be on disk before the work it describes
+    m_file.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + "\n");
+    m_file.flush();
+}
@@ -0,0 +1,69 @@
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+// What the journal knows about one list item, keyed by its source path
+// (VideoItem ids restart at 1 every session)
+struct JournalEntry {
+    QString path;
+    qint64 sourceSize;       // Source identity, a changed file is not resumed
+    qint64 sourceModifiedMs;
+    int status;              // VideoStatus
+    bool queued;             // Part of a running batch, resumed on restart
+    QString outputPath;      // Output in the temp folder, planned or finished
+    bool outputReady;        // outputPath holds a finished file to reuse
+    QString encodeMode;
+    int targetSizeMB;        // Settings the job runs with
+    int encodingMode;
+    QString encoderName;
+    int encoderPreset;       // Index into the encoder's presets, -1 = its default
+
+    // Set once pass 1 finished; pass 2 can resume from these files
+    QString passLogPrefix;
+    QString audioPath;       // Pre-encoded audio, empty = encode in pass 2
+    int videoBitrateKbps;
+
+    JournalEntry();
+    bool firstPassDone() const { return !passLogPrefix.isEmpty(); }
+    QJsonObject toJson() const;
+    static JournalEntry fromJson(const QJsonObject &json);
+};
+
+// Write-ahead job journal in the app data dir. Every change is appended as
+// one JSON line and flushed before the work it describes starts, so a crash
+// or a closed window loses at most the line being written. Loading replays
+// the lines and rewrites the file with one line per item, keeping it short.
+class JobJournal
+{
+public:
+    explicit JobJournal(const QString &filePath);
+
+    QList<JournalEntry> entries() const; // In the order items were added
+    bool contains(const QString &path) const { return m_entries.contains(path); }
+    JournalEntry entry(const QString &path) const { return m_entries.value(path); }
+
+    void record(const JournalEntry &entry);
+    void remove(const QString &path);
+    void clear();
+
+    // Files the journal still needs: finished outputs and kept pass 1 state
+    bool references(const QString &filePath) const;
+
+private:
+    static const int FormatVersion = 1;
+
+    QString m_filePath;
+    QFile m_file;
+    QHash<QString, JournalEntry> m_entries;
+    QStringList m_order;
+
+    void load();
+    void append(const QJsonObject &line);
+};
+
+#endif // JOBJOURNAL_H
@@ -0,0 +1,285 @@
+#include "jobserver.h"
+#include "videocompressor.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+namespace {
+
+const char *const ModeNames[] = {"two-pass", "single-pass", "capped-crf"};
+
+// A client that never sends a newline must not grow the buffer without bound
+const int MaxRequestBytes = 64 * 1024;
+
+} // namespace
+
+JobServer::JobServer(VideoCompressor *compressor, QObject *parent)
+    : QObject(parent)
+    , m_compressor(compressor)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, &JobServer::onNewConnection);
+    connect(m_compressor, &VideoCompressor::videoStatusChanged, this, &JobServer::onVideoStatusChanged);
+    connect(m_compressor, &VideoCompressor::videoThroughputChanged, this, &JobServer::onVideoThroughputChanged);
+}
+
+bool JobServer::listen(const QString &name)
+{
+    // Only the current user may submit jobs
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (!m_server.listen(name)) {
+        // A crashed instance can leave its Unix socket behind
+        if (m_server.serverError() != QAbstractSocket::AddressInUseError) {
+            emit debugMessage("Job API unavailable: " + m_server.errorString(), "warning");
+            return false;
+        }
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(500)) {
+            emit debugMessage("Job API not started, another instance is serving " + name, "warning");
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (!m_server.listen(name)) {
+            emit debugMessage("Job API unavailable: " + m_server.errorString(), "warning");
+            return false;
+        }
+    }
+
+    emit debugMessage("Job API listening on " + m_server.fullServerName(), "info");
+    return true;
+}
+
+void JobServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+        Client client;
+        client.subscribed = false;
+        m_clients.insert(socket, client);
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_clients.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void JobServer::onReadyRead(QLocalSocket *socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+
+    it->buffer.append(socket->readAll());
+    int newline;
+    while ((newline = it->buffer.indexOf('\n')) >= 0) {
+        QByteArray line = it->buffer.left(newline).trimmed();
+        it->buffer.remove(0, newline + 1);
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        if (!document.isObject()) {
+            QJsonObject event;
+            event["event"] = "rejected";
+            event["reason"] = "Invalid JSON: " + parseError.errorString();
+            send(socket, event);
+            continue;
+        }
+
+        handleRequest(socket, document.object());
+
+        // The handler may have dropped the client
+        it = m_clients.find(socket);
+        if (it == m_clients.end()) {
+            return;
+        }
+    }
+
+    if (it->buffer.size() > MaxRequestBytes) {
+        emit debugMessage("Job API: dropping client with an oversized request", "warning");
+        socket->disconnectFromServer();
+    }
+}
+
+void JobServer::handleRequest(QLocalSocket *socket, const QJsonObject &request)
+{
+    QString type = request.value("type").toString();
+    if (type == "submit") {
+        submit(socket, request);
+    } else if (type == "list") {
+        QJsonArray jobs;
+        for (int row = 0; row < m_compressor->rowCount(); ++row) {
+            jobs.append(describeRow(row));
+        }
+        QJsonObject event;
+        event["event"] = "jobs";
+        event["jobs"] = jobs;
+        send(socket, event);
+    } else if (type == "subscribe") {
+        m_clients[socket].subscribed = true;
+        QJsonObject event;
+        event["event"] = "subscribed";
+        send(socket, event);
+    } else {
+        QJsonObject event;
+        event["event"] = "rejected";
+        event["reason"] = "Unknown request type: " + type;
+        event["tag"] = request.value("tag");
+        send(socket, event);
+    }
+}
+
+void JobServer::submit(QLocalSocket *socket, const QJsonObject &request)
+{
+    QJsonObject event;
+    event["tag"] = request.value("tag"); // Echoed so clients can match replies
+
+    QString path = request.value("path").toString();
+    int targetSizeMB = request.value("targetSizeMB").toInt(0);
+    QString modeName = request.value("mode").toString();
+    int mode = -1;
+    for (int i = 0; i < 3; ++i) {
+        if (modeName == ModeNames[i]) {
+            mode = i;
+        }
+    }
+
+    QString reason;
+    if (path.isEmpty() || !QFileInfo(path).isFile()) {
+        reason = "File not found: " + path;
+    } else if (targetSizeMB < 0) {
+        reason = "targetSizeMB must be positive";
+    } else if (!modeName.isEmpty() && mode < 0) {
+        reason = "Unknown mode: " + modeName;
+    }
+
+    quint64 id = 0;
+    if (reason.isEmpty()) {
+        id = m_compressor->submitJob(QFileInfo(path).absoluteFilePath(), targetSizeMB, mode);
+        if (id == 0) {
+            reason = "Not accepted (not a video, already in the list, or FFmpeg missing)";
+        }
+    }
+
+    if (!reason.isEmpty()) {
+        event["event"] = "rejected";
+        event["reason"] = reason;
+        send(socket, event);
+        return;
+    }
+
+    m_clients[socket].jobs.insert(id);
+    event["event"] = "accepted";
+    event["job"] = qint64(id);
+    send(socket, event);
+    emit debugMessage("Job API: accepted " + QFileInfo(path).fileName(), "info");
+
+    // Status changes that happened inside submitJob() were not routed to
+    // this client yet; send the current state once
+    for (int row = m_compressor->rowCount() - 1; row >= 0; --row) {
+        QModelIndex index = m_compressor->index(row);
+        if (index.data(VideoCompressor::VideoIdRole).toULongLong() == id) {
+            QJsonObject status = describeRow(row);
+            status["event"] = "status";
+            send(socket, status);
+            break;
+        }
+    }
+}
+
+QJsonObject JobServer::describeRow(int row) const
+{
+    QModelIndex index = m_compressor->index(row);
+    int status = index.data(VideoCompressor::StatusRole).toInt();
+
+    QJsonObject job;
+    job["job"] = index.data(VideoCompressor::VideoIdRole).toLongLong();
+    job["path"] = QDir::toNativeSeparators(index.data(VideoCompressor::PathRole).toString());
+    job["status"] = statusName(status);
+    job["text"] = index.data(VideoCompressor::StatusTextRole).toString();
+    job["progress"] = index.data(VideoCompressor::ProgressRole).toInt();
+    job["mode"] = index.data(VideoCompressor::EncodeModeRole).toString();
+
+    QString output = index.data(VideoCompressor::OutputPathRole).toString();
+    if ((status == int(VideoStatus::Completed) || status == int(VideoStatus::AlreadyOptimal)) && !output.isEmpty()) {
+        job["output"] = QDir::toNativeSeparators(output);
+        job["outputBytes"] = QFileInfo(output).size();
+    }
+    return job;
+}
+
+void JobServer::onVideoStatusChanged(quint64 videoId, int status, const QString &statusText, int progress)
+{
+    QJsonObject event;
+    event["event"] = "status";
+    event["job"] = qint64(videoId);
+    event["status"] = statusName(status);
+    event["text"] = statusText;
+    event["progress"] = progress;
+
+    // Finished jobs carry the output so clients can pick it up
+    if (status == int(VideoStatus::Completed) || status == int(VideoStatus::AlreadyOptimal)) {
+        for (int row = m_compressor->rowCount() - 1; row >= 0; --row) {
+            if (m_compressor->index(row).data(VideoCompressor::VideoIdRole).toULongLong() == videoId) {
+                event = describeRow(row);
+                event["event"] = "status";
+                break;
+            }
+        }
+    }
+    broadcast(videoId, event);
+}
+
+void JobServer::onVideoThroughputChanged(quint64 videoId, double fps, double speed, int etaSeconds)
+{
+    QJsonObject event;
+    event["event"] = "progress";
+    event["job"] = qint64(videoId);
+    event["fps"] = fps;
+    event["speed"] = speed;
+    event["etaSeconds"] = etaSeconds;
+    broadcast(videoId, event);
+}
+
+void JobServer::broadcast(quint64 videoId, const QJsonObject &event)
+{
+    for (auto it = m_clients.constBegin(); it != m_clients.constEnd(); ++it) {
+        if (it->subscribed || it->jobs.contains(videoId)) {
+            send(it.key(), event);
+        }
+    }
+}
+
+void JobServer::send(QLocalSocket *socket, const QJsonObject &event)
+{
+    socket->write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
+
+QString JobServer::statusName(int status)
+{
+    switch (static_cast<VideoStatus>(status)) {
+    case VideoStatus::Ready:
+        return "queued";
+    case VideoStatus::Analyzing:
+        return "analyzing";
+    case VideoStatus::AlreadyOptimal:
+        return "already_optimal";
+    case VideoStatus::Compressing:
+        return "compressing";
+    case VideoStatus::Completed:
+        return "completed";
+    case VideoStatus::Error:
+        return "error";
+    }
+    return "unknown";
+}
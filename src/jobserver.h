@@ -0,0 +1,61 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QObject>
+#include <QSet>
+
+class QLocalSocket;
+class VideoCompressor;
+
+// Local job API: other programs on this machine connect to the named pipe /
+// Unix socket "VideoCompressor" and submit jobs to the running instance, so
+// every client shares its scheduler and its one-time FFmpeg detection.
+//
+// Both directions are JSON Lines. Requests:
+//   {"type":"submit","path":"...","targetSizeMB":8,"mode":"two-pass","tag":"..."}
+//   {"type":"list"}       every item in the list with its status
+//   {"type":"subscribe"}  events for all jobs, not only the client's own
+// Events carry the job id returned in "accepted":
+//   accepted / rejected, status (on every status change), progress (throughput)
+class JobServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobServer(VideoCompressor *compressor, QObject *parent = nullptr);
+
+    bool listen(const QString &name = QStringLiteral("VideoCompressor"));
+    QString fullServerName() const { return m_server.fullServerName(); }
+
+signals:
+    void debugMessage(const QString &message, const QString &type = "info");
+
+private slots:
+    void onNewConnection();
+    void onVideoStatusChanged(quint64 videoId, int status, const QString &statusText, int progress);
+    void onVideoThroughputChanged(quint64 videoId, double fps, double speed, int etaSeconds);
+
+private:
+    struct Client {
+        QByteArray buffer;   // Partial request line
+        QSet<quint64> jobs;  // Jobs this client submitted
+        bool subscribed;     // Receives events for every job
+    };
+
+    VideoCompressor *m_compressor;
+    QLocalServer m_server;
+    QHash<QLocalSocket *, Client> m_clients;
+
+    void onReadyRead(QLocalSocket *socket);
+    void handleRequest(QLocalSocket *socket, const QJsonObject &request);
+    void submit(QLocalSocket *socket, const QJsonObject &request);
+    QJsonObject describeRow(int row) const;
+    void broadcast(quint64 videoId, const QJsonObject &event);
+    static void send(QLocalSocket *socket, const QJsonObject &event);
+    static QString statusName(int status);
+};
+
+#endif // JOBSERVER_H
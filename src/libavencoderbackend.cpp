@@ -0,0 +1,495 @@
+#include "libavencoderbackend.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <cmath>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// About as often as ffmpeg writes -progress blocks
+const int ProgressIntervalMs = 500;
+
+QString errorText(int code)
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {0};
+    av_strerror(code, buffer, sizeof(buffer));
+    return QString::fromUtf8(buffer);
+}
+
+// Everything one run allocates, released in one place on every exit path
+struct Session {
+    AVFormatContext *input = nullptr;
+    AVFormatContext *audioInput = nullptr;
+    AVFormatContext *output = nullptr;
+    AVCodecContext *decoder = nullptr;
+    AVCodecContext *encoder = nullptr;
+    SwsContext *scaler = nullptr;
+    AVFrame *decoded = nullptr;
+    AVFrame *scaled = nullptr;
+    AVPacket *packet = nullptr;       // Demuxed from the source
+    AVPacket *encoded = nullptr;      // From the encoder
+    AVPacket *audioPacket = nullptr;  // Read ahead from audioInput
+    int videoStream = -1;
+    int audioStream = -1;
+    AVStream *videoOut = nullptr;
+    AVStream *audioOut = nullptr;
+    bool audioPending = false;        // audioPacket is read but not written yet
+    bool audioDone = false;
+    QByteArray stats;                 // Rate-control stats of encoders without their own stats file
+
+    ~Session()
+    {
+        if (encoder) {
+            encoder->stats_in = nullptr; // Points into stats
+        }
+        if (output) {
+            if (!(output->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&output->pb);
+            }
+            avformat_free_context(output);
+        }
+        avformat_close_input(&input);
+        avformat_close_input(&audioInput);
+        avcodec_free_context(&decoder);
+        avcodec_free_context(&encoder);
+        sws_freeContext(scaler);
+        av_frame_free(&decoded);
+        av_frame_free(&scaled);
+        av_packet_free(&packet);
+        av_packet_free(&encoded);
+        av_packet_free(&audioPacket);
+    }
+};
+
+// Copies pre-encoded audio packets up to the given media time (all of them
+// for a negative time), so both tracks reach the muxer interleaved
+int writeAudioUntil(Session &s, double seconds)
+{
+    while (s.audioOut && !s.audioDone) {
+        if (!s.audioPending) {
+            int ret = av_read_frame(s.audioInput, s.audioPacket);
+            if (ret == AVERROR_EOF) {
+                s.audioDone = true;
+                break;
+            }
+            if (ret < 0) {
+                return ret;
+            }
+            if (s.audioPacket->stream_index != s.audioStream) {
+                av_packet_unref(s.audioPacket);
+                continue;
+            }
+            s.audioPending = true;
+        }
+
+        AVStream *in = s.audioInput->streams[s.audioStream];
+        if (seconds >= 0 && s.audioPacket->dts != AV_NOPTS_VALUE &&
+            s.audioPacket->dts * av_q2d(in->time_base) > seconds) {
+            break;
+        }
+        av_packet_rescale_ts(s.audioPacket, in->time_base, s.audioOut->time_base);
+        s.audioPacket->stream_index = s.audioOut->index;
+        s.audioPacket->pos = -1;
+        s.audioPending = false;
+        int ret = av_interleaved_write_frame(s.output, s.audioPacket);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+// Drains the encoder into the muxer
+int writeEncodedPackets(Session &s)
+{
+    int ret;
+    while ((ret = avcodec_receive_packet(s.encoder, s.encoded)) >= 0) {
+        if (s.encoder->stats_out) {
+            s.stats.append(s.encoder->stats_out);
+        }
+        av_packet_rescale_ts(s.encoded, s.encoder->time_base, s.videoOut->time_base);
+        s.encoded->stream_index = s.videoOut->index;
+        if (s.encoded->dts != AV_NOPTS_VALUE) {
+            ret = writeAudioUntil(s, s.encoded->dts * av_q2d(s.videoOut->time_base));
+            if (ret < 0) {
+                av_packet_unref(s.encoded);
+                return ret;
+            }
+        }
+        ret = av_interleaved_write_frame(s.output, s.encoded);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+} // namespace
+
+LibavEncoderBackend::LibavEncoderBackend(QObject *parent)
+    : EncoderBackend(parent)
+    , m_thread(nullptr)
+    , m_cancelled(false)
+{
+}
+
+LibavEncoderBackend::~LibavEncoderBackend()
+{
+    cancel();
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+bool LibavEncoderBackend::supports(const EncodeTask &task)
+{
+    if (!task.transcode || task.audioBitrateKbps > 0 || task.hardwareDecode) {
+        return false;
+    }
+    const AVCodec *codec = avcodec_find_encoder_by_name(task.encoderName.toUtf8().constData());
+    return codec && !(codec->capabilities & AV_CODEC_CAP_HARDWARE);
+}
+
+void LibavEncoderBackend::start(const EncodeTask &task)
+{
+    // One run per backend object, like one process per run
+    if (m_thread) {
+        return;
+    }
+
+    m_thread = QThread::create([this, task]() {
+        int exitCode = run(task);
+        if (exitCode != 0 && !task.outputPath.isEmpty()) {
+            QFile::remove(task.outputPath);
+        }
+        if (!m_cancelled) {
+            emit finished(exitCode, QProcess::NormalExit);
+        }
+    });
+    m_thread->start();
+}
+
+void LibavEncoderBackend::cancel()
+{
+    // Checked between packets, so the worker stops within one frame
+    m_cancelled = true;
+}
+
+int LibavEncoderBackend::run(const EncodeTask &task)
+{
+    auto fail = [this](const QString &what, int code) {
+        emit logLine(what + ": " + errorText(code));
+        return 1;
+    };
+
+    Session s;
+    s.decoded = av_frame_alloc();
+    s.scaled = av_frame_alloc();
+    s.packet = av_packet_alloc();
+    s.encoded = av_packet_alloc();
+    if (!s.decoded || !s.scaled || !s.packet || !s.encoded) {
+        return fail("Out of memory", AVERROR(ENOMEM));
+    }
+
+    // Source and decoder; every stream but the video one is skipped by the demuxer
+    int ret = avformat_open_input(&s.input, task.inputPath.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0) {
+        return fail("Cannot open " + task.inputPath, ret);
+    }
+    if ((ret = avformat_find_stream_info(s.input, nullptr)) < 0) {
+        return fail("Cannot read stream info", ret);
+    }
+    const AVCodec *decoderCodec = nullptr;
+    s.videoStream = av_find_best_stream(s.input, AVMEDIA_TYPE_VIDEO, -1, -1, &decoderCodec, 0);
+    if (s.videoStream < 0) {
+        return fail("No decodable video stream", s.videoStream);
+    }
+    for (unsigned i = 0; i < s.input->nb_streams; ++i) {
+        if (int(i) != s.videoStream) {
+            s.input->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    AVStream *inStream = s.input->streams[s.videoStream];
+    s.decoder = avcodec_alloc_context3(decoderCodec);
+    if (!s.decoder) {
+        return fail("Out of memory", AVERROR(ENOMEM));
+    }
+    avcodec_parameters_to_context(s.decoder, inStream->codecpar);
+    s.decoder->pkt_timebase = inStream->time_base;
+    s.decoder->thread_count = task.threads;
+    if ((ret = avcodec_open2(s.decoder, decoderCodec, nullptr)) < 0) {
+        return fail("Cannot open the decoder", ret);
+    }
+
+    // Output format, matching the scale/fps filters of EncodePlanner::videoFilterArgs()
+    int sourceWidth = s.decoder->width;
+    int sourceHeight = s.decoder->height;
+    int width = sourceWidth;
+    int height = sourceHeight;
+    if (task.shortSide > 0 && sourceWidth > 0 && sourceHeight > 0) {
+        if (sourceWidth > sourceHeight) {
+            width = int(av_rescale(task.shortSide, sourceWidth, sourceHeight));
+            height = task.shortSide;
+        } else {
+            width = task.shortSide;
+            height = int(av_rescale(task.shortSide, sourceHeight, sourceWidth));
+        }
+    }
+    width &= ~1; // 4:2:0 needs even dimensions
+    height &= ~1;
+    AVRational frameRate = av_guess_frame_rate(s.input, inStream, nullptr);
+    if (frameRate.num <= 0 || frameRate.den <= 0) {
+        frameRate = AVRational{30, 1};
+    }
+    if (task.frameRate > 0) {
+        frameRate = av_d2q(task.frameRate, 100000);
+    }
+
+    // Pass 1 only feeds the rate control, the null muxer discards its packets
+    bool writeFile = task.pass != 1;
+    QByteArray outputPath = task.outputPath.toUtf8();
+    QByteArray format = task.format.toUtf8();
+    ret = avformat_alloc_output_context2(&s.output, nullptr, writeFile ? format.constData() : "null",
+                                         writeFile ? outputPath.constData() : nullptr);
+    if (ret < 0) {
+        return fail("Cannot create the output", ret);
+    }
+
+    const AVCodec *encoderCodec = avcodec_find_encoder_by_name(task.encoderName.toUtf8().constData());
+    if (!encoderCodec) {
+        return fail("Encoder not available: " + task.encoderName, AVERROR_ENCODER_NOT_FOUND);
+    }
+    s.encoder = avcodec_alloc_context3(encoderCodec);
+    if (!s.encoder) {
+        return fail("Out of memory", AVERROR(ENOMEM));
+    }
+    s.encoder->width = width;
+    s.encoder->height = height;
+    s.encoder->sample_aspect_ratio = s.decoder->sample_aspect_ratio;
+    s.encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    s.encoder->color_primaries = s.decoder->color_primaries;
+    s.encoder->color_trc = s.decoder->color_trc;
+    s.encoder->colorspace = s.decoder->colorspace;
+    s.encoder->time_base = av_inv_q(frameRate);
+    s.encoder->framerate = frameRate;
+    s.encoder->thread_count = task.threads;
+    for (const auto &option : task.encoderOptions) {
+        av_opt_set(s.encoder, option.first.constData(), option.second.constData(), AV_OPT_SEARCH_CHILDREN);
+    }
+    if (task.crf >= 0) {
+        av_opt_set(s.encoder, "crf", QByteArray::number(task.crf).constData(), AV_OPT_SEARCH_CHILDREN);
+    }
+    if (task.videoBitrateKbps > 0) {
+        s.encoder->bit_rate = int64_t(task.videoBitrateKbps) * 1000;
+    }
+    if (task.maxRateKbps > 0) {
+        s.encoder->rc_max_rate = int64_t(task.maxRateKbps) * 1000;
+        s.encoder->rc_buffer_size = task.maxRateKbps * 2 * 1000;
+    }
+    if (s.output->oformat->flags & AVFMT_GLOBALHEADER) {
+        s.encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    // x264 reads and writes its stats file itself, like with -passlogfile;
+    // other encoders hand the stats over in memory and the file is only kept
+    // so an interrupted job can resume at pass 2
+    QString statsPath = task.passLogPrefix + "-0.log";
+    bool ownStatsFile = false;
+    if (task.pass > 0) {
+        s.encoder->flags |= task.pass == 1 ? AV_CODEC_FLAG_PASS1 : AV_CODEC_FLAG_PASS2;
+        ownStatsFile = av_opt_set(s.encoder, "stats", statsPath.toUtf8().constData(), AV_OPT_SEARCH_CHILDREN) >= 0;
+        if (task.pass == 2 && !ownStatsFile) {
+            QFile statsFile(statsPath);
+            if (!statsFile.open(QIODevice::ReadOnly)) {
+                return fail("Cannot read the pass 1 stats " + statsPath, AVERROR(ENOENT));
+            }
+            s.stats = statsFile.readAll();
+            s.encoder->stats_in = s.stats.data();
+        }
+    }
+
+    if ((ret = avcodec_open2(s.encoder, encoderCodec, nullptr)) < 0) {
+        return fail("Cannot open " + task.encoderName, ret);
+    }
+    s.videoOut = avformat_new_stream(s.output, nullptr);
+    if (!s.videoOut) {
+        return fail("Out of memory", AVERROR(ENOMEM));
+    }
+    avcodec_parameters_from_context(s.videoOut->codecpar, s.encoder);
+    s.videoOut->time_base = s.encoder->time_base;
+    s.videoOut->avg_frame_rate = frameRate;
+
+    // Audio encoded next to pass 1 is copied packet by packet
+    if (writeFile && !task.audioPath.isEmpty()) {
+        ret = avformat_open_input(&s.audioInput, task.audioPath.toUtf8().constData(), nullptr, nullptr);
+        if (ret < 0 || (ret = avformat_find_stream_info(s.audioInput, nullptr)) < 0) {
+            return fail("Cannot open " + task.audioPath, ret);
+        }
+        s.audioStream = av_find_best_stream(s.audioInput, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (s.audioStream < 0) {
+            return fail("No audio stream in " + task.audioPath, s.audioStream);
+        }
+        s.audioPacket = av_packet_alloc();
+        s.audioOut = avformat_new_stream(s.output, nullptr);
+        if (!s.audioPacket || !s.audioOut) {
+            return fail("Out of memory", AVERROR(ENOMEM));
+        }
+        AVStream *audioIn = s.audioInput->streams[s.audioStream];
+        avcodec_parameters_copy(s.audioOut->codecpar, audioIn->codecpar);
+        s.audioOut->codecpar->codec_tag = 0;
+        s.audioOut->time_base = audioIn->time_base;
+    }
+
+    if (!(s.output->oformat->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_open(&s.output->pb, outputPath.constData(), AVIO_FLAG_WRITE)) < 0) {
+            return fail("Cannot write " + task.outputPath, ret);
+        }
+    }
+    AVDictionary *muxerOptions = nullptr;
+    if (task.format == "mp4") {
+        av_dict_set(&muxerOptions, "movflags", "+faststart", 0);
+    }
+    ret = avformat_write_header(s.output, &muxerOptions);
+    av_dict_free(&muxerOptions);
+    if (ret < 0) {
+        return fail("Cannot write the output header", ret);
+    }
+
+    // Progress is counted here, not parsed from text
+    QElapsedTimer clock;
+    clock.start();
+    qint64 lastReportMs = -ProgressIntervalMs;
+    qint64 frames = 0;
+    int64_t firstTimestamp = AV_NOPTS_VALUE;
+    int64_t lastPts = -1;
+
+    auto reportProgress = [&](bool ended) {
+        qint64 now = clock.elapsed();
+        if (!ended && now - lastReportMs < ProgressIntervalMs) {
+            return;
+        }
+        lastReportMs = now;
+        double elapsed = now / 1000.0;
+        FFmpegProgress update;
+        update.frame = frames;
+        update.outTimeSeconds = lastPts >= 0 ? lastPts * av_q2d(s.encoder->time_base) : 0;
+        update.fps = elapsed > 0 ? frames / elapsed : 0;
+        update.speed = elapsed > 0 ? update.outTimeSeconds / elapsed : 0;
+        update.totalSizeBytes = s.output->pb ? avio_tell(s.output->pb) : 0;
+        update.bitrateKbps = update.outTimeSeconds > 0 ? update.totalSizeBytes * 8 / 1000.0 / update.outTimeSeconds : 0;
+        update.ended = ended;
+        emit progress(update);
+    };
+
+    auto encodeFrame = [&](AVFrame *frame) {
+        int64_t timestamp = frame->best_effort_timestamp;
+        if (timestamp == AV_NOPTS_VALUE) {
+            timestamp = frame->pts;
+        }
+        int64_t pts = lastPts + 1;
+        if (timestamp != AV_NOPTS_VALUE) {
+            if (firstTimestamp == AV_NOPTS_VALUE) {
+                firstTimestamp = timestamp;
+            }
+            double seconds = (timestamp - firstTimestamp) * av_q2d(inStream->time_base);
+            pts = std::llround(seconds * av_q2d(frameRate));
+        }
+        if (pts <= lastPts) {
+            return 0; // Surplus frame at the output rate, dropped like the fps filter does
+        }
+        lastPts = pts;
+
+        s.scaler = sws_getCachedContext(s.scaler, frame->width, frame->height, AVPixelFormat(frame->format),
+                                        width, height, AV_PIX_FMT_YUV420P, SWS_BICUBIC, nullptr, nullptr, nullptr);
+        if (!s.scaler) {
+            return AVERROR(EINVAL);
+        }
+        av_frame_unref(s.scaled);
+        s.scaled->format = AV_PIX_FMT_YUV420P;
+        s.scaled->width = width;
+        s.scaled->height = height;
+        int result = av_frame_get_buffer(s.scaled, 0);
+        if (result < 0) {
+            return result;
+        }
+        sws_scale(s.scaler, frame->data, frame->linesize, 0, frame->height, s.scaled->data, s.scaled->linesize);
+        s.scaled->pts = pts;
+
+        if ((result = avcodec_send_frame(s.encoder, s.scaled)) < 0) {
+            return result;
+        }
+        ++frames;
+        return writeEncodedPackets(s);
+    };
+
+    auto decodeFrames = [&]() {
+        int result;
+        while ((result = avcodec_receive_frame(s.decoder, s.decoded)) >= 0) {
+            result = encodeFrame(s.decoded);
+            av_frame_unref(s.decoded);
+            if (result < 0) {
+                return result;
+            }
+            reportProgress(false);
+        }
+        return result == AVERROR(EAGAIN) || result == AVERROR_EOF ? 0 : result;
+    };
+
+    while (!m_cancelled) {
+        ret = av_read_frame(s.input, s.packet);
+        if (ret == AVERROR_EOF) {
+            break;
+        }
+        if (ret < 0) {
+            return fail("Cannot read " + task.inputPath, ret);
+        }
+        if (s.packet->stream_index != s.videoStream) {
+            av_packet_unref(s.packet);
+            continue;
+        }
+        ret = avcodec_send_packet(s.decoder, s.packet);
+        av_packet_unref(s.packet);
+        if (ret == AVERROR_INVALIDDATA) {
+            // A damaged packet costs a frame, not the whole encode
+            emit logLine("Skipping a corrupt video packet");
+        } else if (ret < 0) {
+            return fail("Decoding failed", ret);
+        }
+        if ((ret = decodeFrames()) < 0) {
+            return fail("Encoding failed", ret);
+        }
+    }
+    if (m_cancelled) {
+        return 255;
+    }
+
+    // Flush the decoder, then the encoder's lookahead
+    avcodec_send_packet(s.decoder, nullptr);
+    if ((ret = decodeFrames()) < 0) {
+        return fail("Encoding failed", ret);
+    }
+    avcodec_send_frame(s.encoder, nullptr);
+    if ((ret = writeEncodedPackets(s)) < 0 || (ret = writeAudioUntil(s, -1)) < 0) {
+        return fail("Writing the output failed", ret);
+    }
+    if ((ret = av_write_trailer(s.output)) < 0) {
+        return fail("Writing the output failed", ret);
+    }
+
+    if (task.pass == 1 && !ownStatsFile) {
+        QFile statsFile(statsPath);
+        if (!statsFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || statsFile.write(s.stats) != s.stats.size()) {
+            return fail("Cannot write the pass 1 stats " + statsPath, AVERROR(EIO));
+        }
+    }
+
+    reportProgress(true);
+    return 0;
+}
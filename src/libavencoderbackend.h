@@ -0,0 +1,35 @@
+#ifndef LIBAVENCODERBACKEND_H
+#define LIBAVENCODERBACKEND_H
+
+#include <QThread>
+#include <atomic>
+#include "encoderbackend.h"
+
+// Encodes inside the application with libavformat/libavcodec/libswscale on a
+// worker thread. Progress comes from the frame counter instead of scraped
+// text, and cancel() stops the loop at the next packet instead of killing a
+// process. Only built when CMake finds the libraries (VC_HAVE_LIBAV).
+class LibavEncoderBackend : public EncoderBackend
+{
+    Q_OBJECT
+
+public:
+    explicit LibavEncoderBackend(QObject *parent = nullptr);
+    ~LibavEncoderBackend() override;
+
+    // Software video encodes, muxing pre-encoded audio. Stream copies, inline
+    // audio encodes and hardware decoding stay on the ffmpeg process.
+    static bool supports(const EncodeTask &task);
+
+    QString name() const override { return "libav"; }
+    void start(const EncodeTask &task) override;
+    void cancel() override;
+
+private:
+    QThread *m_thread;
+    std::atomic<bool> m_cancelled;
+
+    int run(const EncodeTask &task); // Exit code like ffmpeg's, 0 = success
+};
+
+#endif // LIBAVENCODERBACKEND_H
@@ -0,0 +1,307 @@
+#include "logmodel.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+namespace {
+
+const char *const SeverityNames[] = {"info", "success", "warning", "error"};
+const char *const SeverityColors[] = {"#42a5f5", "#66bb6a", "#ffa726", "#ff6b6b"};
+
+// One batch per frame at 60 Hz
+const int FlushIntervalMs = 16;
+
+} // namespace
+
+LogFileWriter::LogFileWriter(QObject *parent)
+    : QObject(parent)
+    , m_file(nullptr)
+{
+}
+
+LogFileWriter::~LogFileWriter()
+{
+    close();
+}
+
+void LogFileWriter::open(const QString &filePath)
+{
+    close();
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    m_file = new QFile(filePath);
+    if (!m_file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        delete m_file;
+        m_file = nullptr;
+    }
+}
+
+void LogFileWriter::close()
+{
+    if (m_file) {
+        m_file->close();
+        delete m_file;
+        m_file = nullptr;
+    }
+}
+
+void LogFileWriter::write(const QStringList &lines)
+{
+    if (!m_file) {
+        return;
+    }
+    for (const QString &line : lines) {
+        m_file->write(line.toUtf8());
+        m_file->write("\n");
+    }
+    m_file->flush();
+}
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_nextSequence(0)
+    , m_capacity(qMax(1, capacity))
+    , m_minimumSeverity(Info)
+    , m_writer(new LogFileWriter)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FlushIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &LogModel::flush);
+
+    m_writer->moveToThread(&m_writerThread);
+    m_writerThread.start(QThread::LowPriority);
+}
+
+LogModel::~LogModel()
+{
+    // Messages still waiting for a frame only need to reach the file
+    if (fileLoggingEnabled() && !m_pending.isEmpty()) {
+        QStringList lines;
+        for (const LogEntry &entry : std::as_const(m_pending)) {
+            lines << formatLine(entry);
+        }
+        QMetaObject::invokeMethod(m_writer, [writer = m_writer, lines]() {
+            writer->write(lines);
+        }, Qt::QueuedConnection);
+    }
+
+    // Queued writes are handled in order, so this returns once they are on disk
+    QMetaObject::invokeMethod(m_writer, &LogFileWriter::close, Qt::BlockingQueuedConnection);
+    m_writerThread.quit();
+    m_writerThread.wait();
+    delete m_writer;
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_visible.size();
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_visible.size())
+        return QVariant();
+
+    const LogEntry &entry = m_visible[index.row()];
+
+    switch (role) {
+    case TimestampRole:
+        return entry.timestamp.toString("HH:mm:ss");
+    case MessageRole:
+        return entry.message;
+    case TypeRole:
+        return QString(SeverityNames[entry.severity]);
+    case ColorRole:
+        return QString(SeverityColors[entry.severity]);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> LogModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[TimestampRole] = "timestamp";
+    roles[MessageRole] = "message";
+    roles[TypeRole] = "type";
+    roles[ColorRole] = "color";
+    return roles;
+}
+
+int LogModel::severityFromType(const QString &type)
+{
+    for (int severity = Success; severity <= Error; ++severity) {
+        if (type == QLatin1String(SeverityNames[severity])) {
+            return severity;
+        }
+    }
+    return Info;
+}
+
+void LogModel::append(const QString &message, const QString &type)
+{
+    LogEntry entry;
+    entry.sequence = m_nextSequence++;
+    entry.timestamp = QDateTime::currentDateTime();
+    entry.message = message;
+    entry.severity = severityFromType(type);
+
+    // Every entry must reach the log file, so a burst larger than the
+    // capacity is flushed early instead of trimmed here; flush() trims the
+    // view
+    m_pending.append(entry);
+    if (m_pending.size() >= m_capacity) {
+        flush();
+        return;
+    }
+
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void LogModel::flush()
+{
+    m_flushTimer.stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    QList<LogEntry> batch;
+    batch.swap(m_pending);
+
+    if (fileLoggingEnabled()) {
+        QStringList lines;
+        for (const LogEntry &entry : std::as_const(batch)) {
+            lines << formatLine(entry);
+        }
+        QMetaObject::invokeMethod(m_writer, [writer = m_writer, lines]() {
+            writer->write(lines);
+        }, Qt::QueuedConnection);
+    }
+
+    m_entries.append(batch);
+    if (m_entries.size() > m_capacity) {
+        m_entries.remove(0, m_entries.size() - m_capacity);
+    }
+    trimVisible();
+
+    QList<LogEntry> accepted;
+    quint64 firstKept = m_entries.first().sequence;
+    for (const LogEntry &entry : std::as_const(batch)) {
+        if (entry.severity >= m_minimumSeverity && entry.sequence >= firstKept) {
+            accepted.append(entry);
+        }
+    }
+    if (!accepted.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_visible.size(), m_visible.size() + accepted.size() - 1);
+        m_visible.append(accepted);
+        endInsertRows();
+    }
+    emit countChanged();
+}
+
+void LogModel::trimVisible()
+{
+    // Rows whose entry fell out of the buffer are dropped from the front
+    quint64 firstKept = m_entries.isEmpty() ? m_nextSequence : m_entries.first().sequence;
+    int stale = 0;
+    while (stale < m_visible.size() && m_visible[stale].sequence < firstKept) {
+        stale++;
+    }
+    if (stale > 0) {
+        beginRemoveRows(QModelIndex(), 0, stale - 1);
+        m_visible.remove(0, stale);
+        endRemoveRows();
+    }
+}
+
+void LogModel::clear()
+{
+    m_pending.clear();
+    m_flushTimer.stop();
+    beginResetModel();
+    m_entries.clear();
+    m_visible.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+QString LogModel::allText() const
+{
+    QString text;
+    for (const LogEntry &entry : m_visible) {
+        text += formatLine(entry) + "\n";
+    }
+    return text;
+}
+
+void LogModel::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (m_capacity != capacity) {
+        m_capacity = capacity;
+        if (m_entries.size() > m_capacity) {
+            m_entries.remove(0, m_entries.size() - m_capacity);
+            trimVisible();
+            emit countChanged();
+        }
+        emit capacityChanged();
+    }
+}
+
+void LogModel::setMinimumSeverity(int severity)
+{
+    severity = qBound(int(Info), severity, int(Error));
+    if (m_minimumSeverity != severity) {
+        m_minimumSeverity = severity;
+        flush();
+
+        // Filter changes are rare, rebuilding the rows from the buffer is fine
+        beginResetModel();
+        m_visible.clear();
+        for (const LogEntry &entry : std::as_const(m_entries)) {
+            if (entry.severity >= m_minimumSeverity) {
+                m_visible.append(entry);
+            }
+        }
+        endResetModel();
+        emit minimumSeverityChanged();
+        emit countChanged();
+    }
+}
+
+void LogModel::setFileLoggingEnabled(bool enabled)
+{
+    if (fileLoggingEnabled() == enabled) {
+        return;
+    }
+    flush();
+
+    if (enabled) {
+        QString logDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs";
+        m_logFilePath = logDir + "/debug-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".log";
+
+        // Start the file with what the console already holds
+        QStringList lines;
+        for (const LogEntry &entry : std::as_const(m_entries)) {
+            lines << formatLine(entry);
+        }
+        QMetaObject::invokeMethod(m_writer, [writer = m_writer, path = m_logFilePath, lines]() {
+            writer->open(path);
+            writer->write(lines);
+        }, Qt::QueuedConnection);
+    } else {
+        m_logFilePath.clear();
+        QMetaObject::invokeMethod(m_writer, &LogFileWriter::close, Qt::QueuedConnection);
+    }
+    emit fileLoggingEnabledChanged();
+}
+
+QString LogModel::formatLine(const LogEntry &entry)
+{
+    return QString("[%1] [%2] %3").arg(entry.timestamp.toString("yyyy-MM-dd HH:mm:ss.zzz"),
+                                       QString(SeverityNames[entry.severity]).toUpper(),
+                                       entry.message);
+}
@@ -0,0 +1,117 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+class QFile;
+
+struct LogEntry {
+    quint64 sequence; // Increases by one per message, survives trimming
+    QDateTime timestamp;
+    QString message;
+    int severity; // LogModel::Severity
+};
+
+// Appends lines to a log file on its own thread so disk I/O never blocks the UI
+class LogFileWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LogFileWriter(QObject *parent = nullptr);
+    ~LogFileWriter();
+
+public slots:
+    void open(const QString &filePath);
+    void close();
+    void write(const QStringList &lines);
+
+private:
+    QFile *m_file;
+};
+
+// Debug console backend. Keeps at most `capacity` entries (oldest dropped
+// first), applies the severity filter in C++ and coalesces inserts: messages
+// queue up and reach the view as one batch per frame, so the cost of logging
+// stays flat however long a batch runs.
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY countChanged)
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int minimumSeverity READ minimumSeverity WRITE setMinimumSeverity NOTIFY minimumSeverityChanged)
+    Q_PROPERTY(bool fileLoggingEnabled READ fileLoggingEnabled WRITE setFileLoggingEnabled NOTIFY fileLoggingEnabledChanged)
+    Q_PROPERTY(QString logFilePath READ logFilePath NOTIFY fileLoggingEnabledChanged)
+
+public:
+    enum Severity {
+        Info,
+        Success,
+        Warning,
+        Error
+    };
+    Q_ENUM(Severity)
+
+    enum Roles {
+        TimestampRole = Qt::UserRole + 1,
+        MessageRole,
+        TypeRole,
+        ColorRole
+    };
+
+    explicit LogModel(int capacity = 2000, QObject *parent = nullptr);
+    ~LogModel();
+
+    // QAbstractListModel interface
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_visible.size(); }
+    int totalCount() const { return m_entries.size(); }
+    int capacity() const { return m_capacity; }
+    void setCapacity(int capacity);
+    int minimumSeverity() const { return m_minimumSeverity; }
+    void setMinimumSeverity(int severity);
+    bool fileLoggingEnabled() const { return !m_logFilePath.isEmpty(); }
+    void setFileLoggingEnabled(bool enabled);
+    QString logFilePath() const { return m_logFilePath; }
+
+    static int severityFromType(const QString &type);
+
+public slots:
+    void append(const QString &message, const QString &type = "info");
+    void clear();
+    QString allText() const; // Visible entries, one "[time] message" per line
+
+signals:
+    void countChanged();
+    void capacityChanged();
+    void minimumSeverityChanged();
+    void fileLoggingEnabledChanged();
+
+private:
+    QList<LogEntry> m_entries;  // Everything kept, oldest first, at most m_capacity
+    QList<LogEntry> m_visible;  // Entries passing the severity filter, the model rows
+    QList<LogEntry> m_pending;  // Waiting for the next flush
+    quint64 m_nextSequence;
+    int m_capacity;
+    int m_minimumSeverity;
+    QTimer m_flushTimer;
+    QString m_logFilePath;
+    QThread m_writerThread;
+    LogFileWriter *m_writer;
+
+    void flush();
+    void trimVisible();
+    static QString formatLine(const LogEntry &entry);
+};
+
+#endif // LOGMODEL_H
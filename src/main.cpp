@@ -6,9 +6,20 @@
 #include <QQmlContext>
 #include "videocompressor.h"
 #include "clipboardmanager.h"
+#include "headlessrunner.h"
+#include "jobserver.h"
+#include "logmodel.h"
 
 int main(int argc, char *argv[])
 {
+    // Decide before any application object exists: headless runs use a
+    // QCoreApplication and never load QML, the Material style or the clipboard
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return HeadlessRunner::run(argc, argv);
+        }
+    }
+    
     QApplication app(argc, argv);
     
     // Set application properties
@@ -39,12 +50,25 @@ int main(int argc, char *argv[])
     QQmlApplicationEngine engine;
     
     // Create instances to be used in QML
+    LogModel logModel;
     VideoCompressor videoCompressor;
     ClipboardManager clipboardManager;
     
+    // Backend messages go straight to the bounded log model, not through QML
+    QObject::connect(&videoCompressor, &VideoCompressor::debugMessage, &logModel, &LogModel::append);
+    
+    // Other local programs submit jobs to this instance instead of starting their own
+    JobServer jobServer(&videoCompressor);
+    QObject::connect(&jobServer, &JobServer::debugMessage, &logModel, &LogModel::append);
+    jobServer.listen();
+    
+    // Serve thumbnails as image://thumbs/<id>/<revision> (engine takes ownership)
+    engine.addImageProvider("thumbs", videoCompressor.createThumbnailProvider());
+    
     // Make instances available to QML
     engine.rootContext()->setContextProperty("videoCompressor", &videoCompressor);
     engine.rootContext()->setContextProperty("clipboardManager", &clipboardManager);
+    engine.rootContext()->setContextProperty("logModel", &logModel);
     
     // Auto-detect videos from clipboard on startup ONLY
     if (clipboardManager.hasVideoUrl()) {
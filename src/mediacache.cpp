@@ -0,0 +1,181 @@
+#include "mediacache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutexLocker>
+
+MediaCache::MediaCache(const QString &cacheDir, qint64 maxBytes)
+    : m_cacheDir(cacheDir)
+    , m_maxBytes(maxBytes)
+    , m_sizeBytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    QDir().mkpath(m_cacheDir);
+
+    // One listing at startup, afterwards the size is tracked incrementally
+    const QFileInfoList files = QDir(m_cacheDir).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    for (const QFileInfo &file : files) {
+        if (file.size() == 0) {
+            // Left behind by lookups of earlier versions on a miss
+            QFile::remove(file.absoluteFilePath());
+            continue;
+        }
+        m_sizeBytes += file.size();
+    }
+}
+
+bool MediaCache::lookup(const QString &filePath, MediaCacheEntry *entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QString baseName = entryBaseName(filePath);
+    // Read-only, so a miss never leaves an empty entry behind
+    QFile jsonFile(m_cacheDir + "/" + baseName + ".json");
+    if (baseName.isEmpty() || !jsonFile.open(QIODevice::ReadOnly)) {
+        m_misses++;
+        return false;
+    }
+
+    QJsonObject json = QJsonDocument::fromJson(jsonFile.readAll()).object();
+    jsonFile.close();
+    if (json.value("version").toInt() != FormatVersion ||
+        json.value("path").toString() != QFileInfo(filePath).absoluteFilePath()) {
+        m_misses++;
+        return false;
+    }
+
+    // Touch the entry so size-cap eviction drops least recently used entries first
+    if (jsonFile.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+        jsonFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        jsonFile.close();
+    }
+
+    entry->durationSeconds = json.value("duration").toDouble();
+    entry->streamInfo = json.value("streams").toObject();
+    entry->thumbnailData.clear();
+
+    QFile thumbnailFile(m_cacheDir + "/" + baseName + ".jpg");
+    if (thumbnailFile.open(QIODevice::ReadOnly)) {
+        entry->thumbnailData = thumbnailFile.readAll();
+    }
+
+    m_hits++;
+    return true;
+}
+
+void MediaCache::store(const QString &filePath, const MediaCacheEntry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QString baseName = entryBaseName(filePath);
+    if (baseName.isEmpty()) {
+        return;
+    }
+
+    // Any older entry for this path belongs to a previous version of the file
+    removeEntriesFor(pathKey(filePath));
+
+    QJsonObject json;
+    json["version"] = FormatVersion;
+    json["path"] = QFileInfo(filePath).absoluteFilePath();
+    json["duration"] = entry.durationSeconds;
+    json["streams"] = entry.streamInfo;
+
+    QFile jsonFile(m_cacheDir + "/" + baseName + ".json");
+    if (!jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+    m_sizeBytes += jsonFile.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    jsonFile.close();
+
+    if (!entry.thumbnailData.isEmpty()) {
+        QFile thumbnailFile(m_cacheDir + "/" + baseName + ".jpg");
+        if (thumbnailFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_sizeBytes += thumbnailFile.write(entry.thumbnailData);
+        }
+    }
+
+    enforceSizeCap();
+}
+
+void MediaCache::invalidate(const QString &filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    removeEntriesFor(pathKey(filePath));
+}
+
+void MediaCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    QDir(m_cacheDir).removeRecursively();
+    QDir().mkpath(m_cacheDir);
+    m_sizeBytes = 0;
+}
+
+int MediaCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int MediaCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+qint64 MediaCache::sizeBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_sizeBytes;
+}
+
+QString MediaCache::pathKey(const QString &filePath) const
+{
+    QByteArray absolutePath = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    return QString::fromLatin1(QCryptographicHash::hash(absolutePath, QCryptographicHash::Sha1).toHex().left(16));
+}
+
+QString MediaCache::entryBaseName(const QString &filePath) const
+{
+    QFileInfo info(filePath);
+    if (!info.exists()) {
+        return QString();
+    }
+
+    // <path hash>_<size>_<mtime>: a changed file never matches a stale entry
+    return pathKey(filePath) + "_" + QString::number(info.size()) + "_" +
+           QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+void MediaCache::removeEntriesFor(const QString &pathKey)
+{
+    QDir cacheDir(m_cacheDir);
+    const QFileInfoList files = cacheDir.entryInfoList(QStringList() << pathKey + "_*", QDir::Files);
+    for (const QFileInfo &file : files) {
+        qint64 size = file.size();
+        if (QFile::remove(file.absoluteFilePath())) {
+            m_sizeBytes -= size;
+        }
+    }
+}
+
+void MediaCache::enforceSizeCap()
+{
+    if (m_sizeBytes <= m_maxBytes) {
+        return;
+    }
+
+    // Oldest entries last; trim to 90% so we don't evict on every store
+    QDir cacheDir(m_cacheDir);
+    const QFileInfoList entries = cacheDir.entryInfoList(QStringList() << "*.json", QDir::Files, QDir::Time);
+    qint64 limit = m_maxBytes * 9 / 10;
+
+    for (auto it = entries.crbegin(); it != entries.crend() && m_sizeBytes > limit; ++it) {
+        removeEntriesFor(it->completeBaseName().section('_', 0, 0));
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef MEDIACACHE_H
+#define MEDIACACHE_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+struct MediaCacheEntry {
+    double durationSeconds;
+    QJsonObject streamInfo;   // MediaInfo::toJson()
+    QByteArray thumbnailData; // Encoded JPEG, may be empty
+};
+
+// Persistent probe/thumbnail cache in the app data dir. Entries are keyed by
+// (absolute path, size, mtime), so a modified file simply misses and its old
+// entry is replaced on the next store. Thread-safe: lookups run on the GUI
+// thread, stores on the prober's worker threads.
+class MediaCache
+{
+public:
+    explicit MediaCache(const QString &cacheDir, qint64 maxBytes = 64 * 1024 * 1024);
+
+    bool lookup(const QString &filePath, MediaCacheEntry *entry);
+    void store(const QString &filePath, const MediaCacheEntry &entry);
+    void invalidate(const QString &filePath);
+    void clear();
+
+    int hits() const;
+    int misses() const;
+    qint64 sizeBytes() const;
+
+private:
+    static const int FormatVersion = 2; // 2: full stream info
+
+    QString m_cacheDir;
+    qint64 m_maxBytes;
+    qint64 m_sizeBytes;
+    int m_hits;
+    int m_misses;
+    mutable QMutex m_mutex;
+
+    QString pathKey(const QString &filePath) const;
+    QString entryBaseName(const QString &filePath) const; // Empty if the file is gone
+    void removeEntriesFor(const QString &pathKey);
+    void enforceSizeCap();
+};
+
+#endif // MEDIACACHE_H
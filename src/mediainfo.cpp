@@ -0,0 +1,214 @@
+#include "mediainfo.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace {
+
+// ffprobe reports numbers as strings ("128000", "30000/1001")
+int kbpsFromString(const QString &value)
+{
+    bool ok = false;
+    qint64 bitsPerSecond = value.toLongLong(&ok);
+    return ok && bitsPerSecond > 0 ? int(bitsPerSecond / 1000) : 0;
+}
+
+double rateFromString(const QString &value)
+{
+    QStringList parts = value.split('/');
+    double numerator = parts.value(0).toDouble();
+    double denominator = parts.size() > 1 ? parts[1].toDouble() : 1.0;
+    return denominator > 0 ? numerator / denominator : 0.0;
+}
+
+// Matroska keeps per-stream bitrates in statistics tags instead of bit_rate
+int streamBitRateKbps(const QJsonObject &stream)
+{
+    int kbps = kbpsFromString(stream.value("bit_rate").toString());
+    if (kbps > 0) {
+        return kbps;
+    }
+
+    const QJsonObject tags = stream.value("tags").toObject();
+    for (auto it = tags.constBegin(); it != tags.constEnd(); ++it) {
+        if (it.key() == "BPS" || it.key().startsWith("BPS-")) {
+            return kbpsFromString(it.value().toString());
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int MediaInfo::audioBitRateKbps() const
+{
+    return audioStreams.isEmpty() ? 0 : audioStreams.first().bitRateKbps;
+}
+
+int MediaInfo::estimatedVideoBitRateKbps() const
+{
+    if (videoBitRateKbps > 0) {
+        return videoBitRateKbps;
+    }
+
+    // Fall back to the container bitrate minus the audio we know about
+    int audioTotal = 0;
+    for (const AudioStreamInfo &audio : audioStreams) {
+        audioTotal += audio.bitRateKbps;
+    }
+    return qMax(0, bitRateKbps - audioTotal);
+}
+
+bool MediaInfo::isDiscordPlayable(const QString &fileSuffix) const
+{
+    // Discord embeds H.264/VP8/VP9/AV1 video in MP4/MOV/WebM with common audio codecs
+    static const QStringList containers = {"mp4", "mov", "m4v", "webm"};
+    static const QStringList videoCodecs = {"h264", "vp8", "vp9", "av1"};
+    static const QStringList audioCodecs = {"aac", "mp3", "opus", "vorbis"};
+
+    if (!valid || !hasVideo || !containers.contains(fileSuffix.toLower())) {
+        return false;
+    }
+    if (!videoCodecs.contains(videoCodec)) {
+        return false;
+    }
+    // Browsers only decode 8-bit 4:2:0 reliably
+    if (!pixelFormat.isEmpty() && pixelFormat != "yuv420p" && pixelFormat != "yuvj420p") {
+        return false;
+    }
+    for (const AudioStreamInfo &audio : audioStreams) {
+        if (!audioCodecs.contains(audio.codec)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString MediaInfo::summary() const
+{
+    if (!valid) {
+        return "unknown";
+    }
+
+    QString text = hasVideo
+        ? QString("%1 %2x%3 @ %4 fps").arg(videoCodec).arg(width).arg(height).arg(QString::number(frameRate, 'f', 2))
+        : QString("no video");
+
+    if (audioStreams.isEmpty()) {
+        text += ", no audio";
+    } else {
+        const AudioStreamInfo &audio = audioStreams.first();
+        text += QString(", %1 audio (%2%3)")
+                    .arg(audioStreams.size())
+                    .arg(audio.codec)
+                    .arg(audio.bitRateKbps > 0 ? QString(" %1k").arg(audio.bitRateKbps) : QString());
+    }
+    return text;
+}
+
+MediaInfo MediaInfo::fromFfprobeJson(const QByteArray &json)
+{
+    MediaInfo info;
+    QJsonObject root = QJsonDocument::fromJson(json).object();
+    if (root.isEmpty()) {
+        return info;
+    }
+
+    const QJsonObject format = root.value("format").toObject();
+    info.formatName = format.value("format_name").toString();
+    info.durationSeconds = format.value("duration").toString().toDouble();
+    info.bitRateKbps = kbpsFromString(format.value("bit_rate").toString());
+
+    const QJsonArray streams = root.value("streams").toArray();
+    for (const QJsonValue &value : streams) {
+        const QJsonObject stream = value.toObject();
+        const QString type = stream.value("codec_type").toString();
+
+        // Cover art shows up as a video stream, skip it
+        bool attachedPicture = stream.value("disposition").toObject().value("attached_pic").toInt() == 1;
+
+        if (type == "video" && !info.hasVideo && !attachedPicture) {
+            info.hasVideo = true;
+            info.videoCodec = stream.value("codec_name").toString();
+            info.pixelFormat = stream.value("pix_fmt").toString();
+            info.width = stream.value("width").toInt();
+            info.height = stream.value("height").toInt();
+            info.frameRate = rateFromString(stream.value("avg_frame_rate").toString());
+            if (info.frameRate <= 0) {
+                info.frameRate = rateFromString(stream.value("r_frame_rate").toString());
+            }
+            info.videoBitRateKbps = streamBitRateKbps(stream);
+        } else if (type == "audio") {
+            AudioStreamInfo audio;
+            audio.index = stream.value("index").toInt();
+            audio.codec = stream.value("codec_name").toString();
+            audio.channels = stream.value("channels").toInt();
+            audio.sampleRate = stream.value("sample_rate").toString().toInt();
+            audio.bitRateKbps = streamBitRateKbps(stream);
+            audio.language = stream.value("tags").toObject().value("language").toString();
+            info.audioStreams.append(audio);
+        }
+    }
+
+    info.valid = info.durationSeconds > 0;
+    return info;
+}
+
+MediaInfo MediaInfo::fromJson(const QJsonObject &json)
+{
+    MediaInfo info;
+    info.valid = json.value("valid").toBool();
+    info.formatName = json.value("format").toString();
+    info.durationSeconds = json.value("duration").toDouble();
+    info.bitRateKbps = json.value("bitRate").toInt();
+    info.hasVideo = json.value("hasVideo").toBool();
+    info.videoCodec = json.value("videoCodec").toString();
+    info.pixelFormat = json.value("pixelFormat").toString();
+    info.width = json.value("width").toInt();
+    info.height = json.value("height").toInt();
+    info.frameRate = json.value("frameRate").toDouble();
+    info.videoBitRateKbps = json.value("videoBitRate").toInt();
+
+    const QJsonArray audioArray = json.value("audio").toArray();
+    for (const QJsonValue &value : audioArray) {
+        const QJsonObject object = value.toObject();
+        AudioStreamInfo audio;
+        audio.index = object.value("index").toInt();
+        audio.codec = object.value("codec").toString();
+        audio.channels = object.value("channels").toInt();
+        audio.sampleRate = object.value("sampleRate").toInt();
+        audio.bitRateKbps = object.value("bitRate").toInt();
+        audio.language = object.value("language").toString();
+        info.audioStreams.append(audio);
+    }
+    return info;
+}
+
+QJsonObject MediaInfo::toJson() const
+{
+    QJsonObject json;
+    json["valid"] = valid;
+    json["format"] = formatName;
+    json["duration"] = durationSeconds;
+    json["bitRate"] = bitRateKbps;
+    json["hasVideo"] = hasVideo;
+    json["videoCodec"] = videoCodec;
+    json["pixelFormat"] = pixelFormat;
+    json["width"] = width;
+    json["height"] = height;
+    json["frameRate"] = frameRate;
+    json["videoBitRate"] = videoBitRateKbps;
+
+    QJsonArray audioArray;
+    for (const AudioStreamInfo &audio : audioStreams) {
+        QJsonObject object;
+        object["index"] = audio.index;
+        object["codec"] = audio.codec;
+        object["channels"] = audio.channels;
+        object["sampleRate"] = audio.sampleRate;
+        object["bitRate"] = audio.bitRateKbps;
+        object["language"] = audio.language;
+        audioArray.append(object);
+    }
+    json["audio"] = audioArray;
+    return json;
+}
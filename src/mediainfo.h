@@ -0,0 +1,46 @@
+#ifndef MEDIAINFO_H
+#define MEDIAINFO_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+struct AudioStreamInfo {
+    int index;          // Stream index in the container
+    QString codec;      // codec_name, e.g. "aac"
+    int channels;
+    int sampleRate;
+    int bitRateKbps;    // 0 when the container doesn't say
+    QString language;
+};
+
+// Structured result of one `ffprobe -show_streams -show_format` call
+struct MediaInfo {
+    bool valid = false;
+    QString formatName;       // e.g. "mov,mp4,m4a,3gp,3g2,mj2"
+    double durationSeconds = 0.0;
+    int bitRateKbps = 0;      // Overall container bitrate
+
+    bool hasVideo = false;
+    QString videoCodec;       // e.g. "h264"
+    QString pixelFormat;      // e.g. "yuv420p"
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+    int videoBitRateKbps = 0; // 0 when the container doesn't say
+
+    QList<AudioStreamInfo> audioStreams;
+
+    bool hasAudio() const { return !audioStreams.isEmpty(); }
+    int audioBitRateKbps() const; // First audio stream, 0 if unknown
+    int estimatedVideoBitRateKbps() const;
+    bool isDiscordPlayable(const QString &fileSuffix) const;
+    QString summary() const;
+
+    static MediaInfo fromFfprobeJson(const QByteArray &json);
+    static MediaInfo fromJson(const QJsonObject &json);
+    QJsonObject toJson() const;
+};
+
+#endif // MEDIAINFO_H
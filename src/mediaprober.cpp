@@ -0,0 +1,175 @@
+#include "mediaprober.h"
+#include "containerreader.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QThread>
+
+MediaProber::MediaProber(const QString &thumbnailDir, QSharedPointer<MediaCache> cache, QObject *parent)
+    : QObject(parent)
+    , m_thumbnailDir(thumbnailDir)
+    , m_cache(cache)
+    , m_pendingCount(0)
+    , m_thumbnailsEnabled(true)
+{
+    // Keep ingestion small and below the encoders so an active batch is not starved
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 4, 4));
+    m_pool.setThreadPriority(QThread::LowPriority);
+}
+
+MediaProber::~MediaProber()
+{
+    // Drop queued probes and wait for the running ones
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void MediaProber::probe(quint64 id, const QString &path)
+{
+    m_pendingCount++;
+
+    m_pool.start([this, id, path]() {
+        MediaProbeResult result = runProbe(id, path);
+
+        // Deliver on the thread that owns the prober
+        QMetaObject::invokeMethod(this, [this, result]() {
+            m_pendingCount--;
+            emit probeFinished(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+MediaProbeResult MediaProber::runProbe(quint64 id, const QString &path)
+{
+    MediaProbeResult result;
+    result.id = id;
+    result.path = path;
+    result.media = probeMediaInfo(path);
+    if (m_thumbnailsEnabled) {
+        result.thumbnailData = extractThumbnail(id, path, result.media.durationSeconds);
+    }
+
+    // Failed probes are not cached so they are retried next time; neither are
+    // thumbnail-less headless results, the GUI would show placeholders for them
+    if (m_cache && result.media.valid && m_thumbnailsEnabled) {
+        MediaCacheEntry entry;
+        entry.durationSeconds = result.media.durationSeconds;
+        entry.streamInfo = result.media.toJson();
+        entry.thumbnailData = result.thumbnailData;
+        m_cache->store(path, entry);
+    }
+    return result;
+}
+
+MediaInfo MediaProber::probeMediaInfo(const QString &filePath)
+{
+    // Most MP4/MOV/MKV/WebM files describe themselves in their headers
+    QString whyNot;
+    MediaInfo native = ContainerReader::read(filePath, &whyNot);
+    if (native.valid) {
+        emit debugMessage("Read the container header of " + QFileInfo(filePath).fileName() + ": " +
+                          QString::number(native.durationSeconds, 'f', 1) + " seconds, " + native.summary(), "success");
+        return native;
+    }
+    emit debugMessage("Container header of " + QFileInfo(filePath).fileName() + " not used (" + whyNot + ")", "info");
+
+    // One ffprobe call for format, video and audio details
+    QProcess process;
+    QStringList args;
+    args << "-v" << "quiet"
+         << "-print_format" << "json"
+         << "-show_streams"
+         << "-show_format"
+         << filePath;
+
+    emit debugMessage("Probing media info for: " + QFileInfo(filePath).fileName(), "info");
+    emit debugMessage("FFprobe command: ffprobe " + args.join(" "), "info");
+
+    process.start("ffprobe", args);
+    bool started = process.waitForStarted(5000);
+
+    if (!started) {
+        emit debugMessage("Failed to start FFprobe process for media detection", "error");
+        emit debugMessage("FFprobe might not be installed or not in PATH", "error");
+        return MediaInfo();
+    }
+
+    if (!process.waitForFinished(10000)) {
+        emit debugMessage("FFprobe timed out for: " + filePath, "error");
+        process.kill();
+        return MediaInfo();
+    }
+
+    if (process.exitCode() != 0) {
+        QString errorOutput = QString::fromUtf8(process.readAllStandardError());
+        emit debugMessage("FFprobe failed for " + filePath + " (exit code: " + QString::number(process.exitCode()) + ")", "error");
+        emit debugMessage("FFprobe error: " + errorOutput, "error");
+        return MediaInfo();
+    }
+
+    MediaInfo info = MediaInfo::fromFfprobeJson(process.readAllStandardOutput());
+
+    if (info.valid) {
+        emit debugMessage("Duration detected: " + QString::number(info.durationSeconds, 'f', 1) + " seconds", "success");
+        emit debugMessage("Streams: " + info.summary(), "info");
+    } else {
+        emit debugMessage("Invalid media info from FFprobe for: " + QFileInfo(filePath).fileName(), "error");
+    }
+    return info;
+}
+
+QByteArray MediaProber::extractThumbnail(quint64 id, const QString &filePath, double durationSeconds)
+{
+    // The id keeps names unique when two inputs share a base name
+    QDir().mkpath(m_thumbnailDir);
+    QString thumbnailPath = m_thumbnailDir + "/" + QFileInfo(filePath).baseName() +
+                            "_" + QString::number(id) + "_thumb.jpg";
+    QString fileName = QFileInfo(filePath).fileName();
+
+    // Use FFmpeg to extract a frame at 10% of video duration
+    QProcess thumbnailProcess;
+    QStringList args;
+
+    // Calculate seek time (10% of duration, or 5 seconds if duration unknown)
+    double seekTime = durationSeconds > 0 ? durationSeconds * 0.1 : 5.0;
+
+    // Seek before -i so FFmpeg jumps to the nearest keyframe instead of decoding up to it
+    args << "-ss" << QString::number(seekTime, 'f', 2)
+         << "-i" << filePath
+         << "-vframes" << "1"
+         << "-q:v" << "2"  // High quality
+         << "-threads" << "1"
+         << "-vf" << "scale=120:68:force_original_aspect_ratio=decrease,pad=120:68:(ow-iw)/2:(oh-ih)/2:black"
+         << "-y" << thumbnailPath;
+
+    emit debugMessage("Generating thumbnail for: " + fileName, "info");
+
+    QByteArray thumbnail;
+    thumbnailProcess.start("ffmpeg", args);
+    if (thumbnailProcess.waitForFinished(10000)) {
+        if (thumbnailProcess.exitCode() == 0 && QFileInfo::exists(thumbnailPath)) {
+            // Keep the encoded bytes, decoding happens lazily in the thumbnail cache
+            QFile thumbnailFile(thumbnailPath);
+            if (thumbnailFile.open(QIODevice::ReadOnly)) {
+                thumbnail = thumbnailFile.readAll();
+                thumbnailFile.close();
+            }
+            if (!thumbnail.isEmpty()) {
+                emit debugMessage("Thumbnail generated successfully for: " + fileName, "success");
+            } else {
+                emit debugMessage("Failed to load generated thumbnail for: " + fileName, "warning");
+            }
+            // Clean up temporary thumbnail file
+            QFile::remove(thumbnailPath);
+        } else {
+            QString errorOutput = QString::fromUtf8(thumbnailProcess.readAllStandardError());
+            emit debugMessage("Thumbnail generation failed for " + fileName + ": " + errorOutput, "warning");
+        }
+    } else {
+        emit debugMessage("Thumbnail generation timed out for: " + fileName, "warning");
+        thumbnailProcess.kill();
+    }
+
+    return thumbnail;
+}
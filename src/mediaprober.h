@@ -0,0 +1,53 @@
+#ifndef MEDIAPROBER_H
+#define MEDIAPROBER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "mediacache.h"
+#include "mediainfo.h"
+
+struct MediaProbeResult {
+    quint64 id;
+    QString path;
+    MediaInfo media; // Invalid when ffprobe failed
+    QByteArray thumbnailData; // Encoded JPEG, empty when generation failed
+};
+
+// Runs ffprobe/ffmpeg for newly added videos on a small, low priority
+// worker pool so the GUI thread never waits on child processes.
+class MediaProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    // thumbnailDir holds frames while they are extracted; it must not be a
+    // folder the batch cleanup empties, probes run during a batch
+    MediaProber(const QString &thumbnailDir, QSharedPointer<MediaCache> cache, QObject *parent = nullptr);
+    ~MediaProber();
+
+    void probe(quint64 id, const QString &path);
+    int pendingCount() const { return m_pendingCount; }
+
+    // Headless runs skip the extra ffmpeg call per file; set before probing
+    void setThumbnailsEnabled(bool enabled) { m_thumbnailsEnabled = enabled; }
+
+signals:
+    void probeFinished(const MediaProbeResult &result);
+    void debugMessage(const QString &message, const QString &type = "info");
+
+private:
+    QThreadPool m_pool;
+    QString m_thumbnailDir;
+    QSharedPointer<MediaCache> m_cache; // Results are stored here for the next session
+    int m_pendingCount;
+    bool m_thumbnailsEnabled;
+
+    // Run on worker threads
+    MediaProbeResult runProbe(quint64 id, const QString &path);
+    MediaInfo probeMediaInfo(const QString &filePath);
+    QByteArray extractThumbnail(quint64 id, const QString &filePath, double durationSeconds);
+};
+
+#endif // MEDIAPROBER_H
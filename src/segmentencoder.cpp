@@ -0,0 +1,372 @@
+#include "segmentencoder.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+SegmentEncoder::SegmentEncoder(const Settings &settings, QObject *parent)
+    : QObject(parent)
+    , m_settings(settings)
+    , m_keyframeProcess(nullptr)
+    , m_audioProcess(nullptr)
+    , m_concatProcess(nullptr)
+    , m_audioDone(true)
+    , m_failed(false)
+{
+}
+
+SegmentEncoder::~SegmentEncoder()
+{
+    // Processes are children and get killed with us; remove every temp file
+    QList<QProcess *> processes = findChildren<QProcess *>();
+    for (QProcess *process : processes) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(1000);
+    }
+
+    QFileInfo prefixInfo(m_settings.workPrefix);
+    QDir workDir = prefixInfo.absoluteDir();
+    const QStringList files = workDir.entryList(QStringList() << prefixInfo.fileName() + "_*", QDir::Files);
+    for (const QString &file : files) {
+        QFile::remove(workDir.filePath(file));
+    }
+}
+
+void SegmentEncoder::start()
+{
+    emit debugMessage(QString("Segmented encode: splitting %1 min into %2 chunks, %3 threads each")
+                     .arg(QString::number(m_settings.durationSeconds / 60.0, 'f', 1))
+                     .arg(m_settings.chunkCount)
+                     .arg(m_settings.threadsPerChunk), "info");
+
+    if (m_settings.audioBitrateKbps > 0) {
+        startAudio();
+    }
+    findKeyframes();
+}
+
+void SegmentEncoder::rerunSecondPass(int videoBitrateKbps)
+{
+    m_settings.videoBitrateKbps = videoBitrateKbps;
+    if (m_concatProcess) {
+        m_concatProcess->deleteLater();
+        m_concatProcess = nullptr;
+    }
+
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        Chunk &chunk = m_chunks[i];
+        chunk.pass = 2;
+        chunk.doneSeconds = chunk.duration;
+        chunk.finished = false;
+        startChunk(i);
+    }
+}
+
+void SegmentEncoder::findKeyframes()
+{
+    // Seek to every nominal split point and read one packet; demuxer seeks land
+    // on the keyframe at or before the requested time
+    QStringList intervals;
+    for (int i = 1; i < m_settings.chunkCount; ++i) {
+        double nominal = m_settings.durationSeconds * i / m_settings.chunkCount;
+        intervals << QString("%1%+#1").arg(QString::number(nominal, 'f', 3));
+    }
+
+    m_keyframeProcess = new QProcess(this);
+    connect(m_keyframeProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &SegmentEncoder::onKeyframesFound);
+    failOnStartError(m_keyframeProcess, "Keyframe lookup");
+
+    QStringList args;
+    args << "-v" << "quiet"
+         << "-select_streams" << "v:0"
+         << "-show_entries" << "packet=pts_time,flags"
+         << "-of" << "csv=p=0"
+         << "-read_intervals" << intervals.join(",")
+         << m_settings.sourcePath;
+    m_keyframeProcess->start("ffprobe", args);
+}
+
+void SegmentEncoder::onKeyframesFound()
+{
+    QList<double> boundaries;
+    const QStringList lines = QString::fromUtf8(m_keyframeProcess->readAllStandardOutput()).split('\n');
+    for (const QString &line : lines) {
+        QStringList fields = line.trimmed().split(',');
+        bool ok = false;
+        double time = fields.value(0).toDouble(&ok);
+        if (ok && fields.value(1).startsWith('K') && time > 1.0 &&
+            time < m_settings.durationSeconds - 1.0 && !boundaries.contains(time)) {
+            boundaries.append(time);
+        }
+    }
+    m_keyframeProcess->deleteLater();
+    m_keyframeProcess = nullptr;
+
+    // Sparse keyframes can collapse split points; fall back to exact cuts
+    if (boundaries.size() < m_settings.chunkCount - 1) {
+        emit debugMessage("Keyframe lookup gave " + QString::number(boundaries.size()) +
+                         " split points, using evenly spaced cuts", "warning");
+        boundaries.clear();
+        for (int i = 1; i < m_settings.chunkCount; ++i) {
+            boundaries.append(m_settings.durationSeconds * i / m_settings.chunkCount);
+        }
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+
+    double start = 0.0;
+    boundaries.append(m_settings.durationSeconds);
+    for (int i = 0; i < boundaries.size(); ++i) {
+        Chunk chunk;
+        chunk.start = start;
+        chunk.duration = boundaries[i] - start;
+        chunk.doneSeconds = 0.0;
+        chunk.pass = m_settings.twoPass ? 1 : 0;
+        chunk.process = nullptr;
+        chunk.path = m_settings.workPrefix + "_chunk" + QString::number(i) + ".mkv";
+        chunk.finished = false;
+        m_chunks.append(chunk);
+        start = boundaries[i];
+    }
+
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        startChunk(i);
+    }
+}
+
+void SegmentEncoder::startChunk(int chunkIndex)
+{
+    Chunk &chunk = m_chunks[chunkIndex];
+    if (chunk.process) {
+        chunk.process->deleteLater();
+    }
+    chunk.process = new QProcess(this);
+    QProcess *process = chunk.process;
+
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, chunkIndex](int exitCode, QProcess::ExitStatus exitStatus) {
+        onChunkFinished(chunkIndex, exitCode, exitStatus);
+    });
+    failOnStartError(process, QString("Chunk %1").arg(chunkIndex + 1));
+
+    chunk.parser = FFmpegProgressParser();
+    chunk.last = FFmpegProgress();
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, chunkIndex, process]() {
+        Chunk &chunk = m_chunks[chunkIndex];
+        const QList<FFmpegProgress> blocks = chunk.parser.feed(process->readAllStandardOutput());
+        if (!blocks.isEmpty()) {
+            chunk.last = blocks.last();
+            double passOffset = chunk.pass == 2 ? chunk.duration : 0.0;
+            chunk.doneSeconds = passOffset + qMin(chunk.last.outTimeSeconds, chunk.duration);
+            reportProgress();
+        }
+    });
+
+    QString bitrate = QString("%1k").arg(m_settings.videoBitrateKbps);
+    QStringList args = FFmpegProgressParser::arguments();
+    if (chunk.start > 0) {
+        args << "-ss" << QString::number(chunk.start, 'f', 3);
+    }
+    args << "-i" << m_settings.sourcePath
+         << "-t" << QString::number(chunk.duration, 'f', 3)
+         << "-map" << "0:v:0"
+         << "-an" << "-sn"
+         << "-c:v" << m_settings.encoderName
+         << "-b:v" << bitrate;
+    if (!m_settings.twoPass) {
+        // Same VBV limits as the whole-file single-pass mode
+        args << "-maxrate" << bitrate
+             << "-bufsize" << QString("%1k").arg(m_settings.videoBitrateKbps * 2);
+    }
+    args << "-threads" << QString::number(m_settings.threadsPerChunk)
+         << m_settings.extraVideoArgs;
+
+    if (chunk.pass > 0) {
+        args << "-pass" << QString::number(chunk.pass)
+             << "-passlogfile" << m_settings.workPrefix + "_chunk" + QString::number(chunkIndex) + "_pass";
+    }
+
+    if (chunk.pass == 1) {
+        args << "-f" << "null" << "-";
+    } else {
+        args << "-f" << "matroska" << "-y" << chunk.path;
+    }
+
+    process->start("ffmpeg", args);
+}
+
+void SegmentEncoder::onChunkFinished(int chunkIndex, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (m_failed) {
+        return;
+    }
+
+    Chunk &chunk = m_chunks[chunkIndex];
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        QString errorOutput = QString::fromUtf8(chunk.process->readAllStandardError()).trimmed();
+        fail(QString("Chunk %1 failed (exit code %2) %3").arg(chunkIndex + 1).arg(exitCode)
+                                                          .arg(errorOutput.split('\n').last()));
+        return;
+    }
+
+    if (chunk.pass == 1) {
+        chunk.pass = 2;
+        chunk.doneSeconds = chunk.duration;
+        startChunk(chunkIndex);
+        return;
+    }
+
+    chunk.finished = true;
+    chunk.doneSeconds = chunk.duration * (m_settings.twoPass ? 2 : 1);
+    chunk.last = FFmpegProgress();
+    chunk.process->deleteLater();
+    chunk.process = nullptr;
+    reportProgress();
+    maybeConcat();
+}
+
+void SegmentEncoder::startAudio()
+{
+    m_audioDone = false;
+    m_audioPath = m_settings.workPrefix + "_audio.m4a";
+    m_audioProcess = new QProcess(this);
+
+    connect(m_audioProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        m_audioDone = true;
+        m_audioProcess->deleteLater();
+        m_audioProcess = nullptr;
+        if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+            fail("Audio encode failed (exit code " + QString::number(exitCode) + ")");
+            return;
+        }
+        maybeConcat();
+    });
+    failOnStartError(m_audioProcess, "Audio encode");
+
+    QStringList args;
+    args << "-i" << m_settings.sourcePath
+         << "-map" << "0:a:0"
+         << "-vn"
+         << "-c:a" << "aac"
+         << "-b:a" << QString("%1k").arg(m_settings.audioBitrateKbps)
+         << "-y" << m_audioPath;
+    m_audioProcess->start("ffmpeg", args);
+}
+
+void SegmentEncoder::maybeConcat()
+{
+    if (m_failed || !m_audioDone || m_chunks.isEmpty() || m_concatProcess) {
+        return;
+    }
+    for (const Chunk &chunk : std::as_const(m_chunks)) {
+        if (!chunk.finished) {
+            return;
+        }
+    }
+    startConcat();
+}
+
+void SegmentEncoder::startConcat()
+{
+    QString listPath = m_settings.workPrefix + "_chunks.txt";
+    QFile listFile(listPath);
+    if (!listFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        fail("Cannot write concat list " + listPath);
+        return;
+    }
+    QTextStream stream(&listFile);
+    for (const Chunk &chunk : std::as_const(m_chunks)) {
+        QString escaped = QFileInfo(chunk.path).absoluteFilePath().replace("'", "'\\''");
+        stream << "file '" << escaped << "'\n";
+    }
+    listFile.close();
+
+    emit progressChanged(96, "Joining chunks...");
+
+    m_concatProcess = new QProcess(this);
+    connect(m_concatProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+            fail("Concat failed (exit code " + QString::number(exitCode) + ")");
+            return;
+        }
+        emit finished(true, QString("Joined %1 chunks").arg(m_chunks.size()));
+    });
+    failOnStartError(m_concatProcess, "Concat");
+
+    // Stream copy only: the join is lossless and takes seconds
+    QStringList args;
+    args << "-f" << "concat" << "-safe" << "0" << "-i" << listPath;
+    if (!m_audioPath.isEmpty()) {
+        args << "-i" << m_audioPath
+             << "-map" << "0:v:0"
+             << "-map" << "1:a:0";
+    }
+    args << "-c" << "copy"
+         << "-movflags" << "+faststart"
+         << "-y" << m_settings.outputPath;
+    m_concatProcess->start("ffmpeg", args);
+}
+
+void SegmentEncoder::failOnStartError(QProcess *process, const QString &step)
+{
+    // finished() never comes for a process that didn't start; queued so a
+    // synchronous failure inside start() doesn't tear down the caller
+    connect(process, &QProcess::errorOccurred, this, [this, step](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            fail(step + " could not start ffmpeg/ffprobe");
+        }
+    }, Qt::QueuedConnection);
+}
+
+void SegmentEncoder::fail(const QString &message)
+{
+    if (m_failed) {
+        return;
+    }
+    m_failed = true;
+
+    const QList<QProcess *> processes = findChildren<QProcess *>();
+    for (QProcess *process : processes) {
+        process->disconnect(this);
+        process->kill();
+    }
+    emit finished(false, message);
+}
+
+void SegmentEncoder::reportProgress()
+{
+    double total = 0.0;
+    double done = 0.0;
+    int finishedChunks = 0;
+    int passes = m_settings.twoPass ? 2 : 1;
+    FFmpegProgress combined;
+    for (const Chunk &chunk : std::as_const(m_chunks)) {
+        total += chunk.duration * passes;
+        done += chunk.doneSeconds;
+        if (chunk.finished) {
+            finishedChunks++;
+        }
+        combined.frame += chunk.last.frame;
+        combined.fps += chunk.last.fps;
+        combined.speed += chunk.last.speed;
+        combined.totalSizeBytes += chunk.last.totalSizeBytes;
+        combined.outTimeSeconds += chunk.last.outTimeSeconds;
+    }
+    if (total <= 0) {
+        return;
+    }
+
+    if (combined.outTimeSeconds > 0) {
+        combined.bitrateKbps = combined.totalSizeBytes * 8.0 / 1000.0 / combined.outTimeSeconds;
+    }
+    int eta = combined.speed > 0 ? qRound((total - done) / combined.speed) : -1;
+    emit throughputChanged(combined, eta);
+
+    // Chunk encodes map to 0-95%, the concat step finishes the rest
+    int percent = int(done / total * 100);
+    emit progressChanged(qMin(95, int(done / total * 95)),
+                         QString("Chunks %1/%2: %3%").arg(finishedChunks).arg(m_chunks.size()).arg(percent));
+}
@@ -0,0 +1,82 @@
+#ifndef SEGMENTENCODER_H
+#define SEGMENTENCODER_H
+
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include "ffmpegprogress.h"
+
+// Encodes one long video as several keyframe-aligned chunks in parallel and
+// joins them losslessly with the concat demuxer. Audio is encoded once next
+// to the chunks and muxed in the concat step.
+class SegmentEncoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings {
+        QString sourcePath;
+        QString workPrefix;      // Temp files are <workPrefix>_chunk<N>.mkv etc.
+        QString outputPath;
+        double durationSeconds;
+        int chunkCount;
+        int threadsPerChunk;
+        int videoBitrateKbps;    // Every chunk gets budget in proportion to its length
+        int audioBitrateKbps;    // 0 = no audio
+        bool twoPass;
+        QString encoderName;
+        QStringList extraVideoArgs; // e.g. -pix_fmt yuv420p
+    };
+
+    explicit SegmentEncoder(const Settings &settings, QObject *parent = nullptr);
+    ~SegmentEncoder();
+
+    void start();
+    // Two-pass only, after finished(true): re-encodes pass 2 of every chunk
+    // from the kept stats and joins again, the audio is reused
+    void rerunSecondPass(int videoBitrateKbps);
+    int chunkCount() const { return m_chunks.size(); }
+    int threadCount() const { return m_chunks.size() * m_settings.threadsPerChunk; }
+
+signals:
+    void progressChanged(int progress, const QString &statusText);
+    void throughputChanged(const FFmpegProgress &progress, int etaSeconds); // Summed over running chunks
+    void finished(bool success, const QString &message);
+    void debugMessage(const QString &message, const QString &type = "info");
+
+private:
+    struct Chunk {
+        double start;
+        double duration;
+        double doneSeconds;  // Encoded seconds, both passes counted
+        int pass;            // 0 = single pass, 1/2 for two-pass
+        QProcess *process;
+        FFmpegProgressParser parser;
+        FFmpegProgress last;  // Latest block of the running pass
+        QString path;
+        bool finished;
+    };
+
+    Settings m_settings;
+    QList<Chunk> m_chunks;
+    QProcess *m_keyframeProcess;
+    QProcess *m_audioProcess;
+    QProcess *m_concatProcess;
+    QString m_audioPath;
+    bool m_audioDone;
+    bool m_failed;
+
+    void findKeyframes();
+    void onKeyframesFound();
+    void startChunk(int chunkIndex);
+    void onChunkFinished(int chunkIndex, int exitCode, QProcess::ExitStatus exitStatus);
+    void startAudio();
+    void maybeConcat();
+    void startConcat();
+    void failOnStartError(QProcess *process, const QString &step);
+    void fail(const QString &message);
+    void reportProgress();
+};
+
+#endif // SEGMENTENCODER_H
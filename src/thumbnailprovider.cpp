@@ -0,0 +1,69 @@
+#include "thumbnailprovider.h"
+#include <QMutexLocker>
+
+ThumbnailCache::ThumbnailCache(qsizetype maxDecodedBytes)
+{
+    m_decoded.setMaxCost(maxDecodedBytes);
+}
+
+void ThumbnailCache::insert(const QString &id, const QByteArray &encoded)
+{
+    QMutexLocker locker(&m_mutex);
+    m_encoded.insert(id, encoded);
+    m_decoded.remove(id); // Decode the new bytes on next request
+}
+
+void ThumbnailCache::remove(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    m_encoded.remove(id);
+    m_decoded.remove(id);
+}
+
+void ThumbnailCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_encoded.clear();
+    m_decoded.clear();
+}
+
+QImage ThumbnailCache::image(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (QImage *cached = m_decoded.object(id)) {
+        return *cached;
+    }
+
+    auto it = m_encoded.constFind(id);
+    if (it == m_encoded.constEnd()) {
+        return QImage();
+    }
+
+    QImage decoded = QImage::fromData(it.value());
+    if (!decoded.isNull()) {
+        m_decoded.insert(id, new QImage(decoded), decoded.sizeInBytes());
+    }
+    return decoded;
+}
+
+ThumbnailProvider::ThumbnailProvider(QSharedPointer<ThumbnailCache> cache)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_cache(cache)
+{
+}
+
+QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    // Strip the "/<revision>" suffix, the cache is keyed by video id only
+    QImage image = m_cache->image(id.section('/', 0, 0));
+
+    if (size) {
+        *size = image.size();
+    }
+
+    if (!image.isNull() && requestedSize.isValid() && requestedSize != image.size()) {
+        return image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
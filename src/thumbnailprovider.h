@@ -0,0 +1,42 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickImageProvider>
+#include <QSharedPointer>
+
+// Thread-safe thumbnail store. Keeps the small encoded (JPEG/PNG) bytes for
+// every video and a memory-capped cache of decoded images in front of them.
+class ThumbnailCache
+{
+public:
+    explicit ThumbnailCache(qsizetype maxDecodedBytes = 16 * 1024 * 1024);
+
+    void insert(const QString &id, const QByteArray &encoded);
+    void remove(const QString &id);
+    void clear();
+    QImage image(const QString &id);
+
+private:
+    QMutex m_mutex;
+    QHash<QString, QByteArray> m_encoded;
+    QCache<QString, QImage> m_decoded; // Cost is the decoded size in bytes
+};
+
+// Serves image://thumbs/<videoId>/<revision> to QML. The revision only
+// exists to make QML reload when a thumbnail is replaced.
+class ThumbnailProvider : public QQuickImageProvider
+{
+public:
+    explicit ThumbnailProvider(QSharedPointer<ThumbnailCache> cache);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    QSharedPointer<ThumbnailCache> m_cache;
+};
+
+#endif // THUMBNAILPROVIDER_H
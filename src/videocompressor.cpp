@@ -1,17 +1,19 @@
 #include "videocompressor.h"
+#include "containerreader.h"
+#include "filedelivery.h"
 #include <QDebug>
 #include <QFileInfo>
 #include <QDir>
 #include <QStandardPaths>
 #include <QClipboard>
-#include <QApplication>
+#include <QGuiApplication>
 #include <QMimeData>
 #include <QUrl>
 #include <QFileDialog>
 #include <QProcess>
 #include <QBuffer>
-#include <QRegularExpression>
 #include <QPainter>
+#include <QThread>
 #ifdef Q_OS_WIN
 #include <windows.h>
 #include <shellapi.h>
@@ -22,16 +24,35 @@ VideoCompressor::VideoCompressor(QObject *parent)
     , m_targetSizeMB(10)
     , m_isCompressing(false)
     , m_ffmpegAvailable(false)
-    , m_currentVideoIndex(-1)
     , m_completedCount(0)
-    , m_ffmpegProcess(nullptr)
-    , m_progressTimer(new QTimer(this))
+    , m_maxConcurrentJobs(0)
+    , m_encodingMode(EncodingMode::TwoPass)
+    , m_sizeConvergenceEnabled(true)
+    , m_encoderBackend(EncoderBackendKind::Process)
     , m_hardwareAccelerationEnabled(false)
     , m_hardwareAccelerationAvailable(false)
     , m_hardwareAccelerationType("None")
+    , m_capabilityDetector(nullptr)
+    , m_encoderPreference("libx264") // H.264 in MP4 unless "auto" is asked for
+    , m_encodeTimeBudget(1.0)
+    , m_encodeDeadlineSeconds(0)
+    , m_deadlinePerBatch(false)
     , m_installProcess(nullptr) // Initialize install process
+    , m_mediaProber(nullptr)
+    , m_thumbnailCache(new ThumbnailCache)
+    , m_nextVideoId(1)
 {
     m_tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/VideoCompressor";
+    if (!hasGui()) {
+        // Headless runs must not clean up the temp files of a running GUI instance
+        m_tempDir += "-headless-" + QString::number(QCoreApplication::applicationPid());
+    }
+    
+    // Loaded before the cleanup below so finished outputs and pass 1 stats of
+    // interrupted jobs survive it; headless runs use a throwaway temp dir
+    if (hasGui()) {
+        m_journal.reset(new JobJournal(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/jobs.journal"));
+    }
     
     // Smart cleanup on startup: preserve files that are currently in clipboard
     smartCleanupTempFiles();
@@ -39,15 +60,42 @@ VideoCompressor::VideoCompressor(QObject *parent)
     // Create fresh temp directory if it doesn't exist
     QDir().mkpath(m_tempDir);
     
-    connect(m_progressTimer, &QTimer::timeout, this, &VideoCompressor::onFFmpegProgress);
-    
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/media-cache";
+    m_mediaCache.reset(new MediaCache(cacheDir));
+    emit debugMessage("Media cache: " + cacheDir + " (" + formatFileSize(m_mediaCache->sizeBytes()) + ")", "info");
+    
+    // Thumbnails are extracted outside m_tempDir, which startCompression()
+    // cleans while probes of newly dropped files may still be writing
+    m_mediaProber = new MediaProber(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails",
+                                    m_mediaCache, this);
+    m_mediaProber->setThumbnailsEnabled(hasGui());
+    connect(m_mediaProber, &MediaProber::probeFinished, this, &VideoCompressor::onProbeFinished);
+    connect(m_mediaProber, &MediaProber::debugMessage, this, &VideoCompressor::debugMessage);
+    
+    // The automatic job count depends on whether a hardware encoder is used
+    connect(this, &VideoCompressor::hardwareAccelerationEnabledChanged,
+            this, &VideoCompressor::maxConcurrentJobsChanged);
+    
+    m_capabilityDetector = new FFmpegCapabilityDetector(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/ffmpeg-capabilities.json", this);
+    connect(m_capabilityDetector, &FFmpegCapabilityDetector::detected, this, &VideoCompressor::applyCapabilities);
+    connect(m_capabilityDetector, &FFmpegCapabilityDetector::debugMessage, this, &VideoCompressor::debugMessage);
     checkFFmpeg();
+    
+    // Restore once the event loop runs, after the QML side is connected
+    QTimer::singleShot(0, this, &VideoCompressor::restoreJournal);
 }
 
 VideoCompressor::~VideoCompressor()
 {
-    // Smart cleanup: remove temp files but preserve those in clipboard
+    // Wait for a background detection before members it reports into go away
+    delete m_capabilityDetector;
+    
+    // Smart cleanup: remove temp files but preserve those in clipboard and
+    // those the journal still needs (finished outputs, kept pass 1 stats)
     smartCleanupTempFiles();
+    if (!hasGui()) {
+        QDir(m_tempDir).removeRecursively();
+    }
 }
 
 int VideoCompressor::rowCount(const QModelIndex &parent) const
@@ -77,21 +125,37 @@ QVariant VideoCompressor::data(const QModelIndex &index, int role) const
     case ProgressRole:
         return item.progress;
     case ThumbnailRole:
-        // Convert QPixmap to base64 data URL for QML Image component
-        if (!item.thumbnail.isNull()) {
-            QByteArray byteArray;
-            QBuffer buffer(&byteArray);
-            buffer.open(QIODevice::WriteOnly);
-            item.thumbnail.save(&buffer, "PNG");
-            QString base64 = QString("data:image/png;base64,%1").arg(QString(byteArray.toBase64()));
-            return base64;
+        // Decoded images are served and cached by ThumbnailProvider
+        if (item.thumbnailRevision > 0) {
+            return QString("image://thumbs/%1/%2").arg(item.id).arg(item.thumbnailRevision);
         }
         return QString();
+    case EncodeModeRole:
+        return item.encodeMode;
+    case EncodeFpsRole:
+        return item.encodeFps;
+    case EncodeSpeedRole:
+        return item.encodeSpeed;
+    case EncodeBitrateRole:
+        return item.encodeBitrateKbps;
+    case OutputBytesRole:
+        return item.outputBytes;
+    case EtaRole:
+        return item.etaSeconds;
+    case OutputPathRole:
+        return item.outputPath;
+    case VideoIdRole:
+        return item.id;
     default:
         return QVariant();
     }
 }
 
+QQuickImageProvider *VideoCompressor::createThumbnailProvider() const
+{
+    return new ThumbnailProvider(m_thumbnailCache);
+}
+
 QHash<int, QByteArray> VideoCompressor::roleNames() const
 {
     QHash<int, QByteArray> roles;
@@ -102,6 +166,14 @@ QHash<int, QByteArray> VideoCompressor::roleNames() const
     roles[StatusTextRole] = "statusText";
     roles[ProgressRole] = "progress";
     roles[ThumbnailRole] = "thumbnail";
+    roles[EncodeModeRole] = "encodeMode";
+    roles[EncodeFpsRole] = "encodeFps";
+    roles[EncodeSpeedRole] = "encodeSpeed";
+    roles[EncodeBitrateRole] = "encodeBitrate";
+    roles[OutputBytesRole] = "outputBytes";
+    roles[EtaRole] = "etaSeconds";
+    roles[OutputPathRole] = "outputPath";
+    roles[VideoIdRole] = "videoId";
     return roles;
 }
 
@@ -135,26 +207,169 @@ void VideoCompressor::addVideoFromPath(const QString &path)
     }
     
     VideoItem item;
+    item.id = m_nextVideoId++;
     item.path = path;
     item.fileName = QFileInfo(path).fileName();
     item.fileSizeBytes = QFileInfo(path).size();
     item.originalSize = formatFileSize(item.fileSizeBytes);
-    item.status = VideoStatus::Ready;
-    item.statusText = "Ready";
+    item.status = VideoStatus::Analyzing;
+    item.statusText = "Analyzing...";
     item.progress = 0;
-    item.durationSeconds = getVideoDuration(path); // Get actual duration
-    
-    generateThumbnail(item);
-    
+    item.durationSeconds = 0.0; // Filled in by the prober
+    item.thumbnailRevision = 0;
+    item.targetSizeMB = 0;
+    item.encodingMode = -1;
+    item.encodeFps = 0.0;
+    item.encodeSpeed = 0.0;
+    item.encodeBitrateKbps = 0;
+    item.outputBytes = 0;
+    item.etaSeconds = -1;
+    
+    // Show the row right away, duration and thumbnail arrive from the worker pool
     beginInsertRows(QModelIndex(), m_videos.size(), m_videos.size());
     m_videos.append(item);
     endInsertRows();
+    journalItem(m_videos.size() - 1);
     
     emit totalCountChanged();
     
+    // Seen this exact file before: no ffprobe/ffmpeg needed at all
+    MediaCacheEntry cached;
+    if (m_mediaCache->lookup(path, &cached)) {
+        emit debugMessage(QString("Media cache hit: %1 (hits: %2, misses: %3)")
+                         .arg(item.fileName)
+                         .arg(m_mediaCache->hits())
+                         .arg(m_mediaCache->misses()), "info");
+        MediaProbeResult result;
+        result.id = item.id;
+        result.path = path;
+        result.media = MediaInfo::fromJson(cached.streamInfo);
+        result.thumbnailData = cached.thumbnailData;
+        onProbeFinished(result);
+        return;
+    }
+    emit debugMessage(QString("Media cache miss: %1 (hits: %2, misses: %3)")
+                     .arg(item.fileName)
+                     .arg(m_mediaCache->hits())
+                     .arg(m_mediaCache->misses()), "info");
+    
+    if (!m_ffmpegAvailable) {
+        emit debugMessage("Cannot analyze video: FFmpeg/FFprobe not available", "warning");
+        MediaProbeResult result;
+        result.id = item.id;
+        result.path = path;
+        onProbeFinished(result);
+        return;
+    }
+    
+    m_mediaProber->probe(item.id, path);
+}
+
+void VideoCompressor::enqueueVideo(const QString &path)
+{
+    int previousCount = m_videos.size();
+    addVideoFromPath(path);
+    if (!m_isCompressing || m_videos.size() == previousCount) {
+        return;
+    }
+    
+    queueRow(m_videos.size() - 1);
+}
+
+quint64 VideoCompressor::submitJob(const QString &path, int targetSizeMB, int encodingMode)
+{
+    if (!m_ffmpegAvailable) {
+        emit debugMessage("Rejected job, FFmpeg/FFprobe not available: " + path, "error");
+        return 0;
+    }
+    
+    int previousCount = m_videos.size();
+    addVideoFromPath(path);
+    if (m_videos.size() == previousCount) {
+        return 0;
+    }
+    
+    int index = m_videos.size() - 1;
+    quint64 id = m_videos[index].id;
+    m_videos[index].targetSizeMB = targetSizeMB;
+    m_videos[index].encodingMode = encodingMode;
+    
+    // Only this row runs; rows finished earlier keep their outputs
+    if (!m_isCompressing) {
+        QDir().mkpath(m_tempDir);
+        beginBatch();
+    }
+    queueRow(index);
+    return id;
+}
+
+void VideoCompressor::beginBatch()
+{
+    // Every way a batch starts goes through here, so per-batch deadlines
+    // always count from a valid clock
+    m_isCompressing = true;
+    m_batchClock.start();
+    emit isCompressingChanged();
+}
+
+void VideoCompressor::queueRow(int index)
+{
+    // Rows from a cache hit are Ready already, the rest start once probed
+    m_pendingIndices.append(index);
+    if (m_videos[index].status == VideoStatus::Ready) {
+        updateVideoStatus(index, VideoStatus::Ready, "Queued", 0);
+    }
+    journalItem(index);
+    processNextVideo();
+}
+
+void VideoCompressor::onProbeFinished(const MediaProbeResult &result)
+{
+    int index = indexOfVideo(result.id);
+    if (index < 0) {
+        return; // Removed while it was being analyzed
+    }
+    
+    VideoItem &item = m_videos[index];
+    item.media = result.media;
+    item.durationSeconds = result.media.durationSeconds;
+    if (!result.thumbnailData.isEmpty()) {
+        setThumbnail(item, result.thumbnailData);
+    } else {
+        createPlaceholderThumbnail(item);
+    }
+    
+    // A running batch may already have this row queued; rows restored from
+    // the journal as finished keep their status
+    bool queued = m_isCompressing && m_pendingIndices.contains(index);
+    if (item.status == VideoStatus::Analyzing) {
+        updateVideoStatus(index, VideoStatus::Ready, queued ? "Queued" : "Ready", 0);
+    }
+    QModelIndex idx = this->index(index);
+    emit dataChanged(idx, idx, {ThumbnailRole});
+    
     QString durationText = item.durationSeconds > 0 ? 
         QString(" - %1 min").arg(QString::number(item.durationSeconds / 60.0, 'f', 1)) : "";
     emit debugMessage("Added video: " + item.fileName + " (" + item.originalSize + durationText + ")", "success");
+    
+    if (queued) {
+        processNextVideo();
+    }
+}
+
+bool VideoCompressor::hasGui()
+{
+    return qobject_cast<QGuiApplication *>(QCoreApplication::instance()) != nullptr;
+}
+
+int VideoCompressor::indexOfVideo(quint64 id) const
+{
+    for (int i = 0; i < m_videos.size(); ++i) {
+        if (m_videos[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
 }
 
 void VideoCompressor::clearVideos()
@@ -165,6 +380,11 @@ void VideoCompressor::clearVideos()
     
     beginResetModel();
     m_videos.clear();
+    m_thumbnailCache->clear();
+    m_resumeState.clear();
+    if (m_journal) {
+        m_journal->clear();
+    }
     m_completedCount = 0;
     endResetModel();
     
@@ -178,7 +398,18 @@ void VideoCompressor::removeVideo(int index)
         return;
     }
     
+    // A failed row may have failed on stale probe data; re-adding the file
+    // should probe it again instead of trusting the cached entry
+    if (m_videos[index].status == VideoStatus::Error) {
+        m_mediaCache->invalidate(m_videos[index].path);
+    }
+    
     beginRemoveRows(QModelIndex(), index, index);
+    m_thumbnailCache->remove(QString::number(m_videos[index].id));
+    m_resumeState.remove(m_videos[index].id);
+    if (m_journal) {
+        m_journal->remove(m_videos[index].path);
+    }
     m_videos.removeAt(index);
     endRemoveRows();
     
@@ -208,17 +439,9 @@ void VideoCompressor::startCompression()
     smartCleanupTempFiles();
     QDir().mkpath(m_tempDir); // Recreate temp directory
     
-    // Re-check FFmpeg availability before starting
-    emit debugMessage("Re-checking FFmpeg availability before compression...", "info");
-    
-    QProcess testProcess;
-    testProcess.start("ffmpeg", QStringList() << "-version");
-    bool canStart = testProcess.waitForStarted(3000);
-    if (canStart) {
-        testProcess.waitForFinished(3000);
-    }
-    
-    if (!canStart || testProcess.exitCode() != 0) {
+    // Capabilities come from the startup check; a PATH lookup is enough to
+    // notice ffmpeg being uninstalled since then
+    if (FFmpegCapabilityDetector::locate().ffmpegPath.isEmpty()) {
         emit debugMessage("FFmpeg check failed before compression", "error");
         emit debugMessage("FFmpeg may have been uninstalled or PATH changed", "error");
         m_ffmpegAvailable = false;
@@ -229,16 +452,37 @@ void VideoCompressor::startCompression()
     emit debugMessage("Starting compression batch with " + QString::number(m_videos.size()) + " videos", "info");
     emit debugMessage("Target size: " + QString::number(m_targetSizeMB) + " MB", "info");
     
-    m_isCompressing = true;
-    m_currentVideoIndex = -1;
     m_completedCount = 0;
+    m_pendingIndices.clear();
+    beginBatch();
+    
+    emit debugMessage(QString("Running up to %1 jobs per stage (pass 1, encode), %2 threads per job")
+                     .arg(effectiveConcurrentJobs())
+                     .arg(threadsPerJob()), "info");
+    
+    // Reset all videos to ready state and queue them; rows still being
+    // analyzed keep their state and start once their probe finishes. Rows
+    // finished earlier, e.g. restored from the journal, keep their output.
+    for (int i = 0; i < m_videos.size(); ++i) {
+        const VideoItem &item = m_videos[i];
+        bool finished = item.status == VideoStatus::Completed || item.status == VideoStatus::AlreadyOptimal;
+        if (finished && !item.outputPath.isEmpty() && QFileInfo::exists(item.outputPath)) {
+            m_completedCount++;
+            continue;
+        }
+        m_videos[i].outputPath.clear();
+        setEncodeMode(i, QString());
+        if (m_videos[i].status != VideoStatus::Analyzing) {
+            updateVideoStatus(i, VideoStatus::Ready, "Queued", 0);
+        }
+        m_pendingIndices.append(i);
+    }
     
-    emit isCompressingChanged();
     emit completedCountChanged();
     
-    // Reset all videos to ready state
+    // Each row's new state reaches the journal before any encode starts
     for (int i = 0; i < m_videos.size(); ++i) {
-        updateVideoStatus(i, VideoStatus::Ready, "Queued", 0);
+        journalItem(i);
     }
     
     processNextVideo();
@@ -246,53 +490,834 @@ void VideoCompressor::startCompression()
 
 void VideoCompressor::processNextVideo()
 {
-    m_currentVideoIndex++;
+    if (!m_isCompressing) {
+        return;
+    }
+    
+    // Parked jobs take freed slots first, in the order they were started
+    const QList<CompressionJob *> jobs = m_activeJobs;
+    for (CompressionJob *job : jobs) {
+        if (!job->waiting || runningJobs(job->stage) >= effectiveConcurrentJobs()) {
+            continue;
+        }
+        job->waiting = false;
+        if (job->firstPassDone) {
+            updateVideoStatus(job->index, VideoStatus::Compressing, "Starting pass 2/2...", 50);
+            startFFmpegProcess(job, false);
+        } else {
+            runJob(job);
+        }
+    }
+    
+    // Admit new rows while a stage has room, skipping rows still being analyzed
+    for (int i = 0; i < m_pendingIndices.size() && canAdmitJob(); ) {
+        int index = m_pendingIndices[i];
+        if (m_videos[index].status == VideoStatus::Analyzing) {
+            ++i;
+            continue;
+        }
+        m_pendingIndices.removeAt(i);
+        startJob(index);
+    }
     
-    if (m_currentVideoIndex >= m_videos.size()) {
+    if (m_activeJobs.isEmpty() && m_pendingIndices.isEmpty()) {
         // All videos processed
         m_isCompressing = false;
         emit isCompressingChanged();
         emit compressionFinished();
         emit debugMessage("All videos processed successfully", "success");
-        return;
     }
-    
-    VideoItem &item = m_videos[m_currentVideoIndex];
-    emit debugMessage("Processing video " + QString::number(m_currentVideoIndex + 1) + "/" + 
+}
+
+void VideoCompressor::startJob(int index)
+{
+    VideoItem &item = m_videos[index];
+    emit debugMessage("Processing video " + QString::number(index + 1) + "/" + 
                      QString::number(m_videos.size()) + ": " + item.fileName, "info");
     
-    // Check if video is already small enough
-    qint64 targetBytes = m_targetSizeMB * 1024 * 1024;
-    if (item.fileSizeBytes <= targetBytes) {
-        updateVideoStatus(m_currentVideoIndex, VideoStatus::AlreadyOptimal, "Already optimal size", 100);
+    // Check if video is already small enough and plays in Discord as-is
+    if (isAlreadyOptimal(item)) {
+        updateVideoStatus(index, VideoStatus::AlreadyOptimal, "Already optimal size", 100);
+        setEncodeMode(index, "Original");
         item.outputPath = item.path; // Use original file
         m_completedCount++;
         emit completedCountChanged();
         emit debugMessage("Video already optimal: " + item.fileName, "success");
-        
-        QTimer::singleShot(100, this, &VideoCompressor::processNextVideo);
         return;
     }
     
     // Check if we have valid duration
     if (item.durationSeconds <= 0) {
-        updateVideoStatus(m_currentVideoIndex, VideoStatus::Error, "Invalid video duration", 0);
+        updateVideoStatus(index, VideoStatus::Error, "Invalid video duration", 0);
         emit debugMessage("ERROR: Could not determine duration for " + item.fileName, "error");
-        QTimer::singleShot(100, this, &VideoCompressor::processNextVideo);
         return;
     }
     
-    updateVideoStatus(m_currentVideoIndex, VideoStatus::Compressing, "Starting compression (Pass 1/2)...", 0);
+    if (item.media.valid && !item.media.hasVideo) {
+        updateVideoStatus(index, VideoStatus::Error, "No video stream", 0);
+        emit debugMessage("ERROR: No video stream found in " + item.fileName, "error");
+        return;
+    }
+    
+    // Pass 1 of this row finished in a previous session and its stats were
+    // kept; they are only usable with the same encoder in this ffmpeg build
+    JournalEntry resume = m_resumeState.take(item.id);
+    const EncoderStrategy *resumeEncoder = resume.firstPassDone() ? m_encoderRegistry.find(resume.encoderName) : nullptr;
+    if (resumeEncoder && resumeEncoder->isHardware() && !m_hardwareAccelerationAvailable) {
+        resumeEncoder = nullptr;
+    }
+    bool resumePass2 = resumeEncoder && QFileInfo::exists(resume.passLogPrefix + "-0.log");
+    if (resume.firstPassDone() && !resumePass2) {
+        emit debugMessage("Pass 1 stats of " + item.fileName + " can't be resumed (" + resume.encoderName +
+                         " unavailable or stats missing), starting over", "warning");
+        cleanupPassFiles(resume.passLogPrefix);
+        if (!resume.audioPath.isEmpty()) {
+            QFile::remove(resume.audioPath);
+        }
+    }
+    
+    // Generate output paths with temp prefix; each job gets its own pass log
+    // and audio file named after its output, which is unique across rows
+    CompressionJob *job = new CompressionJob;
+    job->index = index;
+    job->encoder = nullptr;
+    job->plan = planFor(item, !resumePass2);
+    job->mode = item.encodingMode >= 0 ? static_cast<EncodingMode>(item.encodingMode) : m_encodingMode;
+    job->isFirstPass = false;
+    job->audioProcess = nullptr;
+    job->audioRunning = false;
+    job->firstPassDone = false;
+    job->sizeCorrections = 0;
+    job->segmentEncoder = nullptr;
+    job->backend = m_encoderBackend;
+    job->stage = JobStage::Analysis;
+    job->waiting = false;
+    job->clock.start();
+    job->budgetSeconds = 0.0;
+    
+    // Pass 1 stats only fit the encoder and preset that wrote them
+    if (resumePass2) {
+        job->encoderChoice.encoder = resumeEncoder;
+        job->encoderChoice.preset = resume.encoderPreset;
+        job->outputPath = item.outputPath;
+        job->passLogPrefix = resume.passLogPrefix;
+    } else if (job->plan.strategy == EncodeStrategy::Transcode) {
+        prepareTranscode(job);
+    } else {
+        job->outputPath = uniqueOutputPath(index, "mp4");
+        job->passLogPrefix = workPathFor(job->outputPath) + "_2pass";
+    }
+    item.outputPath = job->outputPath;
+    
+    m_activeJobs.append(job);
+    emit activeJobCountChanged();
+    
+    if (resumePass2) {
+        job->mode = EncodingMode::TwoPass;
+        job->plan.videoBitrateKbps = resume.videoBitrateKbps;
+        job->audioPath = QFileInfo::exists(resume.audioPath) ? resume.audioPath : QString();
+        job->firstPassDone = true;
+        setEncodeMode(index, encodeModeName(job) + ", resumed");
+        emit debugMessage("Resuming " + item.fileName + " at pass 2 with the pass 1 stats of the last session", "info");
+        startSecondPass(job);
+        return;
+    }
+    
+    // Wait without holding any process if the first stage is full
+    job->stage = firstStageFor(job);
+    job->waiting = true;
+    if (runningJobs(job->stage) < effectiveConcurrentJobs()) {
+        job->waiting = false;
+        runJob(job);
+    }
+}
+
+void VideoCompressor::prepareTranscode(CompressionJob *job)
+{
+    VideoItem &item = m_videos[job->index];
+    job->budgetSeconds = budgetFor(job);
+    job->encoderChoice = chooseEncoder(job);
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    
+    // Hardware encoders have no CRF, SVT-AV1 and x265 no two-pass through
+    // ffmpeg; both fall back to single-pass ABR
+    if ((job->mode == EncodingMode::CappedCrf && !encoder->supportsCrf()) ||
+        (job->mode == EncodingMode::TwoPass && !encoder->supportsTwoPass())) {
+        job->mode = EncodingMode::SinglePass;
+    }
+    QString estimate = job->encoderChoice.estimatedSeconds > 0
+        ? QString(", about %1 s").arg(qRound(job->encoderChoice.estimatedSeconds)) : QString();
+    emit debugMessage("Encoder for " + item.fileName + ": " + job->encoderChoice.description() + estimate, "info");
+    
+    // The container follows the encoder, e.g. WebM for VP9 and AV1
+    job->outputPath = uniqueOutputPath(job->index, encoder->container());
+    job->passLogPrefix = workPathFor(job->outputPath) + "_2pass";
+    item.outputPath = job->outputPath;
+}
+
+void VideoCompressor::runJob(CompressionJob *job)
+{
+    if (job->plan.strategy == EncodeStrategy::Transcode) {
+        startTranscode(job);
+    } else {
+        // Stream copy, a single fast FFmpeg run
+        setEncodeMode(job->index, encodeModeName(job));
+        updateVideoStatus(job->index, VideoStatus::Compressing, "Starting " + EncodePlanner::strategyName(job->plan.strategy).toLower() + "...", 0);
+        startFFmpegProcess(job, false);
+    }
+}
+
+JobStage VideoCompressor::firstStageFor(const CompressionJob *job) const
+{
+    // Chunked encodes run their own passes and stay in the encode stage
+    const VideoItem &item = m_videos[job->index];
+    bool chunkable = item.durationSeconds >= 600.0 && job->mode != EncodingMode::CappedCrf &&
+                     job->encoderChoice.encoder && job->encoderChoice.encoder->supportsChunking();
+    bool twoPass = job->plan.strategy == EncodeStrategy::Transcode && job->mode == EncodingMode::TwoPass;
+    return twoPass && !chunkable ? JobStage::Analysis : JobStage::Encode;
+}
+
+int VideoCompressor::runningJobs(JobStage stage) const
+{
+    int count = 0;
+    for (const CompressionJob *job : m_activeJobs) {
+        if (job->stage == stage && !job->waiting) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool VideoCompressor::canAdmitJob() const
+{
+    // A parked job already waits for the next free slot; admitting more
+    // would only pile up pass 1 stats waiting for pass 2
+    for (const CompressionJob *job : m_activeJobs) {
+        if (job->waiting) {
+            return false;
+        }
+    }
+    return runningJobs(JobStage::Analysis) < effectiveConcurrentJobs() ||
+           runningJobs(JobStage::Encode) < effectiveConcurrentJobs();
+}
+
+void VideoCompressor::startTranscode(CompressionJob *job)
+{
+    // Show the scaled output format next to the mode, e.g. "Two-pass, 720p30",
+    // and the codec when it isn't H.264
+    const VideoItem &item = m_videos[job->index];
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    bool scaled = job->plan.shortSide > 0 || job->plan.frameRate > 0;
+    QString modeText = encodeModeName(job);
+    if (encoder->codec() != "h264") {
+        modeText += ", " + encoder->displayName();
+    }
+    setEncodeMode(job->index, modeText + (scaled ? ", " + EncodePlanner::outputFormatName(item.media, job->plan) : QString()));
+    
+    int chunkCount = segmentCountFor(job);
+    if (chunkCount > 1) {
+        startSegmentedEncode(job, chunkCount);
+        return;
+    }
+    
+    if (job->mode == EncodingMode::TwoPass) {
+        // Start with first pass; the audio track is encoded alongside it
+        updateVideoStatus(job->index, VideoStatus::Compressing, "Starting compression (Pass 1/2)...", 0);
+        job->firstPassDone = false;
+        if (job->plan.audioBitrateKbps > 0) {
+            startAudioProcess(job);
+        }
+        startFFmpegProcess(job, true);
+    } else {
+        updateVideoStatus(job->index, VideoStatus::Compressing, "Starting " + encodeModeName(job).toLower() + " encode...", 0);
+        startFFmpegProcess(job, false);
+    }
+}
+
+int VideoCompressor::segmentCountFor(const CompressionJob *job) const
+{
+    // Shorter videos don't amortize the keyframe lookup and concat step
+    const double minimumDuration = 600.0;
+    const double minimumChunkDuration = 120.0;
+    const int threadsPerChunk = 4;
+    
+    const VideoItem &item = m_videos[job->index];
+    if (job->mode == EncodingMode::CappedCrf || !job->encoderChoice.encoder->supportsChunking() ||
+        item.durationSeconds < minimumDuration) {
+        return 1;
+    }
+    
+    // Only borrow slots no other queued video is going to use
+    int runnablePending = 0;
+    for (int index : std::as_const(m_pendingIndices)) {
+        if (m_videos[index].status != VideoStatus::Analyzing) {
+            runnablePending++;
+        }
+    }
+    int freeSlots = qMax(0, effectiveConcurrentJobs() - runningJobs(JobStage::Encode) - runnablePending);
+    int threadBudget = threadsPerJob() * (1 + freeSlots);
+    
+    int chunkCount = qMin(threadBudget / threadsPerChunk, int(item.durationSeconds / minimumChunkDuration));
+    return qMax(1, chunkCount);
+}
+
+void VideoCompressor::startSegmentedEncode(CompressionJob *job, int chunkCount)
+{
+    const VideoItem &item = m_videos[job->index];
+    
+    SegmentEncoder::Settings settings;
+    settings.sourcePath = item.path;
+    settings.workPrefix = job->passLogPrefix;
+    settings.outputPath = job->outputPath;
+    settings.durationSeconds = item.durationSeconds;
+    settings.chunkCount = chunkCount;
+    settings.threadsPerChunk = qMax(1, QThread::idealThreadCount() / qMax(chunkCount, effectiveConcurrentJobs()));
+    settings.videoBitrateKbps = job->plan.videoBitrateKbps;
+    settings.audioBitrateKbps = job->plan.audioBitrateKbps;
+    settings.twoPass = job->mode == EncodingMode::TwoPass;
+    settings.encoderName = job->encoderChoice.encoder->name();
+    settings.extraVideoArgs = job->encoderChoice.encoder->optionArgs(job->encoderChoice.preset)
+                              + EncodePlanner::videoFilterArgs(job->plan);
+    if (!item.media.pixelFormat.isEmpty() && item.media.pixelFormat != "yuv420p") {
+        settings.extraVideoArgs << "-pix_fmt" << "yuv420p";
+    }
+    
+    job->segmentEncoder = new SegmentEncoder(settings, this);
+    connect(job->segmentEncoder, &SegmentEncoder::debugMessage, this, &VideoCompressor::debugMessage);
+    connect(job->segmentEncoder, &SegmentEncoder::progressChanged, this, [this, job](int progress, const QString &statusText) {
+        updateVideoStatus(job->index, VideoStatus::Compressing, statusText, progress);
+    });
+    connect(job->segmentEncoder, &SegmentEncoder::throughputChanged, this, [this, job](const FFmpegProgress &progress, int etaSeconds) {
+        updateThroughput(job->index, progress, etaSeconds);
+    });
+    connect(job->segmentEncoder, &SegmentEncoder::finished, this, [this, job](bool success, const QString &message) {
+        onSegmentedEncodeFinished(job, success, message);
+    });
+    
+    setEncodeMode(job->index, QString("Chunked ×%1 (%2)").arg(chunkCount).arg(encodeModeName(job)));
+    updateVideoStatus(job->index, VideoStatus::Compressing, "Finding chunk boundaries...", 0);
+    job->runClock.start();
+    job->segmentEncoder->start();
+}
+
+void VideoCompressor::onSegmentedEncodeFinished(CompressionJob *job, bool success, const QString &message)
+{
+    const VideoItem &item = m_videos[job->index];
+    
+    if (success) {
+        recordEncodeSpeed(job, job->encoderChoice.preset);
+        QFileInfo outputInfo(job->outputPath);
+        if (job->mode == EncodingMode::TwoPass && outputInfo.exists() && retrySecondPassForSize(job, outputInfo.size())) {
+            return;
+        }
+        reportOutput(job, message);
+    } else {
+        updateVideoStatus(job->index, VideoStatus::Error, "Chunked encode failed", 0);
+        emit debugMessage("Chunked encode failed for " + item.fileName + ": " + message, "error");
+    }
+    
+    finishJob(job);
+}
+
+void VideoCompressor::reportOutput(CompressionJob *job, const QString &note)
+{
+    const VideoItem &item = m_videos[job->index];
+    qint64 targetBytes = qint64(targetSizeMBFor(item)) * 1024 * 1024;
+    QFileInfo outputInfo(job->outputPath);
+    
+    if (!outputInfo.exists()) {
+        updateVideoStatus(job->index, VideoStatus::Error, "Output file not created", 0);
+        emit debugMessage("Compression failed: Output file not created for " + item.fileName, "error");
+        return;
+    }
+    
+    double targetError = (double(outputInfo.size()) / targetBytes - 1.0) * 100;
+    QString errorText = QString("%1%2% vs target").arg(targetError > 0 ? "+" : "").arg(QString::number(targetError, 'f', 1));
+    QString corrections = job->sizeCorrections > 0 ? QString(" after %1 size corrections").arg(job->sizeCorrections) : QString();
+    QString details = errorText + corrections + (note.isEmpty() ? QString() : ", " + note);
+    
+    // Only the closed loop can tell the target is out of reach; any other
+    // overshoot is still the best this run produced
+    bool correctionsExhausted = job->plan.strategy == EncodeStrategy::Transcode && job->mode == EncodingMode::TwoPass &&
+                                m_sizeConvergenceEnabled && job->sizeCorrections >= MaxSizeCorrections;
     
-    // Generate output path with temp prefix
-    QString baseName = QFileInfo(item.path).baseName();
-    QString tempPath = m_tempDir + "/" + baseName + "_temp.mp4";
-    QString outputPath = m_tempDir + "/" + baseName + "_compressed.mp4";
-    item.outputPath = outputPath;
+    if (outputInfo.size() > targetBytes && correctionsExhausted) {
+        // An oversized file is useless for the upload limit
+        updateVideoStatus(job->index, VideoStatus::Error, 
+                        QString("Over target: %1 (%2)").arg(formatFileSize(outputInfo.size())).arg(errorText), 0);
+        emit debugMessage("Output of " + item.fileName + " is still over the target after " + 
+                        QString::number(job->sizeCorrections) + " size corrections (" + 
+                        formatFileSize(outputInfo.size()) + ", " + errorText + ")", "error");
+        return;
+    }
+    
+    double sizeReduction = (1.0 - (double)outputInfo.size() / item.fileSizeBytes) * 100;
+    QString verb = job->plan.strategy == EncodeStrategy::Remux ? "Remuxed" :
+                   job->plan.strategy == EncodeStrategy::AudioReencode ? "Audio re-encoded" : "Compressed";
+    bool overTarget = outputInfo.size() > targetBytes;
+    updateVideoStatus(job->index, VideoStatus::Completed, 
+                    QString("%1 to %2 (%3)").arg(overTarget ? "Over target" : verb).arg(formatFileSize(outputInfo.size())).arg(errorText), 100);
+    m_completedCount++;
+    emit completedCountChanged();
+    
+    emit debugMessage(QString(overTarget ? "Compression finished over the target" : "Compression completed") + 
+                    " (" + item.encodeMode + "): " + item.fileName + 
+                    " (" + formatFileSize(item.fileSizeBytes) + " → " + 
+                    formatFileSize(outputInfo.size()) + ", " + 
+                    QString::number(sizeReduction, 'f', 1) + "% reduction, predicted " +
+                    formatFileSize(job->plan.predictedBytes) + ", " + details + ")", overTarget ? "warning" : "success");
+}
+
+bool VideoCompressor::isSingleRun(const CompressionJob *job) const
+{
+    return job->plan.strategy != EncodeStrategy::Transcode || job->mode != EncodingMode::TwoPass;
+}
+
+QString VideoCompressor::encodeModeName(const CompressionJob *job) const
+{
+    if (job->plan.strategy != EncodeStrategy::Transcode) {
+        return EncodePlanner::strategyName(job->plan.strategy);
+    }
     
-    // Start with first pass
-    m_isFirstPass = true;
-    startFFmpegProcess(item, tempPath, true);
+    switch (job->mode) {
+    case EncodingMode::TwoPass:
+        return "Two-pass";
+    case EncodingMode::SinglePass:
+        return "Single-pass";
+    case EncodingMode::CappedCrf:
+        return "Capped CRF";
+    }
+    return QString();
+}
+
+void VideoCompressor::setEncodeMode(int index, const QString &mode)
+{
+    if (m_videos[index].encodeMode != mode) {
+        m_videos[index].encodeMode = mode;
+        QModelIndex idx = this->index(index);
+        emit dataChanged(idx, idx, {EncodeModeRole});
+    }
+}
+
+void VideoCompressor::setEncodingMode(int mode)
+{
+    EncodingMode newMode = static_cast<EncodingMode>(qBound(0, mode, 2));
+    if (m_encodingMode != newMode) {
+        m_encodingMode = newMode;
+        emit encodingModeChanged();
+        
+        static const char *descriptions[] = {
+            "Two-pass: most accurate size, about twice the encode time",
+            "Single-pass: one encode with VBV rate control, faster but less exact size",
+            "Capped CRF: one quality-targeted encode capped at the size budget, retried as single-pass if it overshoots"
+        };
+        emit debugMessage(QString("Encoding mode set to %1").arg(descriptions[static_cast<int>(newMode)]), "info");
+    }
+}
+
+EncodePlan VideoCompressor::planFor(const VideoItem &item, bool allowStreamCopy)
+{
+    int audioBitrate = audioBitrateFor(item);
+    int videoBitrate = calculateOptimalBitrate(item.durationSeconds, targetSizeMBFor(item), audioBitrate);
+    qint64 targetBytes = qint64(targetSizeMBFor(item)) * 1024 * 1024;
+    
+    EncodePlan plan;
+    if (allowStreamCopy) {
+        plan = EncodePlanner::plan(item.media, item.fileSizeBytes, targetBytes, videoBitrate, audioBitrate);
+    } else {
+        plan.strategy = EncodeStrategy::Transcode;
+        plan.videoBitrateKbps = videoBitrate;
+        plan.audioBitrateKbps = audioBitrate;
+        plan.predictedBytes = qint64((videoBitrate + audioBitrate) * 125.0 * item.durationSeconds);
+        plan.reason = "stream copy did not fit";
+        EncodePlanner::chooseOutputFormat(item.media, plan);
+    }
+    
+    emit debugMessage(QString("Plan for %1: %2 (%3, predicted %4)")
+                     .arg(item.fileName)
+                     .arg(EncodePlanner::strategyName(plan.strategy))
+                     .arg(plan.reason)
+                     .arg(formatFileSize(plan.predictedBytes)), "info");
+    if (plan.shortSide > 0 || plan.frameRate > 0) {
+        emit debugMessage(QString("Scaling %1 to %2 so %3 kbps keeps at least 0.05 bits per pixel")
+                         .arg(item.fileName)
+                         .arg(EncodePlanner::outputFormatName(item.media, plan))
+                         .arg(plan.videoBitrateKbps), "info");
+    }
+    return plan;
+}
+
+CompressionJob *VideoCompressor::jobForEncoder(const EncoderBackend *encoder) const
+{
+    for (CompressionJob *job : m_activeJobs) {
+        if (job->encoder == encoder) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void VideoCompressor::finishJob(CompressionJob *job)
+{
+    // Clean up this job's pass files only, other jobs may still be using theirs
+    cleanupPassFiles(job->passLogPrefix);
+    
+    m_activeJobs.removeOne(job);
+    updateThroughput(job->index, FFmpegProgress(), -1);
+    if (job->encoder) {
+        job->encoder->disconnect(this);
+        job->encoder->cancel();
+        job->encoder->deleteLater();
+    }
+    if (job->audioProcess) {
+        // Still running if pass 1 failed
+        job->audioProcess->disconnect(this);
+        job->audioProcess->kill();
+        job->audioProcess->deleteLater();
+    }
+    if (!job->audioPath.isEmpty()) {
+        QFile::remove(job->audioPath);
+    }
+    if (m_videos[job->index].status == VideoStatus::Error && !isTempPath(job->outputPath)) {
+        // A failed encode, or one the size corrections couldn't bring under
+        // the target, must not be left in the user's folder
+        QFile::remove(job->outputPath);
+    }
+    if (job->segmentEncoder) {
+        // Its destructor stops the chunk processes and removes the chunk files
+        job->segmentEncoder->disconnect(this);
+        job->segmentEncoder->deleteLater();
+    }
+    delete job;
+    emit activeJobCountChanged();
+    
+    // Queued rather than direct: finishJob() runs inside the job's signal handlers
+    QMetaObject::invokeMethod(this, &VideoCompressor::processNextVideo, Qt::QueuedConnection);
+}
+
+QString VideoCompressor::outputFileName(const QString &inputPath, const QString &container, int copy)
+{
+    QString baseName = QFileInfo(inputPath).baseName();
+    if (copy > 1) {
+        baseName += "_" + QString::number(copy);
+    }
+    return baseName + "_compressed." + container;
+}
+
+QStringList VideoCompressor::outputFileNames(const QString &inputPath) const
+{
+    QStringList names;
+    const QStringList containers = m_encoderRegistry.containers();
+    for (const QString &container : containers) {
+        names.append(outputFileName(inputPath, container));
+    }
+    return names;
+}
+
+QString VideoCompressor::uniqueOutputPath(int index, const QString &container) const
+{
+    // Two inputs with the same base name must not write the same temp file,
+    // and a direct output never replaces a file already in the user's folder
+    QString dir = m_outputFolder.isEmpty() ? m_tempDir : m_outputFolder;
+    QString candidate = dir + "/" + outputFileName(m_videos[index].path, container);
+    int counter = 2;
+    bool taken = true;
+    while (taken) {
+        taken = !m_outputFolder.isEmpty() && QFileInfo::exists(candidate);
+        for (int i = 0; i < m_videos.size() && !taken; ++i) {
+            taken = i != index && m_videos[i].outputPath == candidate;
+        }
+        if (taken) {
+            candidate = dir + "/" + outputFileName(m_videos[index].path, container, counter++);
+        }
+    }
+    return candidate;
+}
+
+QString VideoCompressor::workPathFor(const QString &outputPath) const
+{
+    return m_tempDir + "/" + QFileInfo(outputPath).completeBaseName();
+}
+
+bool VideoCompressor::isTempPath(const QString &path) const
+{
+    return QFileInfo(path).absolutePath() == QFileInfo(m_tempDir).absoluteFilePath();
+}
+
+void VideoCompressor::setMaxConcurrentJobs(int jobs)
+{
+    jobs = qMax(0, jobs);
+    if (m_maxConcurrentJobs != jobs) {
+        m_maxConcurrentJobs = jobs;
+        emit maxConcurrentJobsChanged();
+        emit debugMessage(QString("Parallel jobs set to %1 (%2 threads per job)")
+                         .arg(jobs == 0 ? QString("Auto (%1)").arg(effectiveConcurrentJobs()) : QString::number(jobs))
+                         .arg(threadsPerJob()), "info");
+        
+        // Use any newly freed slots right away
+        processNextVideo();
+    }
+}
+
+void VideoCompressor::setSizeConvergenceEnabled(bool enabled)
+{
+    if (m_sizeConvergenceEnabled != enabled) {
+        m_sizeConvergenceEnabled = enabled;
+        emit sizeConvergenceEnabledChanged();
+        emit debugMessage(enabled ? "Size convergence enabled: two-pass outputs off target re-run pass 2 with a corrected bitrate"
+                                  : "Size convergence disabled", "info");
+    }
+}
+
+void VideoCompressor::setOutputFolder(const QString &folder)
+{
+    // QML hands over the folder dialog's file:// URL
+    QUrl url(folder);
+    QString path = url.isLocalFile() ? url.toLocalFile() : folder;
+    path = path.isEmpty() ? QString() : QDir(path).absolutePath();
+    if (m_outputFolder == path) {
+        return;
+    }
+    if (!path.isEmpty() && !QDir().mkpath(path)) {
+        emit debugMessage("Cannot create output folder " + path + ", keeping outputs in the temp folder", "error");
+        return;
+    }
+    m_outputFolder = path;
+    emit outputFolderChanged();
+    emit debugMessage(path.isEmpty() ? "Outputs are written to the temp folder"
+                                     : "Outputs are written directly to " + path, "info");
+}
+
+void VideoCompressor::setEncoderBackend(EncoderBackendKind backend)
+{
+    if (backend == EncoderBackendKind::Libav && !libavBackendAvailable()) {
+        emit debugMessage("In-process encoding is not built in, FFmpeg processes are used", "warning");
+        backend = EncoderBackendKind::Process;
+    }
+    m_encoderBackend = backend;
+}
+
+int VideoCompressor::effectiveConcurrentJobs() const
+{
+    if (m_maxConcurrentJobs > 0) {
+        return m_maxConcurrentJobs;
+    }
+    
+    // Hardware encoders have a small session limit and share one engine
+    if (m_hardwareAccelerationEnabled && m_hardwareAccelerationAvailable) {
+        return 2;
+    }
+    
+    // libx264 frame threading scales well up to roughly 4-8 threads per
+    // encode, so split the machine into 4-thread jobs
+    return qMax(1, QThread::idealThreadCount() / 4);
+}
+
+int VideoCompressor::threadsPerJob() const
+{
+    return qMax(1, QThread::idealThreadCount() / effectiveConcurrentJobs());
+}
+
+void VideoCompressor::setEncoderPreference(const QString &encoder)
+{
+    if (m_encoderPreference == encoder) {
+        return;
+    }
+    m_encoderPreference = encoder;
+    emit encoderPreferenceChanged();
+    
+    const EncoderStrategy *strategy = m_encoderRegistry.find(encoder);
+    if (encoder == "auto") {
+        emit debugMessage("Encoder: best quality within the time budget", "info");
+    } else if (!strategy) {
+        emit debugMessage("Encoder " + encoder + " is not in this FFmpeg build, choosing automatically", "warning");
+    } else if (!strategy->playsInDiscord()) {
+        emit debugMessage(strategy->displayName() + " outputs don't play in Discord embeds, they are posted as downloads", "warning");
+    } else {
+        emit debugMessage("Encoder: " + strategy->displayName(), "info");
+    }
+}
+
+void VideoCompressor::setEncodeTimeBudget(double secondsPerSecond)
+{
+    secondsPerSecond = qMax(0.05, secondsPerSecond);
+    if (!qFuzzyCompare(m_encodeTimeBudget, secondsPerSecond)) {
+        m_encodeTimeBudget = secondsPerSecond;
+        emit encodeTimeBudgetChanged();
+    }
+}
+
+void VideoCompressor::setEncodeDeadlineSeconds(int seconds)
+{
+    seconds = qMax(0, seconds);
+    if (m_encodeDeadlineSeconds == seconds) {
+        return;
+    }
+    m_encodeDeadlineSeconds = seconds;
+    emit encodeDeadlineChanged();
+    
+    if (seconds > 0) {
+        emit debugMessage(QString("Deadline: %1 s %2, slowest preset that finishes in time")
+                          .arg(seconds).arg(m_deadlinePerBatch ? "for the batch" : "per video"), "info");
+    } else {
+        emit debugMessage("Deadline off", "info");
+    }
+}
+
+void VideoCompressor::setDeadlinePerBatch(bool perBatch)
+{
+    if (m_deadlinePerBatch != perBatch) {
+        m_deadlinePerBatch = perBatch;
+        emit encodeDeadlineChanged();
+    }
+}
+
+QStringList VideoCompressor::availableEncoders() const
+{
+    QStringList names;
+    const QList<const EncoderStrategy *> encoders = m_encoderRegistry.available();
+    for (const EncoderStrategy *encoder : encoders) {
+        if (!encoder->isHardware()) {
+            names.append(encoder->name());
+        }
+    }
+    return names;
+}
+
+EncoderChoice VideoCompressor::chooseEncoder(const CompressionJob *job) const
+{
+    EncoderChoice choice;
+    if (m_hardwareAccelerationEnabled && m_hardwareAccelerationAvailable) {
+        choice.encoder = m_encoderRegistry.find(m_hardwareAccelerationType.contains("NVENC") ? "h264_nvenc" : "h264_qsv");
+        if (choice.encoder) {
+            return choice;
+        }
+    }
+    
+    EncoderRegistry::Workload work = workloadFor(job);
+    double budget = job->budgetSeconds;
+    if (m_encoderPreference != "auto") {
+        choice.encoder = m_encoderRegistry.find(m_encoderPreference);
+        if (choice.encoder && m_encodeDeadlineSeconds > 0) {
+            // A fixed encoder still gets the slowest preset the deadline allows
+            return EncoderRegistry::choosePreset(choice.encoder, work, budget, m_speedHistory);
+        }
+        if (choice.encoder) {
+            return choice;
+        }
+    }
+    return m_encoderRegistry.choose(work, budget, m_speedHistory);
+}
+
+EncoderRegistry::Workload VideoCompressor::workloadFor(const CompressionJob *job) const
+{
+    const VideoItem &item = m_videos[job->index];
+    QSize size = EncodePlanner::outputSize(item.media, job->plan);
+    double frameRate = job->plan.frameRate > 0 ? job->plan.frameRate : (item.media.frameRate > 0 ? item.media.frameRate : 30.0);
+    
+    EncoderRegistry::Workload work;
+    work.frameCount = item.durationSeconds * frameRate;
+    work.width = size.width();
+    work.height = size.height();
+    work.passCost = job->mode == EncodingMode::TwoPass ? 2.0 : 1.0; // Pass 1 runs about as fast as pass 2
+    work.threads = threadsPerJob();
+    return work;
+}
+
+double VideoCompressor::budgetFor(const CompressionJob *job) const
+{
+    const VideoItem &item = m_videos[job->index];
+    if (m_encodeDeadlineSeconds <= 0) {
+        return item.durationSeconds * m_encodeTimeBudget;
+    }
+    if (!m_deadlinePerBatch) {
+        return m_encodeDeadlineSeconds;
+    }
+    
+    // The time left is shared by this job and the ones still queued, in
+    // proportion to their pixels, over the parallel job slots
+    double remaining = qMax(0.0, m_encodeDeadlineSeconds - m_batchClock.elapsed() / 1000.0);
+    auto workOf = [](const VideoItem &video) {
+        double pixels = video.media.width > 0 ? double(video.media.width) * video.media.height : 1920.0 * 1080.0;
+        return qMax(0.0, video.durationSeconds) * pixels;
+    };
+    double ownWork = workOf(item);
+    double totalWork = ownWork;
+    for (int index : m_pendingIndices) {
+        totalWork += workOf(m_videos[index]);
+    }
+    if (totalWork <= 0) {
+        return remaining;
+    }
+    return qMin(remaining, remaining * effectiveConcurrentJobs() * ownWork / totalWork);
+}
+
+void VideoCompressor::recordEncodeSpeed(const CompressionJob *job, int preset)
+{
+    // Short runs are dominated by startup and say little about the encoder
+    double seconds = job->runClock.elapsed() / 1000.0;
+    double frames = job->lastProgress.frame;
+    int threads = threadsPerJob();
+    if (job->segmentEncoder) {
+        // Chunks run side by side over both passes (pass 2 only for a size
+        // correction), so rate the whole run on all of their threads
+        EncoderRegistry::Workload work = workloadFor(job);
+        frames = work.frameCount * (job->sizeCorrections > 0 ? 1.0 : work.passCost);
+        threads = job->segmentEncoder->threadCount();
+    }
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    if (!encoder || encoder->isHardware() || seconds < 2.0 || frames <= 0) {
+        return;
+    }
+    
+    const VideoItem &item = m_videos[job->index];
+    QSize size = EncodePlanner::outputSize(item.media, job->plan);
+    double fps = frames / seconds;
+    m_speedHistory.record(encoder->name(), encoder->presetSpeed(preset),
+                          size.width(), size.height(), threads, fps);
+}
+
+void VideoCompressor::reconsiderPreset(CompressionJob *job)
+{
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    double seconds = job->runClock.elapsed() / 1000.0;
+    if (m_encodeDeadlineSeconds <= 0 || job->budgetSeconds <= 0 || !encoder || encoder->presets().isEmpty() ||
+        seconds < 2.0 || job->lastProgress.frame <= 0) {
+        return;
+    }
+    
+    // How far pass 1 ran from the speed the preset was picked for
+    EncoderRegistry::Workload work = workloadFor(job);
+    int pass1Preset = job->encoderChoice.preset;
+    double expectedFps = m_speedHistory.estimateFps(encoder->name(), encoder->presetSpeed(pass1Preset),
+                                                    work.width, work.height, work.threads);
+    double drift = (job->lastProgress.frame / seconds) / expectedFps;
+    if (qAbs(drift - 1.0) < 0.15) {
+        return;
+    }
+    
+    // Pass 2 is one run; the slowest preset the pass 1 stats allow that
+    // finishes in what is left of the budget at the measured speed
+    double remaining = job->budgetSeconds - job->clock.elapsed() / 1000.0;
+    int best = -1;
+    for (int preset = 0; preset < encoder->presets().size(); ++preset) {
+        if (!encoder->canSwitchPreset(pass1Preset, preset)) {
+            continue;
+        }
+        double fps = drift * m_speedHistory.estimateFps(encoder->name(), encoder->presetSpeed(preset),
+                                                        work.width, work.height, work.threads);
+        if (best < 0 || work.frameCount / fps <= remaining) {
+            best = preset;
+        }
+    }
+    if (best < 0 || best == pass1Preset) {
+        return;
+    }
+    
+    job->encoderChoice.preset = best;
+    emit debugMessage(QString("Pass 1 of %1 ran at %2% of the expected speed, pass 2 uses %3")
+                      .arg(m_videos[job->index].fileName).arg(qRound(drift * 100))
+                      .arg(job->encoderChoice.description()), "info");
 }
 
 void VideoCompressor::setHardwareAccelerationEnabled(bool enabled)
@@ -314,303 +1339,419 @@ void VideoCompressor::setHardwareAccelerationEnabled(bool enabled)
 }
 
 void VideoCompressor::checkFFmpeg()
-{
-    emit debugMessage("Checking FFmpeg availability...", "info");
-    
-    // Check both ffmpeg and ffprobe
-    QProcess ffmpegProcess;
-    ffmpegProcess.start("ffmpeg", QStringList() << "-version");
-    bool ffmpegStarted = ffmpegProcess.waitForStarted(3000);
-    if (ffmpegStarted) {
-        ffmpegProcess.waitForFinished(5000);
-    }
-    
-    QProcess ffprobeProcess;
-    ffprobeProcess.start("ffprobe", QStringList() << "-version");
-    bool ffprobeStarted = ffprobeProcess.waitForStarted(3000);
-    if (ffprobeStarted) {
-        ffprobeProcess.waitForFinished(5000);
-    }
-    
-    bool ffmpegAvailable = ffmpegStarted && (ffmpegProcess.exitCode() == 0);
-    bool ffprobeAvailable = ffprobeStarted && (ffprobeProcess.exitCode() == 0);
-    
-    emit debugMessage("FFmpeg process started: " + QString(ffmpegStarted ? "Yes" : "No"), "info");
-    emit debugMessage("FFprobe process started: " + QString(ffprobeStarted ? "Yes" : "No"), "info");
+{
+    emit debugMessage("Checking FFmpeg availability...", "info");
     
-    if (ffmpegStarted) {
-        emit debugMessage("FFmpeg exit code: " + QString::number(ffmpegProcess.exitCode()), "info");
-        if (ffmpegProcess.exitCode() != 0) {
-            QString ffmpegError = QString::fromUtf8(ffmpegProcess.readAllStandardError());
-            emit debugMessage("FFmpeg error output: " + ffmpegError, "warning");
+    // A cache hit or a binary missing from PATH is answered without a process
+    FFmpegCapabilities capabilities;
+    if (m_capabilityDetector->lookup(&capabilities)) {
+        if (capabilities.located()) {
+            emit debugMessage("Using cached FFmpeg capabilities for " + capabilities.ffmpegPath, "info");
         }
+        applyCapabilities(capabilities);
+        return;
     }
     
-    if (ffprobeStarted) {
-        emit debugMessage("FFprobe exit code: " + QString::number(ffprobeProcess.exitCode()), "info");
-        if (ffprobeProcess.exitCode() != 0) {
-            QString ffprobeError = QString::fromUtf8(ffprobeProcess.readAllStandardError());
-            emit debugMessage("FFprobe error output: " + ffprobeError, "warning");
-        }
+    // Headless runs and vc_bench read the result right after construction
+    if (!hasGui()) {
+        applyCapabilities(m_capabilityDetector->detectNow());
+        return;
     }
     
-    bool previouslyAvailable = m_ffmpegAvailable;
-    m_ffmpegAvailable = ffmpegAvailable && ffprobeAvailable;
+    // Both binaries are on PATH, so the window can accept jobs while the
+    // listings and hardware test encodes run; detected() confirms or withdraws
+    emit debugMessage("New FFmpeg build, detecting capabilities in the background...", "info");
+    if (!m_ffmpegAvailable) {
+        m_ffmpegAvailable = true;
+        emit ffmpegAvailableChanged();
+    }
+    m_capabilityDetector->detect();
+}
+
+void VideoCompressor::applyCapabilities(const FFmpegCapabilities &capabilities)
+{
+    bool previouslyAvailable = m_capabilities.available();
+    m_capabilities = capabilities;
+    m_ffmpegAvailable = capabilities.available();
     emit ffmpegAvailableChanged();
     
     if (m_ffmpegAvailable) {
-        QString ffmpegVersion = QString::fromUtf8(ffmpegProcess.readAllStandardOutput()).split('\n').first();
-        QString ffprobeVersion = QString::fromUtf8(ffprobeProcess.readAllStandardOutput()).split('\n').first();
-        
-        emit debugMessage("FFmpeg found: " + ffmpegVersion, "success");
-        emit debugMessage("FFprobe found: " + ffprobeVersion, "success");
+        emit debugMessage("FFmpeg found: " + capabilities.ffmpegVersion, "success");
+        emit debugMessage("FFprobe found: " + capabilities.ffprobeVersion, "success");
         
         // If FFmpeg was just installed (previously not available)
         if (!previouslyAvailable) {
             emit debugMessage("FFmpeg installation detected successfully!", "success");
         }
         
-        // Check hardware acceleration after confirming FFmpeg works
-        checkHardwareAcceleration();
+        m_encoderRegistry.setAvailable(capabilities.encoders);
+        emit availableEncodersChanged();
+        
+        m_hardwareAccelerationAvailable = capabilities.hardwareType != "None";
+        m_hardwareAccelerationType = capabilities.hardwareType;
+        if (m_hardwareAccelerationAvailable) {
+            emit debugMessage(m_hardwareAccelerationType + " hardware acceleration detected", "success");
+            
+            // Auto-enable if available
+            m_hardwareAccelerationEnabled = true;
+            emit hardwareAccelerationEnabledChanged();
+        } else {
+            emit debugMessage("No hardware acceleration available - will use software encoding", "warning");
+        }
     } else {
-        if (!ffmpegAvailable) {
-            if (!ffmpegStarted) {
-                emit debugMessage("FFmpeg not found in PATH - process failed to start", "error");
-                emit debugMessage("If you just installed FFmpeg, try restarting the application", "info");
-            } else {
-                emit debugMessage("FFmpeg found but returned error code " + QString::number(ffmpegProcess.exitCode()), "error");
-            }
+        if (capabilities.ffmpegPath.isEmpty()) {
+            emit debugMessage("FFmpeg not found in PATH", "error");
+        } else if (!capabilities.ffmpegWorks) {
+            emit debugMessage("FFmpeg found at " + capabilities.ffmpegPath + " but failed to run", "error");
         }
-        if (!ffprobeAvailable) {
-            if (!ffprobeStarted) {
-                emit debugMessage("FFprobe not found in PATH - process failed to start", "error");
-                emit debugMessage("If you just installed FFmpeg, try restarting the application", "info");
-            } else {
-                emit debugMessage("FFprobe found but returned error code " + QString::number(ffprobeProcess.exitCode()), "error");
-            }
+        if (capabilities.ffprobePath.isEmpty()) {
+            emit debugMessage("FFprobe not found in PATH", "error");
+        } else if (!capabilities.ffprobeWorks) {
+            emit debugMessage("FFprobe found at " + capabilities.ffprobePath + " but failed to run", "error");
+        }
+        if (!capabilities.located()) {
+            emit debugMessage("If you just installed FFmpeg, try restarting the application", "info");
         }
         emit debugMessage("Both FFmpeg and FFprobe are required for video processing", "error");
         emit debugMessage("Click 'Install' to automatically install FFmpeg", "info");
         
         m_hardwareAccelerationAvailable = false;
         m_hardwareAccelerationType = "None";
-        emit hardwareAccelerationAvailableChanged();
-        emit hardwareAccelerationTypeChanged();
     }
+    
+    emit hardwareAccelerationAvailableChanged();
+    emit hardwareAccelerationTypeChanged();
 }
 
-void VideoCompressor::checkHardwareAcceleration()
+void VideoCompressor::startFFmpegProcess(CompressionJob *job, bool isFirstPass)
 {
-    emit debugMessage("Detecting hardware acceleration capabilities...", "info");
-    
-    // Reset hardware acceleration state
-    m_hardwareAccelerationAvailable = false;
-    m_hardwareAccelerationType = "None";
-    
-    // Check for NVIDIA NVENC (CUDA)
-    if (testCudaEncoding()) {
-        m_hardwareAccelerationAvailable = true;
-        m_hardwareAccelerationType = "NVIDIA NVENC (CUDA)";
-        emit debugMessage("NVIDIA NVENC hardware acceleration detected", "success");
+    // Cleanup the previous run of this job
+    if (job->encoder) {
+        job->encoder->disconnect(this);
+        job->encoder->deleteLater();
+    }
+    
+    job->isFirstPass = isFirstPass;
+    job->runClock.start();
+    job->lastProgress = FFmpegProgress();
+    const VideoItem &item = m_videos[job->index];
+    EncodeTask task = buildEncodeTask(job, isFirstPass);
+    
+    // Pass 2 must read stats written by the same driver as pass 1; when the
+    // libav backend can't run it (e.g. the audio pre-encode failed and audio
+    // is encoded inline), pass 1 is redone with ffmpeg
+    bool secondPass = !isFirstPass && !isSingleRun(job);
+    if (secondPass && encoderBackendFor(job->backend, task) != job->backend) {
+        emit debugMessage("Pass 2 of " + item.fileName + " can't run in-process, re-running pass 1 with ffmpeg", "warning");
+        job->backend = EncoderBackendKind::Process;
+        job->firstPassDone = false;
+        job->encoder = nullptr;
+        startFFmpegProcess(job, true);
+        return;
     }
-    // Check for Intel QuickSync if CUDA not available
-    else if (testQuickSyncEncoding()) {
-        m_hardwareAccelerationAvailable = true;
-        m_hardwareAccelerationType = "Intel QuickSync";
-        emit debugMessage("Intel QuickSync hardware acceleration detected", "success");
+    EncoderBackendKind backend = encoderBackendFor(job->backend, task);
+    if (isFirstPass) {
+        job->backend = backend;
     }
-    else {
-        emit debugMessage("No hardware acceleration available - will use software encoding", "warning");
+    job->encoder = createEncoderBackend(backend, task, this);
+    EncoderBackend *encoder = job->encoder;
+    
+    // The libav backend's signals are queued and can arrive after finishJob()
+    // deleted the job, so the job is looked up again instead of captured
+    connect(encoder, &EncoderBackend::finished, this, [this, encoder](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (CompressionJob *job = jobForEncoder(encoder)) {
+            onFFmpegFinished(job, exitCode, exitStatus);
+        }
+    });
+    connect(encoder, &EncoderBackend::progress, this, [this, encoder](const FFmpegProgress &progress) {
+        if (CompressionJob *job = jobForEncoder(encoder)) {
+            onJobProgress(job, progress);
+        }
+    });
+    connect(encoder, &EncoderBackend::logLine, this, [this, encoder](const QString &line) {
+        if (CompressionJob *job = jobForEncoder(encoder)) {
+            emit debugMessage("FFmpeg [" + QString::number(job->index + 1) + "]: " + line, "info");
+        }
+    });
+    
+    QString accelInfo = m_hardwareAccelerationEnabled ? QString(" (HW: %1)").arg(m_hardwareAccelerationType) : " (Software)";
+    if (!isSingleRun(job)) {
+        QString passType = isFirstPass ? "first" : "second";
+        emit debugMessage("Starting " + passType + " pass for: " + item.fileName + accelInfo, "info");
+    } else if (job->plan.strategy == EncodeStrategy::Transcode) {
+        emit debugMessage("Starting " + encodeModeName(job).toLower() + " encode for: " + item.fileName + accelInfo, "info");
+    } else {
+        emit debugMessage("Starting " + encodeModeName(job).toLower() + " for: " + item.fileName, "info");
     }
     
-    // Auto-enable if available
-    if (m_hardwareAccelerationAvailable) {
-        m_hardwareAccelerationEnabled = true;
-        emit hardwareAccelerationEnabledChanged();
+    if (qobject_cast<ProcessEncoderBackend *>(encoder)) {
+        // Log the command for debugging
+        QStringList args = FFmpegProgressParser::arguments() + task.arguments;
+        QString debugCmd = "ffmpeg";
+        for (const QString &arg : args) {
+            if (arg.contains(' ') || arg.contains('\\') || arg.contains('/')) {
+                debugCmd += " \"" + arg + "\"";
+            } else {
+                debugCmd += " " + arg;
+            }
+        }
+        emit debugMessage("FFmpeg command: " + debugCmd, "info");
+    } else {
+        emit debugMessage("Encoding in-process with " + encoder->name() + " (" + task.encoderName + ")", "info");
     }
     
-    emit hardwareAccelerationAvailableChanged();
-    emit hardwareAccelerationTypeChanged();
+    encoder->start(task);
 }
 
-bool VideoCompressor::testCudaEncoding()
+void VideoCompressor::startAudioProcess(CompressionJob *job)
 {
-    // First check if NVENC encoders are available
-    QProcess checkProcess;
-    checkProcess.start("ffmpeg", QStringList() << "-hide_banner" << "-encoders");
-    checkProcess.waitForFinished(5000);
-    
-    QString encoderOutput = QString::fromUtf8(checkProcess.readAllStandardOutput());
-    if (!encoderOutput.contains("h264_nvenc")) {
-        emit debugMessage("NVENC encoders not found in FFmpeg build", "info");
-        return false;
-    }
-    
-    // Test actual CUDA functionality with a quick encode
-    QProcess testProcess;
-    QString testFile = m_tempDir + "/test_cuda_temp.mp4";
-    
-    QStringList testArgs;
-    testArgs << "-y" << "-f" << "lavfi" 
-             << "-i" << "testsrc=duration=1:size=320x240:rate=1"
-             << "-c:v" << "h264_nvenc" 
-             << "-t" << "1"
-             << testFile;
+    const VideoItem &item = m_videos[job->index];
+    QString audioEncoder = job->encoderChoice.encoder->audioEncoder();
+    QString audioSuffix = audioEncoder == "aac" ? "_audio.m4a" : "_audio.ogg";
+    job->audioPath = workPathFor(job->outputPath) + audioSuffix;
+    job->audioRunning = true;
+    job->audioProcess = new QProcess(this);
+    
+    connect(job->audioProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, job](int exitCode, QProcess::ExitStatus exitStatus) {
+        onAudioFinished(job, exitCode, exitStatus);
+    });
+    // Without this a missing ffmpeg leaves pass 2 waiting for the audio forever;
+    // queued, so the job may have finished by the time it arrives
+    QProcess *audioProcess = job->audioProcess;
+    connect(audioProcess, &QProcess::errorOccurred, this, [this, job, audioProcess](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart && m_activeJobs.contains(job) && job->audioProcess == audioProcess) {
+            onAudioFinished(job, -1, QProcess::CrashExit);
+        }
+    }, Qt::QueuedConnection);
     
-    testProcess.start("ffmpeg", testArgs);
-    testProcess.waitForFinished(10000);
+    QStringList args;
+    args << "-i" << item.path
+         << "-map" << "0:a:0"
+         << "-vn"
+         << "-c:a" << audioEncoder
+         << "-b:a" << QString("%1k").arg(job->plan.audioBitrateKbps)
+         << "-y" << job->audioPath;
+    
+    emit debugMessage("Encoding audio once for: " + item.fileName + " (" + 
+                     QString::number(job->plan.audioBitrateKbps) + " kbps " +
+                     (audioEncoder == "aac" ? "AAC" : "Opus") + ")", "info");
+    job->audioProcess->start("ffmpeg", args);
+}
+
+void VideoCompressor::onAudioFinished(CompressionJob *job, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    job->audioRunning = false;
+    job->audioProcess->deleteLater();
+    job->audioProcess = nullptr;
     
-    bool testPassed = (testProcess.exitCode() == 0);
+    if (exitStatus != QProcess::NormalExit || exitCode != 0 || !QFileInfo::exists(job->audioPath)) {
+        // Pass 2 will encode the audio itself
+        emit debugMessage("Separate audio encode failed for " + m_videos[job->index].fileName + 
+                         ", encoding audio in pass 2", "warning");
+        QFile::remove(job->audioPath);
+        job->audioPath.clear();
+    }
     
-    if (!testPassed) {
-        QString errorOutput = QString::fromUtf8(testProcess.readAllStandardError());
-        emit debugMessage("CUDA test failed: " + errorOutput.split('\n').last().trimmed(), "info");
+    if (job->firstPassDone) {
+        startSecondPass(job);
+    }
+}
+
+void VideoCompressor::startSecondPass(CompressionJob *job)
+{
+    // Pass 2 needs an encode slot; the analysis slot goes to the next video
+    job->stage = JobStage::Encode;
+    job->waiting = true;
+    if (runningJobs(JobStage::Encode) < effectiveConcurrentJobs()) {
+        job->waiting = false;
+        updateVideoStatus(job->index, VideoStatus::Compressing, "Starting pass 2/2...", 50);
+        startFFmpegProcess(job, false);
+    } else {
+        updateVideoStatus(job->index, VideoStatus::Compressing, "Pass 1/2 done, waiting for an encode slot...", 50);
     }
     
-    // Cleanup test file
-    QFile::remove(testFile);
+    // From here on a restart can skip pass 1
+    journalItem(job->index);
     
-    return testPassed;
+    QMetaObject::invokeMethod(this, &VideoCompressor::processNextVideo, Qt::QueuedConnection);
 }
 
-bool VideoCompressor::testQuickSyncEncoding()
+bool VideoCompressor::retrySecondPassForSize(CompressionJob *job, qint64 outputBytes)
 {
-    // Check if QuickSync encoders are available
-    QProcess checkProcess;
-    checkProcess.start("ffmpeg", QStringList() << "-hide_banner" << "-encoders");
-    checkProcess.waitForFinished(5000);
+    // Bounded so a file that can't be hit (bitrate floor/cap) doesn't loop
+    const double undershootTolerance = 0.10;
+    const double targetMargin = 0.97;
     
-    QString encoderOutput = QString::fromUtf8(checkProcess.readAllStandardOutput());
-    if (!encoderOutput.contains("h264_qsv")) {
-        emit debugMessage("QuickSync encoders not found in FFmpeg build", "info");
+    if (!m_sizeConvergenceEnabled || job->sizeCorrections >= MaxSizeCorrections) {
         return false;
     }
     
-    // Test actual QuickSync functionality
-    QProcess testProcess;
-    QString testFile = m_tempDir + "/test_qsv_temp.mp4";
-    
-    QStringList testArgs;
-    testArgs << "-y" << "-f" << "lavfi" 
-             << "-i" << "testsrc=duration=1:size=320x240:rate=1"
-             << "-c:v" << "h264_qsv" 
-             << "-t" << "1"
-             << testFile;
-    
-    testProcess.start("ffmpeg", testArgs);
-    testProcess.waitForFinished(10000);
-    
-    bool testPassed = (testProcess.exitCode() == 0);
+    const VideoItem &item = m_videos[job->index];
+    qint64 targetBytes = qint64(targetSizeMBFor(item)) * 1024 * 1024;
+    if (outputBytes <= targetBytes && outputBytes >= targetBytes * (1.0 - undershootTolerance)) {
+        return false;
+    }
+    if (outputBytes <= targetBytes && job->plan.videoBitrateKbps >= MaxVideoBitrateKbps) {
+        // Held at the quality cap on purpose, more bits aren't wanted
+        return false;
+    }
     
-    if (!testPassed) {
-        QString errorOutput = QString::fromUtf8(testProcess.readAllStandardError());
-        emit debugMessage("QuickSync test failed: " + errorOutput.split('\n').last().trimmed(), "info");
+    // Scale the video bitrate by how far its share of the output missed; the
+    // audio track is copied in pass 2, so its bytes stay the same
+    qint64 audioBytes = qint64(job->plan.audioBitrateKbps * 125.0 * item.durationSeconds);
+    qint64 videoBytes = outputBytes - audioBytes;
+    qint64 wantedVideoBytes = qint64(targetBytes * targetMargin) - audioBytes;
+    if (videoBytes <= 0 || wantedVideoBytes <= 0) {
+        return false;
     }
     
-    // Cleanup test file
-    QFile::remove(testFile);
+    int oldBitrate = job->plan.videoBitrateKbps;
+    int newBitrate = qBound(100, int(oldBitrate * double(wantedVideoBytes) / videoBytes), int(MaxVideoBitrateKbps));
+    if (qAbs(newBitrate - oldBitrate) < qMax(1, oldBitrate / 50)) {
+        return false;
+    }
     
-    return testPassed;
+    job->sizeCorrections++;
+    job->plan.videoBitrateKbps = newBitrate;
+    emit debugMessage(QString("%1 came out at %2 (%3% vs target), re-running pass 2 at %4 kbps instead of %5 kbps (correction %6/%7)")
+                     .arg(item.fileName)
+                     .arg(formatFileSize(outputBytes))
+                     .arg(QString::number((double(outputBytes) / targetBytes - 1.0) * 100, 'f', 1))
+                     .arg(newBitrate)
+                     .arg(oldBitrate)
+                     .arg(job->sizeCorrections)
+                     .arg(MaxSizeCorrections), "warning");
+    
+    // Pass 1 stats and the pre-encoded audio are still on disk
+    QFile::remove(job->outputPath);
+    updateVideoStatus(job->index, VideoStatus::Compressing,
+                     QString("Correcting size (%1/%2)...").arg(job->sizeCorrections).arg(MaxSizeCorrections), 50);
+    if (job->segmentEncoder) {
+        job->runClock.start();
+        job->segmentEncoder->rerunSecondPass(newBitrate);
+    } else {
+        startFFmpegProcess(job, false);
+    }
+    return true;
 }
 
-QString VideoCompressor::getHardwareEncoderName()
+void VideoCompressor::onJobProgress(CompressionJob *job, const FFmpegProgress &progress)
 {
-    if (!m_hardwareAccelerationEnabled || !m_hardwareAccelerationAvailable) {
-        return "libx264"; // Software encoder
+    job->lastProgress = progress;
+    const VideoItem &item = m_videos[job->index];
+    if (item.durationSeconds <= 0) {
+        return;
     }
     
-    if (m_hardwareAccelerationType.contains("NVENC")) {
-        return "h264_nvenc";
-    } else if (m_hardwareAccelerationType.contains("QuickSync")) {
-        return "h264_qsv";
+    double currentTime = qMin(progress.outTimeSeconds, item.durationSeconds);
+    QString statusText;
+    int totalProgress;
+    double remainingSeconds = item.durationSeconds - currentTime;
+    if (isSingleRun(job)) {
+        // Single run: 0-100%
+        int runProgress = (currentTime / item.durationSeconds) * 100;
+        totalProgress = qMin(95, runProgress);
+        statusText = QString("%1: %2%").arg(encodeModeName(job)).arg(runProgress);
+    } else {
+        int baseProgress = job->isFirstPass ? 0 : 50; // First pass: 0-50%, Second pass: 50-100%
+        int passProgress = (currentTime / item.durationSeconds) * 50;
+        totalProgress = qMin(95, baseProgress + passProgress);
+        statusText = QString("Pass %1/2: %2%").arg(job->isFirstPass ? 1 : 2).arg(passProgress * 2);
+        if (job->isFirstPass) {
+            // Pass 2 runs at about the same speed as pass 1
+            remainingSeconds += item.durationSeconds;
+        }
     }
     
-    return "libx264"; // Fallback to software
+    updateVideoStatus(job->index, VideoStatus::Compressing, statusText, totalProgress);
+    updateThroughput(job->index, progress, progress.speed > 0 ? qRound(remainingSeconds / progress.speed) : -1);
 }
 
-QString VideoCompressor::getHardwareAcceleratorFlag()
+void VideoCompressor::updateThroughput(int index, const FFmpegProgress &progress, int etaSeconds)
 {
-    if (!m_hardwareAccelerationEnabled || !m_hardwareAccelerationAvailable) {
-        return "";
+    if (index < 0 || index >= m_videos.size()) {
+        return;
     }
     
-    if (m_hardwareAccelerationType.contains("NVENC")) {
-        return "cuda";
-    } else if (m_hardwareAccelerationType.contains("QuickSync")) {
-        return "qsv";
-    }
+    VideoItem &item = m_videos[index];
+    item.encodeFps = progress.fps;
+    item.encodeSpeed = progress.speed;
+    item.encodeBitrateKbps = qRound(progress.bitrateKbps);
+    item.outputBytes = progress.totalSizeBytes;
+    item.etaSeconds = etaSeconds;
     
-    return "";
+    QModelIndex idx = this->index(index);
+    emit dataChanged(idx, idx, {EncodeFpsRole, EncodeSpeedRole, EncodeBitrateRole, OutputBytesRole, EtaRole});
+    emit videoThroughputChanged(item.id, item.encodeFps, item.encodeSpeed, etaSeconds);
 }
 
-void VideoCompressor::startFFmpegProcess(const VideoItem &item, const QString &outputPath, bool isFirstPass)
+QStringList VideoCompressor::buildFFmpegArgs(const CompressionJob *job, bool isFirstPass)
 {
-    // Cleanup previous process
-    if (m_ffmpegProcess) {
-        m_ffmpegProcess->deleteLater();
-    }
-    
-    m_ffmpegProcess = new QProcess(this);
-    connect(m_ffmpegProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &VideoCompressor::onFFmpegFinished);
+    const VideoItem &item = m_videos[job->index];
+    QStringList args;
     
-    // Connect to capture FFmpeg output for progress tracking
-    connect(m_ffmpegProcess, &QProcess::readyReadStandardError, this, [this, isFirstPass]() {
-        if (m_ffmpegProcess) {
-            QByteArray data = m_ffmpegProcess->readAllStandardError();
-            QString output = QString::fromUtf8(data);
-            
-            // Parse progress from FFmpeg output
-            QRegularExpression timeRegex(R"(time=(\d+):(\d+):(\d+\.\d+))");
-            QRegularExpressionMatch match = timeRegex.match(output);
-            
-            if (match.hasMatch() && m_currentVideoIndex >= 0 && m_currentVideoIndex < m_videos.size()) {
-                double hours = match.captured(1).toDouble();
-                double minutes = match.captured(2).toDouble();
-                double seconds = match.captured(3).toDouble();
-                double currentTime = hours * 3600 + minutes * 60 + seconds;
-                
-                const VideoItem &item = m_videos[m_currentVideoIndex];
-                if (item.durationSeconds > 0) {
-                    int baseProgress = isFirstPass ? 0 : 50; // First pass: 0-50%, Second pass: 50-100%
-                    int passProgress = (currentTime / item.durationSeconds) * 50;
-                    int totalProgress = qMin(95, baseProgress + passProgress);
-                    
-                    QString statusText = isFirstPass ? 
-                        QString("Pass 1/2: %1%").arg(passProgress * 2) :
-                        QString("Pass 2/2: %1%").arg(passProgress * 2);
-                    
-                    updateVideoStatus(m_currentVideoIndex, VideoStatus::Compressing, statusText, totalProgress);
-                }
-            }
-            
-            // Log significant FFmpeg messages
-            QStringList lines = output.split('\n');
-            for (const QString &line : lines) {
-                QString trimmed = line.trimmed();
-                if (!trimmed.isEmpty() && 
-                    !trimmed.startsWith("frame=") && 
-                    !trimmed.startsWith("fps=") &&
-                    !trimmed.contains("time=") &&
-                    trimmed.length() > 10) {
-                    emit debugMessage("FFmpeg: " + trimmed, "info");
-                }
-            }
+    if (job->plan.strategy != EncodeStrategy::Transcode) {
+        // Stream copy into MP4; only the first video and audio track are kept
+        args << "-i" << item.path
+             << "-map" << "0:v:0"
+             << "-map" << "0:a:0?"
+             << "-c:v" << "copy";
+        if (job->plan.strategy == EncodeStrategy::AudioReencode) {
+            args << "-c:a" << "aac" << "-b:a" << QString("%1k").arg(job->plan.audioBitrateKbps);
+        } else {
+            args << "-c:a" << "copy";
         }
-    });
+        args << "-movflags" << "+faststart"
+             << "-y" << job->outputPath;
+        return args;
+    }
+    
+    // Rate control and encoder options come from the job's encoder strategy
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    int audioBitrate = job->plan.audioBitrateKbps;
+    RateControl rc;
+    rc.bitrateKbps = job->plan.videoBitrateKbps;
+    rc.crf = job->mode == EncodingMode::CappedCrf;
+    rc.threads = threadsPerJob();
+    
+    // Silent sources get no audio track instead of an encoded silence budget
+    QStringList audioArgs;
+    if (audioBitrate > 0) {
+        audioArgs << "-c:a" << encoder->audioEncoder() << "-b:a" << QString("%1k").arg(audioBitrate);
+    } else {
+        audioArgs << "-an";
+    }
     
-    // Build FFmpeg arguments properly with hardware acceleration support
-    QStringList args;
-    int videoBitrate = calculateOptimalBitrate(item.durationSeconds, m_targetSizeMB);
-    QString encoderName = getHardwareEncoderName();
-    QString hwAccelFlag = getHardwareAcceleratorFlag();
+    // 10-bit or 4:4:4 sources would produce profiles browsers can't play;
+    // scale/fps filters from the plan apply identically to both passes
+    QStringList pixelFormatArgs = EncodePlanner::videoFilterArgs(job->plan);
+    if (!item.media.pixelFormat.isEmpty() && item.media.pixelFormat != "yuv420p") {
+        pixelFormatArgs << "-pix_fmt" << "yuv420p";
+    }
+    
+    // Only MP4 needs its index moved to the front for streaming
+    QStringList muxerArgs;
+    if (encoder->container() == "mp4") {
+        muxerArgs << "-movflags" << "+faststart";
+    }
     
     // Add hardware acceleration flag if available
-    if (!hwAccelFlag.isEmpty() && !isFirstPass) {
-        args << "-hwaccel" << hwAccelFlag;
+    if (encoder->isHardware() && !isFirstPass) {
+        args << "-hwaccel" << encoder->hwaccel();
     }
     
-    if (isFirstPass) {
+    if (job->mode != EncodingMode::TwoPass) {
+        // Single pass: one decode, VBV buffer of two seconds at the target
+        // rate keeps peaks bounded
+        rc.maxRateKbps = rc.bitrateKbps;
+        args << "-i" << item.path
+             << encoder->videoArgs(job->encoderChoice.preset, rc)
+             << pixelFormatArgs
+             << audioArgs
+             << muxerArgs
+             << "-y" << job->outputPath;
+    } else if (isFirstPass) {
         // First pass: analysis only, output to NULL/NUL
         QString nullOutput = 
 #ifdef Q_OS_WIN
@@ -618,109 +1759,161 @@ void VideoCompressor::startFFmpegProcess(const VideoItem &item, const QString &o
 #else
             "/dev/null";
 #endif
+        // Audio is encoded separately, so pass 1 is video analysis only
+        rc.pass = 1;
+        rc.passLogPrefix = job->passLogPrefix;
         args << "-i" << item.path
-             << "-c:v" << encoderName
-             << "-b:v" << QString("%1k").arg(videoBitrate)
-             << "-c:a" << "aac"
-             << "-b:a" << "128k"
-             << "-pass" << "1"
-             << "-f" << "mp4"
+             << encoder->videoArgs(job->encoderChoice.preset, rc)
+             << pixelFormatArgs
+             << "-an"
+             << "-f" << encoder->container()
              << "-y" << nullOutput;
     } else {
         // Second pass: actual encoding with optimized settings
-        args << "-i" << item.path
-             << "-c:v" << encoderName
-             << "-b:v" << QString("%1k").arg(videoBitrate)
-             << "-c:a" << "aac"
-             << "-b:a" << "128k"
-             << "-pass" << "2"
-             << "-movflags" << "+faststart"
-             << "-y" << outputPath;
-    }
-    
-    QString passType = isFirstPass ? "first" : "second";
-    QString accelInfo = m_hardwareAccelerationEnabled ? QString(" (HW: %1)").arg(m_hardwareAccelerationType) : " (Software)";
-    emit debugMessage("Starting " + passType + " pass for: " + item.fileName + accelInfo, "info");
-    
-    // Log the command for debugging
-    QString debugCmd = "ffmpeg";
-    for (const QString &arg : args) {
-        if (arg.contains(' ') || arg.contains('\\') || arg.contains('/')) {
-            debugCmd += " \"" + arg + "\"";
-        } else {
-            debugCmd += " " + arg;
+        args << "-i" << item.path;
+        if (!job->audioPath.isEmpty()) {
+            // Video only, mux the audio track encoded during pass 1
+            args << "-i" << job->audioPath
+                 << "-map" << "0:v:0"
+                 << "-map" << "1:a:0";
+            audioArgs = QStringList() << "-c:a" << "copy";
         }
+        rc.pass = 2;
+        rc.passLogPrefix = job->passLogPrefix;
+        args << encoder->videoArgs(job->encoderChoice.preset, rc)
+             << pixelFormatArgs
+             << audioArgs
+             << muxerArgs
+             << "-y" << job->outputPath;
     }
-    emit debugMessage("FFmpeg command: " + debugCmd, "info");
     
-    m_ffmpegProcess->start("ffmpeg", args);
+    return args;
 }
 
-void VideoCompressor::onFFmpegFinished(int exitCode, QProcess::ExitStatus exitStatus)
+EncodeTask VideoCompressor::buildEncodeTask(const CompressionJob *job, bool isFirstPass)
 {
-    if (m_currentVideoIndex < 0 || m_currentVideoIndex >= m_videos.size()) {
-        return;
-    }
-    
-    VideoItem &item = m_videos[m_currentVideoIndex];
+    const VideoItem &item = m_videos[job->index];
+    EncodeTask task;
+    task.arguments = buildFFmpegArgs(job, isFirstPass);
+    task.inputPath = item.path;
+    task.outputPath = job->outputPath;
+    task.transcode = job->plan.strategy == EncodeStrategy::Transcode;
+    if (!task.transcode) {
+        return task;
+    }
+    
+    // The same run buildFFmpegArgs() describes, field by field
+    bool twoPass = job->mode == EncodingMode::TwoPass;
+    if (twoPass) {
+        task.pass = isFirstPass ? 1 : 2;
+        task.passLogPrefix = job->passLogPrefix;
+    }
+    if (task.pass == 1) {
+        task.outputPath.clear();
+    }
+    const EncoderStrategy *encoder = job->encoderChoice.encoder;
+    task.encoderName = encoder->name();
+    task.encoderOptions = encoder->options(job->encoderChoice.preset);
+    task.format = encoder->container();
+    task.videoBitrateKbps = job->plan.videoBitrateKbps;
+    task.maxRateKbps = twoPass ? 0 : job->plan.videoBitrateKbps;
+    if (job->mode == EncodingMode::CappedCrf) {
+        task.crf = encoder->crfValue();
+        task.videoBitrateKbps = encoder->crfTakesBitrate() ? task.maxRateKbps : 0;
+    }
+    task.shortSide = job->plan.shortSide;
+    task.frameRate = job->plan.frameRate;
+    task.threads = threadsPerJob();
+    if (task.pass == 2 && !job->audioPath.isEmpty()) {
+        task.audioPath = job->audioPath;
+    } else if (task.pass != 1) {
+        task.audioBitrateKbps = job->plan.audioBitrateKbps;
+    }
+    task.hardwareDecode = encoder->isHardware() && !isFirstPass;
+    return task;
+}
+
+void VideoCompressor::onFFmpegFinished(CompressionJob *job, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    VideoItem &item = m_videos[job->index];
+    qint64 targetBytes = qint64(targetSizeMBFor(item)) * 1024 * 1024;
     
     if (exitStatus == QProcess::NormalExit && exitCode == 0) {
-        if (m_isFirstPass) {
-            // First pass completed, start second pass
-            m_isFirstPass = false;
-            updateVideoStatus(m_currentVideoIndex, VideoStatus::Compressing, "Starting pass 2/2...", 50);
-            
-            QString baseName = QFileInfo(item.path).baseName();
-            QString outputPath = m_tempDir + "/" + baseName + "_compressed.mp4";
-            
-            QTimer::singleShot(500, this, [this, item, outputPath]() {
-                startFFmpegProcess(item, outputPath, false);
-            });
-            return;
-        } else {
-            // Second pass completed
-            QFileInfo outputInfo(item.outputPath);
-            if (outputInfo.exists()) {
-                double sizeReduction = (1.0 - (double)outputInfo.size() / item.fileSizeBytes) * 100;
-                updateVideoStatus(m_currentVideoIndex, VideoStatus::Completed, 
-                                QString("Compressed to %1").arg(formatFileSize(outputInfo.size())), 100);
-                m_completedCount++;
-                emit completedCountChanged();
-                
-                emit debugMessage("Compression completed: " + item.fileName + 
-                                " (" + formatFileSize(item.fileSizeBytes) + " → " + 
-                                formatFileSize(outputInfo.size()) + ", " + 
-                                QString::number(sizeReduction, 'f', 1) + "% reduction)", "success");
-            } else {
-                updateVideoStatus(m_currentVideoIndex, VideoStatus::Error, "Output file not created", 0);
-                emit debugMessage("Compression failed: Output file not created for " + item.fileName, "error");
+        if (job->plan.strategy == EncodeStrategy::Transcode) {
+            // Pass 1 is compared against the estimate before its speed is
+            // folded in; the preset is settled before the journal records it
+            int runPreset = job->encoderChoice.preset;
+            if (!isSingleRun(job) && job->isFirstPass) {
+                reconsiderPreset(job);
+            }
+            recordEncodeSpeed(job, runPreset);
+        }
+        
+        if (!isSingleRun(job) && job->isFirstPass) {
+            // First pass completed, start second pass once the audio is ready
+            job->firstPassDone = true;
+            if (job->audioRunning) {
+                updateVideoStatus(job->index, VideoStatus::Compressing, "Pass 1/2 done, waiting for audio...", 50);
+                return;
             }
+            startSecondPass(job);
+            return;
+        }
+        
+        QFileInfo outputInfo(job->outputPath);
+        
+        if (job->plan.strategy != EncodeStrategy::Transcode && outputInfo.exists() && outputInfo.size() > targetBytes) {
+            // Stream copy missed the prediction, encode instead
+            emit debugMessage("Stream copy of " + item.fileName + " came out at " + 
+                             formatFileSize(outputInfo.size()) + ", falling back to a full encode", "warning");
+            QFile::remove(job->outputPath);
+            job->plan = planFor(item, false);
+            prepareTranscode(job);
+            startTranscode(job);
+            return;
+        }
+        
+        if (job->plan.strategy == EncodeStrategy::Transcode && job->mode == EncodingMode::CappedCrf &&
+            outputInfo.exists() && outputInfo.size() > targetBytes) {
+            // CRF wanted more bits than the budget allows, use plain ABR
+            emit debugMessage("Capped CRF output of " + item.fileName + " is " + 
+                             formatFileSize(outputInfo.size()) + ", re-encoding single-pass", "warning");
+            QFile::remove(job->outputPath);
+            job->mode = EncodingMode::SinglePass;
+            startTranscode(job);
+            setEncodeMode(job->index, "Capped CRF → Single-pass");
+            return;
         }
+        
+        if (job->plan.strategy == EncodeStrategy::Transcode && job->mode == EncodingMode::TwoPass &&
+            outputInfo.exists() && retrySecondPassForSize(job, outputInfo.size())) {
+            return;
+        }
+        
+        reportOutput(job, QString());
+    } else if (job->plan.strategy != EncodeStrategy::Transcode) {
+        // A failed stream copy is retried as a regular encode
+        emit debugMessage(EncodePlanner::strategyName(job->plan.strategy) + " failed for " + item.fileName + 
+                         " (Exit code: " + QString::number(exitCode) + "), falling back to a full encode", "warning");
+        QFile::remove(job->outputPath);
+        job->plan = planFor(item, false);
+        prepareTranscode(job);
+        startTranscode(job);
+        return;
+    } else if (isSingleRun(job)) {
+        updateVideoStatus(job->index, VideoStatus::Error, encodeModeName(job) + " encode failed", 0);
+        emit debugMessage("FFmpeg " + encodeModeName(job).toLower() + " encode failed for " + item.fileName + 
+                         " (Exit code: " + QString::number(exitCode) + ")", "error");
     } else {
-        QString passType = m_isFirstPass ? "first" : "second";
-        updateVideoStatus(m_currentVideoIndex, VideoStatus::Error, 
-                         QString("Pass %1 failed").arg(m_isFirstPass ? "1" : "2"), 0);
+        QString passType = job->isFirstPass ? "first" : "second";
+        updateVideoStatus(job->index, VideoStatus::Error, 
+                         QString("Pass %1 failed").arg(job->isFirstPass ? "1" : "2"), 0);
         emit debugMessage("FFmpeg " + passType + " pass failed for " + item.fileName + 
                          " (Exit code: " + QString::number(exitCode) + ")", "error");
     }
     
-    // Clean up pass files after each video
-    cleanupPassFiles();
-    
-    QTimer::singleShot(500, this, &VideoCompressor::processNextVideo);
-}
-
-void VideoCompressor::onFFmpegProgress()
-{
-    // Simple progress simulation - FFmpeg progress parsing would be more complex
-    if (m_currentVideoIndex >= 0 && m_currentVideoIndex < m_videos.size()) {
-        VideoItem &item = m_videos[m_currentVideoIndex];
-        if (item.status == VideoStatus::Compressing && item.progress < 90) {
-            item.progress += 10;
-            QModelIndex idx = index(m_currentVideoIndex);
-            emit dataChanged(idx, idx, {ProgressRole});
-        }
-    }
+    // Release the slot and clean up this job's pass files
+    finishJob(job);
 }
 
 void VideoCompressor::copyToClipboard()
@@ -737,7 +1930,12 @@ void VideoCompressor::copyToClipboard()
         return;
     }
     
-    QClipboard *clipboard = QApplication::clipboard();
+    if (!hasGui()) {
+        emit error("Clipboard is not available in headless mode");
+        return;
+    }
+    
+    QClipboard *clipboard = QGuiApplication::clipboard();
     QMimeData *mimeData = new QMimeData();
     
     QList<QUrl> urls;
@@ -770,23 +1968,60 @@ void VideoCompressor::saveToFolder(const QUrl &folderUrl)
     }
     
     int copiedCount = 0;
-    for (const auto &item : m_videos) {
-        if (item.status == VideoStatus::Completed || item.status == VideoStatus::AlreadyOptimal) {
-            QString targetPath = targetDir.filePath(QFileInfo(item.outputPath).fileName());
-            if (QFile::copy(item.outputPath, targetPath)) {
-                copiedCount++;
-            }
+    QHash<QString, int> methodCounts;
+    for (int i = 0; i < m_videos.size(); ++i) {
+        VideoItem &item = m_videos[i];
+        if (item.status != VideoStatus::Completed && item.status != VideoStatus::AlreadyOptimal) {
+            continue;
+        }
+        QString targetPath = targetDir.filePath(QFileInfo(item.outputPath).fileName());
+        if (QFileInfo(targetPath) == QFileInfo(item.outputPath)) {
+            copiedCount++; // Written there directly
+            continue;
+        }
+        
+        // Temp outputs can be moved unless a paste from the clipboard still
+        // needs them; originals and files saved before belong to the user
+        FileDelivery::Source source = FileDelivery::Source::User;
+        if (item.status == VideoStatus::Completed && isTempPath(item.outputPath)) {
+            source = isFileInClipboard(item.outputPath) ? FileDelivery::Source::Owned : FileDelivery::Source::Movable;
+        }
+        FileDelivery::Method method = FileDelivery::deliver(item.outputPath, targetPath, source);
+        if (method == FileDelivery::Method::Failed) {
+            emit debugMessage("Could not save " + item.fileName + " to " + targetPath, "warning");
+            continue;
+        }
+        copiedCount++;
+        methodCounts[FileDelivery::methodName(method)]++;
+        
+        if (method == FileDelivery::Method::Rename) {
+            // The temp file is gone; clipboard copies and later saves use the new place
+            item.outputPath = targetPath;
+            QModelIndex idx = index(i);
+            emit dataChanged(idx, idx, {OutputPathRole});
+            journalItem(i);
         }
     }
     
     if (copiedCount > 0) {
-        emit debugMessage("Successfully saved " + QString::number(copiedCount) + " videos to " + folderPath, "success");
+        QStringList methods;
+        for (auto it = methodCounts.constBegin(); it != methodCounts.constEnd(); ++it) {
+            methods.append(QString::number(it.value()) + " " + it.key());
+        }
+        emit debugMessage("Successfully saved " + QString::number(copiedCount) + " videos to " + folderPath +
+                         (methods.isEmpty() ? QString() : " (" + methods.join(", ") + ")"), "success");
     } else {
         emit error("No videos were copied");
         emit debugMessage("Failed to save videos - no completed videos found", "error");
     }
 }
 
+void VideoCompressor::clearMediaCache()
+{
+    m_mediaCache->clear();
+    emit debugMessage("Media cache cleared", "info");
+}
+
 void VideoCompressor::installFFmpeg()
 {
     emit ffmpegInstallationRequested();
@@ -922,25 +2157,15 @@ void VideoCompressor::onInstallProcessFinished(int exitCode, QProcess::ExitStatu
     m_installProcess = nullptr;
 }
 
-void VideoCompressor::cleanupPassFiles()
+void VideoCompressor::cleanupPassFiles(const QString &passLogPrefix)
 {
-    // Clean up FFmpeg two-pass log files
-    QDir tempDir(m_tempDir);
-    QStringList passFiles = tempDir.entryList(QStringList() << "ffmpeg2pass-*.log*", QDir::Files);
+    // Clean up this job's FFmpeg two-pass log files (<prefix>-0.log, <prefix>-0.log.mbtree)
+    QFileInfo prefixInfo(passLogPrefix);
+    QDir passDir = prefixInfo.absoluteDir();
+    QStringList passFiles = passDir.entryList(QStringList() << prefixInfo.fileName() + "-*.log*", QDir::Files);
     
     for (const QString &file : passFiles) {
-        QString fullPath = tempDir.filePath(file);
-        if (QFile::remove(fullPath)) {
-            emit debugMessage("Cleaned up pass file: " + file, "info");
-        }
-    }
-    
-    // Also check current directory for pass files
-    QDir currentDir(".");
-    QStringList currentPassFiles = currentDir.entryList(QStringList() << "ffmpeg2pass-*.log*", QDir::Files);
-    
-    for (const QString &file : currentPassFiles) {
-        if (QFile::remove(file)) {
+        if (QFile::remove(passDir.filePath(file))) {
             emit debugMessage("Cleaned up pass file: " + file, "info");
         }
     }
@@ -984,7 +2209,12 @@ bool VideoCompressor::isVideoFile(const QString &path)
     };
     
     QString suffix = QFileInfo(path).suffix().toLower();
-    return videoExtensions.contains(suffix);
+    if (!videoExtensions.contains(suffix)) {
+        return false;
+    }
+    
+    // The extension can lie (a saved error page, a renamed image); the first bytes don't
+    return ContainerReader::sniffFile(path) != ContainerReader::Signature::NotVideo;
 }
 
 void VideoCompressor::updateVideoStatus(int index, VideoStatus status, const QString &statusText, int progress)
@@ -994,108 +2224,146 @@ void VideoCompressor::updateVideoStatus(int index, VideoStatus status, const QSt
     }
     
     VideoItem &item = m_videos[index];
+    bool statusChanged = item.status != status;
     item.status = status;
     item.statusText = statusText;
     item.progress = progress;
     
+    // Progress updates are frequent, only state changes go to the journal
+    if (statusChanged) {
+        journalItem(index);
+    }
+    
     QModelIndex idx = this->index(index);
     emit dataChanged(idx, idx, {StatusRole, StatusTextRole, ProgressRole});
+    emit videoStatusChanged(item.id, static_cast<int>(status), statusText, progress);
 }
 
-void VideoCompressor::generateThumbnail(VideoItem &item)
+void VideoCompressor::journalItem(int index)
 {
-    // Always check FFmpeg availability first
-    if (!m_ffmpegAvailable) {
-        emit debugMessage("Cannot generate thumbnail: FFmpeg not available", "warning");
-        createPlaceholderThumbnail(item);
-        // Find the item index and update the model
-        for (int i = 0; i < m_videos.size(); ++i) {
-            if (m_videos[i].path == item.path) {
-                QModelIndex idx = index(i);
-                emit dataChanged(idx, idx, {ThumbnailRole});
-                break;
-            }
-        }
+    if (!m_journal) {
         return;
     }
     
-    // Test if FFmpeg actually works before using it
-    QProcess testProcess;
-    testProcess.start("ffmpeg", QStringList() << "-version");
-    bool canStart = testProcess.waitForStarted(2000);
-    if (canStart) {
-        testProcess.waitForFinished(2000);
+    const VideoItem &item = m_videos[index];
+    JournalEntry entry;
+    entry.path = item.path;
+    entry.sourceSize = item.fileSizeBytes;
+    entry.sourceModifiedMs = QFileInfo(item.path).lastModified().toMSecsSinceEpoch();
+    entry.status = static_cast<int>(item.status);
+    entry.queued = m_isCompressing && (item.status == VideoStatus::Compressing || m_pendingIndices.contains(index));
+    entry.outputPath = item.outputPath;
+    entry.outputReady = item.status == VideoStatus::Completed && QFileInfo::exists(item.outputPath);
+    entry.encodeMode = item.encodeMode;
+    entry.targetSizeMB = targetSizeMBFor(item);
+    entry.encodingMode = item.encodingMode >= 0 ? item.encodingMode : static_cast<int>(m_encodingMode);
+    
+    // Pass 1 stats are only worth keeping while pass 2 still has to run
+    for (const CompressionJob *job : std::as_const(m_activeJobs)) {
+        if (job->index == index) {
+            entry.queued = true; // Includes jobs parked for a slot
+        }
+        if (job->index == index && item.status == VideoStatus::Compressing && job->firstPassDone &&
+            !job->audioRunning && !job->segmentEncoder && job->mode == EncodingMode::TwoPass) {
+            entry.passLogPrefix = job->passLogPrefix;
+            entry.audioPath = job->audioPath;
+            entry.videoBitrateKbps = job->plan.videoBitrateKbps;
+            entry.encoderName = job->encoderChoice.encoder->name();
+            entry.encoderPreset = job->encoderChoice.preset;
+        }
     }
     
-    if (!canStart || testProcess.exitCode() != 0) {
-        emit debugMessage("FFmpeg test failed during thumbnail generation", "warning");
-        createPlaceholderThumbnail(item);
-        // Find the item index and update the model
-        for (int i = 0; i < m_videos.size(); ++i) {
-            if (m_videos[i].path == item.path) {
-                QModelIndex idx = index(i);
-                emit dataChanged(idx, idx, {ThumbnailRole});
-                break;
-            }
-        }
+    m_journal->record(entry);
+}
+
+void VideoCompressor::restoreJournal()
+{
+    if (!m_journal) {
         return;
     }
     
-    QString thumbnailPath = m_tempDir + "/" + QFileInfo(item.path).baseName() + "_thumb.jpg";
-    
-    // Use FFmpeg to extract a frame at 10% of video duration
-    QProcess thumbnailProcess;
-    QStringList args;
-    
-    // Calculate seek time (10% of duration, or 5 seconds if duration unknown)
-    double seekTime = item.durationSeconds > 0 ? item.durationSeconds * 0.1 : 5.0;
-    
-    args << "-i" << item.path
-         << "-ss" << QString::number(seekTime, 'f', 2)
-         << "-vframes" << "1"
-         << "-q:v" << "2"  // High quality
-         << "-vf" << "scale=120:68:force_original_aspect_ratio=decrease,pad=120:68:(ow-iw)/2:(oh-ih)/2:black"
-         << "-y" << thumbnailPath;
-    
-    emit debugMessage("Generating thumbnail for: " + item.fileName, "info");
-    
-    thumbnailProcess.start("ffmpeg", args);
-    if (thumbnailProcess.waitForFinished(10000)) {
-        if (thumbnailProcess.exitCode() == 0 && QFileInfo::exists(thumbnailPath)) {
-            QPixmap thumbnail;
-            if (thumbnail.load(thumbnailPath)) {
-                item.thumbnail = thumbnail;
-                emit debugMessage("Thumbnail generated successfully for: " + item.fileName, "success");
-            } else {
-                emit debugMessage("Failed to load generated thumbnail for: " + item.fileName, "warning");
-                createPlaceholderThumbnail(item);
+    QList<int> resumeRows;
+    int restoredCount = 0;
+    const QList<JournalEntry> entries = m_journal->entries();
+    for (const JournalEntry &entry : entries) {
+        QFileInfo source(entry.path);
+        if (!source.exists() || source.size() != entry.sourceSize ||
+            source.lastModified().toMSecsSinceEpoch() != entry.sourceModifiedMs) {
+            emit debugMessage("Not restoring " + source.fileName() + ", the file changed or is gone", "warning");
+            m_journal->remove(entry.path);
+            continue;
+        }
+        
+        int previousCount = m_videos.size();
+        addVideoFromPath(entry.path);
+        if (m_videos.size() == previousCount) {
+            m_journal->remove(entry.path);
+            continue;
+        }
+        restoredCount++;
+        
+        int index = m_videos.size() - 1;
+        VideoItem &item = m_videos[index];
+        VideoStatus status = static_cast<VideoStatus>(entry.status);
+        if (status == VideoStatus::Completed && entry.outputReady && QFileInfo::exists(entry.outputPath)) {
+            // Reuse the finished output, no encode needed
+            item.outputPath = entry.outputPath;
+            setEncodeMode(index, entry.encodeMode);
+            updateVideoStatus(index, VideoStatus::Completed,
+                             "Restored " + formatFileSize(QFileInfo(entry.outputPath).size()), 100);
+            m_completedCount++;
+            emit completedCountChanged();
+        } else if (status == VideoStatus::AlreadyOptimal) {
+            item.outputPath = item.path;
+            setEncodeMode(index, "Original");
+            updateVideoStatus(index, VideoStatus::AlreadyOptimal, "Already optimal size", 100);
+            m_completedCount++;
+            emit completedCountChanged();
+        } else if (entry.queued) {
+            // Pass 1 stats only fit the settings and encoder they were made with
+            item.targetSizeMB = entry.targetSizeMB;
+            item.encodingMode = entry.encodingMode;
+            const EncoderStrategy *encoder = m_encoderRegistry.find(entry.encoderName);
+            bool hardwareReady = m_hardwareAccelerationEnabled && m_hardwareAccelerationAvailable;
+            if (entry.firstPassDone() && encoder && (!encoder->isHardware() || hardwareReady)) {
+                item.outputPath = entry.outputPath;
+                m_resumeState.insert(item.id, entry);
+                m_journal->record(entry); // Keep referencing the pass 1 files
             }
-            // Clean up temporary thumbnail file
-            QFile::remove(thumbnailPath);
-        } else {
-            QString errorOutput = QString::fromUtf8(thumbnailProcess.readAllStandardError());
-            emit debugMessage("Thumbnail generation failed for " + item.fileName + ": " + errorOutput, "warning");
-            createPlaceholderThumbnail(item);
+            resumeRows.append(index);
         }
-    } else {
-        emit debugMessage("Thumbnail generation timed out for: " + item.fileName, "warning");
-        createPlaceholderThumbnail(item);
     }
     
-    // Always update the model after thumbnail generation (success or failure)
-    for (int i = 0; i < m_videos.size(); ++i) {
-        if (m_videos[i].path == item.path) {
-            m_videos[i].thumbnail = item.thumbnail; // Update the actual item in the list
-            QModelIndex idx = index(i);
-            emit dataChanged(idx, idx, {ThumbnailRole});
-            break;
-        }
+    if (restoredCount > 0) {
+        emit debugMessage(QString("Restored %1 videos from the job journal").arg(restoredCount), "success");
+    }
+    if (resumeRows.isEmpty() || !m_ffmpegAvailable) {
+        return;
+    }
+    
+    // Resume only the interrupted jobs, finished rows keep their outputs
+    emit debugMessage(QString("Resuming %1 unfinished jobs from the last session").arg(resumeRows.size()), "info");
+    QDir().mkpath(m_tempDir);
+    beginBatch();
+    for (int index : std::as_const(resumeRows)) {
+        queueRow(index);
     }
 }
 
+void VideoCompressor::setThumbnail(VideoItem &item, const QByteArray &encoded)
+{
+    m_thumbnailCache->insert(QString::number(item.id), encoded);
+    item.thumbnailRevision++;
+}
+
 void VideoCompressor::createPlaceholderThumbnail(VideoItem &item)
 {
-    QPixmap placeholder(120, 68);
+    // QFont needs a QGuiApplication; headless runs have no list to show it in
+    if (!hasGui()) {
+        return;
+    }
+    
+    QImage placeholder(120, 68, QImage::Format_RGB32);
     placeholder.fill(QColor(64, 64, 64)); // Dark gray background
     
     // Draw a simple video icon
@@ -1117,117 +2385,80 @@ void VideoCompressor::createPlaceholderThumbnail(VideoItem &item)
         painter.setFont(QFont("Arial", 8, QFont::Bold));
         painter.drawText(QRect(65, 25, 50, 18), Qt::AlignCenter, extension);
     }
+    painter.end();
     
-    item.thumbnail = placeholder;
-}
-
-double VideoCompressor::getVideoDuration(const QString &filePath)
-{
-    if (!m_ffmpegAvailable) {
-        emit debugMessage("Cannot get video duration: FFmpeg/FFprobe not available", "error");
-        return 0.0;
-    }
-    
-    QProcess process;
-    QStringList args;
-    args << "-v" << "quiet" 
-         << "-show_entries" << "format=duration" 
-         << "-of" << "csv=p=0" 
-         << filePath;
-    
-    emit debugMessage("Getting duration for: " + QFileInfo(filePath).fileName(), "info");
-    emit debugMessage("FFprobe command: ffprobe " + args.join(" "), "info");
-    
-    process.start("ffprobe", args);
-    bool started = process.waitForStarted(5000);
-    
-    if (!started) {
-        emit debugMessage("Failed to start FFprobe process for duration detection", "error");
-        emit debugMessage("FFprobe might not be installed or not in PATH", "error");
-        return 0.0;
-    }
-    
-    if (!process.waitForFinished(10000)) {
-        emit debugMessage("FFprobe timed out for: " + filePath, "error");
-        process.kill();
-        return 0.0;
-    }
-    
-    if (process.exitCode() != 0) {
-        QString errorOutput = QString::fromUtf8(process.readAllStandardError());
-        emit debugMessage("FFprobe failed for " + filePath + " (exit code: " + QString::number(process.exitCode()) + ")", "error");
-        emit debugMessage("FFprobe error: " + errorOutput, "error");
-        return 0.0;
-    }
-    
-    QString output = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
-    bool ok;
-    double duration = output.toDouble(&ok);
-    
-    if (ok && duration > 0) {
-        emit debugMessage("Duration detected: " + QString::number(duration, 'f', 1) + " seconds", "success");
-        return duration;
-    } else {
-        emit debugMessage("Invalid duration value from FFprobe: '" + output + "'", "error");
-        return 0.0;
-    }
+    // Encode once; the provider decodes it on demand
+    QByteArray encoded;
+    QBuffer buffer(&encoded);
+    buffer.open(QIODevice::WriteOnly);
+    placeholder.save(&buffer, "PNG");
+    setThumbnail(item, encoded);
 }
 
-int VideoCompressor::calculateOptimalBitrate(double durationSeconds, int targetSizeMB)
+int VideoCompressor::calculateOptimalBitrate(double durationSeconds, int targetSizeMB, int audioBitrateKbps)
 {
     if (durationSeconds <= 0) {
         return 500; // Fallback bitrate
     }
     
-    // Formula: Total Bitrate (kbps) = (Target Size in MB × 8000) / Video Duration (seconds)
-    // Using 8000 instead of 8388.608 to ensure we stay under the target
-    // Video Bitrate = Total Bitrate - Audio Bitrate (128 kbps)
+    // Formula: Total Bitrate (kbps) = (Target Size in MiB × 8388.608) / Video Duration (seconds)
+    // Video Bitrate = Total Bitrate - Audio Bitrate (from the probed audio track, 0 if silent)
+    // Aim at 95% of the target: an on-rate encode plus container overhead then lands
+    // inside the 90-100% band the size correction accepts, so it needs no re-run
+    const double targetFill = 0.95;
     
-    double totalBitrate = (targetSizeMB * 8000.0) / durationSeconds;
-    int videoBitrate = qMax(100, (int)(totalBitrate - 128)); // Minimum 100k, subtract audio bitrate
+    double totalBitrate = (targetSizeMB * 8388.608 * targetFill) / durationSeconds;
+    int videoBitrate = qMax(100, (int)(totalBitrate - audioBitrateKbps)); // Minimum 100k, subtract audio bitrate
     
     // Cap maximum bitrate for quality reasons
-    videoBitrate = qMin(videoBitrate, 5000);
-    
-    // Apply safety margin - reduce by 5% to ensure we stay under target
-    videoBitrate = (int)(videoBitrate * 0.95);
+    videoBitrate = qMin(videoBitrate, int(MaxVideoBitrateKbps));
     
-    emit debugMessage(QString("Calculated bitrate for %1 min video: %2 kbps (target: %3 MB, safety margin applied)")
+    emit debugMessage(QString("Calculated bitrate for %1 min video: %2 kbps video + %3 kbps audio (target: %4 MB, safety margin applied)")
                      .arg(QString::number(durationSeconds / 60.0, 'f', 1))
                      .arg(videoBitrate)
+                     .arg(audioBitrateKbps)
                      .arg(targetSizeMB), "info");
     
     return videoBitrate;
 }
 
-QString VideoCompressor::getFFmpegCommand(const VideoItem &item, const QString &outputPath, bool isFirstPass)
+int VideoCompressor::audioBitrateFor(const VideoItem &item) const
 {
-    // This method is now only used for debugging/logging purposes
-    // The actual command building is done in startFFmpegProcess
-    int videoBitrate = calculateOptimalBitrate(item.durationSeconds, m_targetSizeMB);
+    if (!item.media.valid) {
+        return 128; // Unknown source, keep the old fixed budget
+    }
+    if (!item.media.hasAudio()) {
+        return 0;
+    }
     
-    if (isFirstPass) {
-        QString nullOutput = 
-#ifdef Q_OS_WIN
-            "NUL";
-#else
-            "/dev/null";
-#endif
-        return QString("-i \"%1\" -c:v libx264 -b:v %2k -c:a aac -b:a 128k -pass 1 -f mp4 -y \"%3\"")
-               .arg(item.path)
-               .arg(videoBitrate)
-               .arg(nullOutput);
-    } else {
-        return QString("-i \"%1\" -c:v libx264 -b:v %2k -c:a aac -b:a 128k -pass 2 -movflags +faststart -y \"%3\"")
-               .arg(item.path)
-               .arg(videoBitrate)
-               .arg(outputPath);
+    // Never spend more than the source had, and never more than 128k
+    int sourceBitrate = item.media.audioBitRateKbps();
+    return sourceBitrate > 0 ? qBound(32, sourceBitrate, 128) : 128;
+}
+
+int VideoCompressor::targetSizeMBFor(const VideoItem &item) const
+{
+    return item.targetSizeMB > 0 ? item.targetSizeMB : m_targetSizeMB;
+}
+
+bool VideoCompressor::isAlreadyOptimal(const VideoItem &item) const
+{
+    qint64 targetBytes = qint64(targetSizeMBFor(item)) * 1024 * 1024;
+    if (item.fileSizeBytes > targetBytes) {
+        return false;
     }
+    
+    // Without probe data trust the size alone, as before
+    return !item.media.valid || item.media.isDiscordPlayable(QFileInfo(item.path).suffix());
 }
 
 bool VideoCompressor::isFileInClipboard(const QString &filePath)
 {
-    QClipboard *clipboard = QApplication::clipboard();
+    if (!hasGui()) {
+        return false;
+    }
+    
+    QClipboard *clipboard = QGuiApplication::clipboard();
     const QMimeData *mimeData = clipboard->mimeData();
     
     if (!mimeData || !mimeData->hasUrls()) {
@@ -1271,6 +2502,8 @@ void VideoCompressor::smartCleanupTempFiles()
         if (isFileInClipboard(fullPath)) {
             filesPreserved.append(fileName);
             emit debugMessage("Preserving clipboard file: " + fileName, "info");
+        } else if (m_journal && m_journal->references(fullPath)) {
+            filesPreserved.append(fileName);
         } else {
             filesToRemove.append(fileName);
         }
@@ -1291,7 +2524,7 @@ void VideoCompressor::smartCleanupTempFiles()
     }
     
     if (!filesPreserved.isEmpty()) {
-        emit debugMessage("Preserved " + QString::number(filesPreserved.size()) + " clipboard files", "info");
+        emit debugMessage("Preserved " + QString::number(filesPreserved.size()) + " clipboard or journaled files", "info");
     }
     
     // If no files preserved and temp directory is empty (except for subdirectories), remove it
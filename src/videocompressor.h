@@ -7,8 +7,20 @@
 #include <QAbstractListModel>
 #include <QProcess>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QFileInfo>
-#include <QPixmap>
+#include <QSharedPointer>
+#include "mediainfo.h"
+#include "mediaprober.h"
+#include "encodeplanner.h"
+#include "encoderbackend.h"
+#include "encoderregistry.h"
+#include "encoderspeedhistory.h"
+#include "ffmpegcapabilities.h"
+#include "ffmpegprogress.h"
+#include "jobjournal.h"
+#include "segmentencoder.h"
+#include "thumbnailprovider.h"
 
 enum class VideoStatus {
     Ready,
@@ -19,7 +31,22 @@ enum class VideoStatus {
     Error
 };
 
+// Rate control used for full transcodes
+enum class EncodingMode {
+    TwoPass,    // Analysis pass + encode pass, most accurate size
+    SinglePass, // ABR with VBV maxrate/bufsize, one decode
+    CappedCrf   // CRF capped by VBV, falls back to SinglePass if it overshoots
+};
+
+// Pipeline stages, each with its own job slots, so pass 1 of the next video
+// runs while pass 2 of the previous one encodes
+enum class JobStage {
+    Analysis,   // Two-pass pass 1 and the audio pre-encode
+    Encode      // Pass 2, single-pass, CRF, stream copy and chunked encodes
+};
+
 struct VideoItem {
+    quint64 id; // Stable identity, rows shift when items are removed
     QString path;
     QString originalSize;
     QString fileName;
@@ -28,8 +55,51 @@ struct VideoItem {
     QString statusText;
     int progress;
     QString outputPath;
-    QPixmap thumbnail;
+    int thumbnailRevision; // 0 = no thumbnail yet, bumped when it is replaced
     double durationSeconds; // Add duration for bitrate calculation
+    MediaInfo media; // Streams/format from ffprobe, invalid until probed
+    QString encodeMode; // Mode that produced the output, e.g. "Two-pass", "Remux"
+    int targetSizeMB;   // Per-item override from the job API, 0 = batch target
+    int encodingMode;   // Per-item EncodingMode override, -1 = batch mode
+    
+    // Live throughput of the running encode, from `-progress pipe:1`
+    double encodeFps;
+    double encodeSpeed;     // Realtime multiple, 0 = unknown
+    int encodeBitrateKbps;
+    qint64 outputBytes;     // Bytes written so far by the current run
+    int etaSeconds;         // -1 = unknown or not encoding
+};
+
+// State of one running compression job. Every job owns its FFmpeg process,
+// its pass state and its own pass-log prefix so parallel two-pass runs never
+// share ffmpeg2pass-*.log files.
+struct CompressionJob {
+    int index;              // Row in m_videos
+    EncoderBackend *encoder;  // Runs the current pass, a new one for every run
+    EncoderBackendKind backend; // Preferred backend; pass 1 fixes it for pass 2
+    EncodePlan plan;        // Remux, audio-only or full transcode
+    EncodingMode mode;      // Rate control for transcodes
+    EncoderChoice encoderChoice; // Video encoder and preset of a transcode
+    bool isFirstPass;
+    QString passLogPrefix;  // Passed to -passlogfile
+    QString outputPath;     // Pass 2 output
+    
+    // Two-pass audio is encoded once, next to pass 1, and muxed in pass 2
+    QProcess *audioProcess;
+    QString audioPath;      // Pre-encoded AAC, empty = encode inline
+    bool audioRunning;
+    bool firstPassDone;
+    
+    int sizeCorrections;    // Pass 2 re-runs made to converge on the target size
+    JobStage stage;         // Stage whose slot the job holds or waits for
+    bool waiting;           // Parked until that stage has a free slot, no process running
+    SegmentEncoder *segmentEncoder; // Long videos split into parallel chunks, else null
+    
+    // Deadline mode: wall-clock budget of the job and the speed of the run in flight
+    QElapsedTimer clock;    // Started with the job
+    double budgetSeconds;   // Encode time the encoder choice was made for, 0 = none
+    QElapsedTimer runClock; // Started with each FFmpeg run
+    FFmpegProgress lastProgress; // Last progress block of that run
 };
 
 class VideoCompressor : public QAbstractListModel
@@ -44,6 +114,18 @@ class VideoCompressor : public QAbstractListModel
     Q_PROPERTY(bool hardwareAccelerationEnabled READ hardwareAccelerationEnabled WRITE setHardwareAccelerationEnabled NOTIFY hardwareAccelerationEnabledChanged)
     Q_PROPERTY(bool hardwareAccelerationAvailable READ hardwareAccelerationAvailable NOTIFY hardwareAccelerationAvailableChanged)
     Q_PROPERTY(QString hardwareAccelerationType READ hardwareAccelerationType NOTIFY hardwareAccelerationTypeChanged)
+    Q_PROPERTY(int encodingMode READ encodingMode WRITE setEncodingMode NOTIFY encodingModeChanged)
+    Q_PROPERTY(int maxConcurrentJobs READ maxConcurrentJobs WRITE setMaxConcurrentJobs NOTIFY maxConcurrentJobsChanged)
+    Q_PROPERTY(int effectiveConcurrentJobs READ effectiveConcurrentJobs NOTIFY maxConcurrentJobsChanged)
+    Q_PROPERTY(int threadsPerJob READ threadsPerJob NOTIFY maxConcurrentJobsChanged)
+    Q_PROPERTY(bool sizeConvergenceEnabled READ sizeConvergenceEnabled WRITE setSizeConvergenceEnabled NOTIFY sizeConvergenceEnabledChanged)
+    Q_PROPERTY(int activeJobCount READ activeJobCount NOTIFY activeJobCountChanged)
+    Q_PROPERTY(QString encoderPreference READ encoderPreference WRITE setEncoderPreference NOTIFY encoderPreferenceChanged)
+    Q_PROPERTY(double encodeTimeBudget READ encodeTimeBudget WRITE setEncodeTimeBudget NOTIFY encodeTimeBudgetChanged)
+    Q_PROPERTY(int encodeDeadlineSeconds READ encodeDeadlineSeconds WRITE setEncodeDeadlineSeconds NOTIFY encodeDeadlineChanged)
+    Q_PROPERTY(bool deadlinePerBatch READ deadlinePerBatch WRITE setDeadlinePerBatch NOTIFY encodeDeadlineChanged)
+    Q_PROPERTY(QStringList availableEncoders READ availableEncoders NOTIFY availableEncodersChanged)
+    Q_PROPERTY(QString outputFolder READ outputFolder WRITE setOutputFolder NOTIFY outputFolderChanged)
 
 public:
     enum Roles {
@@ -53,12 +135,23 @@ public:
         StatusRole,
         StatusTextRole,
         ProgressRole,
-        ThumbnailRole
+        ThumbnailRole,
+        EncodeModeRole,
+        EncodeFpsRole,
+        EncodeSpeedRole,
+        EncodeBitrateRole,
+        OutputBytesRole,
+        EtaRole,
+        OutputPathRole,
+        VideoIdRole
     };
 
     explicit VideoCompressor(QObject *parent = nullptr);
     ~VideoCompressor();
     
+    // Image provider for image://thumbs/ URLs, ownership passes to the QML engine
+    QQuickImageProvider *createThumbnailProvider() const;
+    
     // QAbstractListModel interface
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
@@ -75,10 +168,36 @@ public:
     void setHardwareAccelerationEnabled(bool enabled);
     bool hardwareAccelerationAvailable() const { return m_hardwareAccelerationAvailable; }
     QString hardwareAccelerationType() const { return m_hardwareAccelerationType; }
+    int encodingMode() const { return static_cast<int>(m_encodingMode); }
+    void setEncodingMode(int mode);
+    int maxConcurrentJobs() const { return m_maxConcurrentJobs; } // 0 = derive from core count
+    void setMaxConcurrentJobs(int jobs);
+    int effectiveConcurrentJobs() const;
+    int activeJobCount() const { return m_activeJobs.size(); }
+    int threadsPerJob() const;
+    QString encoderPreference() const { return m_encoderPreference; } // An ffmpeg encoder name (default libx264) or "auto"
+    void setEncoderPreference(const QString &encoder);
+    double encodeTimeBudget() const { return m_encodeTimeBudget; } // Encode time per second of video, for "auto"
+    void setEncodeTimeBudget(double secondsPerSecond);
+    int encodeDeadlineSeconds() const { return m_encodeDeadlineSeconds; } // Wall-clock deadline, 0 = off
+    void setEncodeDeadlineSeconds(int seconds);
+    bool deadlinePerBatch() const { return m_deadlinePerBatch; } // Deadline for the whole batch instead of each job
+    void setDeadlinePerBatch(bool perBatch);
+    QStringList availableEncoders() const; // Software encoders of this ffmpeg build
+    static QString outputFileName(const QString &inputPath, const QString &container, int copy = 1);
+    QStringList outputFileNames(const QString &inputPath) const; // First-copy names in every container
+    bool sizeConvergenceEnabled() const { return m_sizeConvergenceEnabled; }
+    void setSizeConvergenceEnabled(bool enabled);
+    EncoderBackendKind encoderBackend() const { return m_encoderBackend; }
+    void setEncoderBackend(EncoderBackendKind backend); // Libav falls back to the process per task
+    QString outputFolder() const { return m_outputFolder; } // Where outputs are written, empty = temp folder
+    void setOutputFolder(const QString &folder); // Local path or file:// URL
 
 public slots:
     void addVideo(const QUrl &url);
     void addVideoFromPath(const QString &path);
+    void enqueueVideo(const QString &path); // Add, and join a running batch if there is one
+    quint64 submitJob(const QString &path, int targetSizeMB, int encodingMode); // Job API, 0 = rejected
     void clearVideos();
     void removeVideo(int index);
     void startCompression();
@@ -87,6 +206,7 @@ public slots:
     void checkFFmpeg();
     void installFFmpeg();
     void installFFmpegWithElevation(); // Add new method for elevated installation
+    void clearMediaCache();
 
 signals:
     void targetSizeMBChanged();
@@ -101,47 +221,117 @@ signals:
     void hardwareAccelerationEnabledChanged();
     void hardwareAccelerationAvailableChanged();
     void hardwareAccelerationTypeChanged();
+    void encodingModeChanged();
+    void maxConcurrentJobsChanged();
+    void activeJobCountChanged();
+    void sizeConvergenceEnabledChanged();
+    void encoderPreferenceChanged();
+    void encodeTimeBudgetChanged();
+    void encodeDeadlineChanged();
+    void availableEncodersChanged();
+    void outputFolderChanged();
+    
+    // Per-item events keyed by VideoItem::id, for clients outside the model
+    void videoStatusChanged(quint64 videoId, int status, const QString &statusText, int progress);
+    void videoThroughputChanged(quint64 videoId, double fps, double speed, int etaSeconds);
 
 private slots:
     void processNextVideo();
-    void onFFmpegFinished(int exitCode, QProcess::ExitStatus exitStatus);
-    void onFFmpegProgress();
     void onInstallProcessFinished(int exitCode, QProcess::ExitStatus exitStatus); // Add new slot
+    void onProbeFinished(const MediaProbeResult &result);
+    void restoreJournal();
 
 private:
     QList<VideoItem> m_videos;
     int m_targetSizeMB;
     bool m_isCompressing;
     bool m_ffmpegAvailable;
-    int m_currentVideoIndex;
     int m_completedCount;
-    QProcess *m_ffmpegProcess;
-    QTimer *m_progressTimer;
+    QList<int> m_pendingIndices; // Rows waiting for a free job slot
+    QList<CompressionJob *> m_activeJobs; // Jobs currently running
+    int m_maxConcurrentJobs;
+    EncodingMode m_encodingMode;
+    bool m_sizeConvergenceEnabled; // Re-run pass 2 until the output lands near the target
+    EncoderBackendKind m_encoderBackend;
     QString m_tempDir;
-    bool m_isFirstPass; // Track if we're in first or second pass
+    QString m_outputFolder; // Pass 2 writes straight here when set, no copy step
     bool m_hardwareAccelerationEnabled;
     bool m_hardwareAccelerationAvailable;
     QString m_hardwareAccelerationType;
+    FFmpegCapabilityDetector *m_capabilityDetector; // Cached, off-thread ffmpeg detection
+    FFmpegCapabilities m_capabilities; // Last confirmed result
+    EncoderRegistry m_encoderRegistry; // Encoders of the detected build
+    QString m_encoderPreference;
+    double m_encodeTimeBudget;
+    int m_encodeDeadlineSeconds;
+    bool m_deadlinePerBatch;
+    QElapsedTimer m_batchClock; // Started with the batch, for per-batch deadlines
+    EncoderSpeedHistory m_speedHistory; // Measured encode speeds of this machine
     QProcess *m_installProcess; // Add install process tracker
+    MediaProber *m_mediaProber; // Background duration/thumbnail ingestion
+    QSharedPointer<MediaCache> m_mediaCache; // Persistent probe results across sessions
+    QSharedPointer<ThumbnailCache> m_thumbnailCache; // Shared with the image provider
+    QSharedPointer<JobJournal> m_journal; // Write-ahead job state, null in headless runs
+    QHash<quint64, JournalEntry> m_resumeState; // Rows that resume at pass 2, by VideoItem::id
+    quint64 m_nextVideoId;
+    
+    static const int MaxVideoBitrateKbps = 5000; // Quality cap, short clips land under the target
+    static const int MaxSizeCorrections = 2;     // Pass 2 re-runs per job
     
-    void generateThumbnail(VideoItem &item);
+    static bool hasGui(); // False under QCoreApplication (--headless)
+    int indexOfVideo(quint64 id) const;
+    void beginBatch(); // Sets m_isCompressing and starts the batch clock
+    void queueRow(int index);
+    void journalItem(int index);
+    int targetSizeMBFor(const VideoItem &item) const;
+    void setThumbnail(VideoItem &item, const QByteArray &encoded);
     void createPlaceholderThumbnail(VideoItem &item); // Add new method
     QString formatFileSize(qint64 bytes);
     bool isVideoFile(const QString &path);
     void updateVideoStatus(int index, VideoStatus status, const QString &statusText, int progress = 0);
-    QString getFFmpegCommand(const VideoItem &item, const QString &outputPath, bool isFirstPass = false);
     void cleanupTempFiles();
     void smartCleanupTempFiles(); // Add smart cleanup method
     bool isFileInClipboard(const QString &filePath); // Add clipboard check method
-    double getVideoDuration(const QString &filePath); // Add duration detection
-    int calculateOptimalBitrate(double durationSeconds, int targetSizeMB); // Add bitrate calculation
-    void cleanupPassFiles(); // Add cleanup for pass files
-    void startFFmpegProcess(const VideoItem &item, const QString &outputPath, bool isFirstPass);
-    void checkHardwareAcceleration(); // Add hardware acceleration detection
-    bool testCudaEncoding(); // Add CUDA test method
-    bool testQuickSyncEncoding(); // Add QuickSync test method
-    QString getHardwareEncoderName(); // Get appropriate hardware encoder
-    QString getHardwareAcceleratorFlag(); // Get hardware accelerator flag
+    int calculateOptimalBitrate(double durationSeconds, int targetSizeMB, int audioBitrateKbps = 128); // Add bitrate calculation
+    int audioBitrateFor(const VideoItem &item) const; // 0 when the source is silent
+    bool isAlreadyOptimal(const VideoItem &item) const;
+    void cleanupPassFiles(const QString &passLogPrefix); // Add cleanup for pass files
+    void startJob(int index);
+    void runJob(CompressionJob *job);
+    JobStage firstStageFor(const CompressionJob *job) const;
+    int runningJobs(JobStage stage) const;
+    bool canAdmitJob() const;
+    void finishJob(CompressionJob *job);
+    CompressionJob *jobForEncoder(const EncoderBackend *encoder) const; // Null once the job finished or moved on
+    EncodePlan planFor(const VideoItem &item, bool allowStreamCopy);
+    void prepareTranscode(CompressionJob *job); // Encoder, rate control mode and output path of a transcode
+    void startTranscode(CompressionJob *job);
+    int segmentCountFor(const CompressionJob *job) const;
+    void startSegmentedEncode(CompressionJob *job, int chunkCount);
+    void onSegmentedEncodeFinished(CompressionJob *job, bool success, const QString &message);
+    void startFFmpegProcess(CompressionJob *job, bool isFirstPass);
+    void startAudioProcess(CompressionJob *job);
+    void onAudioFinished(CompressionJob *job, int exitCode, QProcess::ExitStatus exitStatus);
+    void startSecondPass(CompressionJob *job);
+    void onJobProgress(CompressionJob *job, const FFmpegProgress &progress);
+    void updateThroughput(int index, const FFmpegProgress &progress, int etaSeconds);
+    bool retrySecondPassForSize(CompressionJob *job, qint64 outputBytes);
+    QStringList buildFFmpegArgs(const CompressionJob *job, bool isFirstPass);
+    EncodeTask buildEncodeTask(const CompressionJob *job, bool isFirstPass);
+    bool isSingleRun(const CompressionJob *job) const;
+    QString encodeModeName(const CompressionJob *job) const;
+    void setEncodeMode(int index, const QString &mode);
+    void onFFmpegFinished(CompressionJob *job, int exitCode, QProcess::ExitStatus exitStatus);
+    void reportOutput(CompressionJob *job, const QString &note); // Completed or Error from the output size
+    QString uniqueOutputPath(int index, const QString &container) const;
+    QString workPathFor(const QString &outputPath) const; // Temp-folder stem for pass logs, audio and chunks
+    bool isTempPath(const QString &path) const;
+    void applyCapabilities(const FFmpegCapabilities &capabilities);
+    EncoderChoice chooseEncoder(const CompressionJob *job) const;
+    EncoderRegistry::Workload workloadFor(const CompressionJob *job) const;
+    double budgetFor(const CompressionJob *job) const; // Encode seconds the job may take
+    void recordEncodeSpeed(const CompressionJob *job, int preset); // Preset the finished run used
+    void reconsiderPreset(CompressionJob *job); // Between passes, from the speed pass 1 ran at
 };
 
 #endif // VIDEOCOMPRESSOR_H